@@ -0,0 +1,35 @@
+#ifndef HYPER_COMPILER_RULE_MATCHER_OUTPUT_HH_
+#define HYPER_COMPILER_RULE_MATCHER_OUTPUT_HH_
+
+#include <iostream>
+#include <string>
+
+namespace hyper {
+	namespace compiler {
+		struct rule_decl;
+
+		/*
+		 * Check if we know how to generate a specialised matcher for the
+		 * rule r. It is not the case if the rule has no premise, if a premise
+		 * contains some nested function, or if a variable of the conclusions
+		 * does not appear in the premises.
+		 */
+		bool can_compile_rule(const rule_decl& r);
+
+		/* Name of the C++ function generated by dump_rule_matcher */
+		std::string rule_matcher_name(const rule_decl& r);
+
+		/*
+		 * Output the definition of a function matching the premises of r
+		 * against a logic::facts database, following the signature of
+		 * logic::rule::matcher_type. The join order is the order of the
+		 * premises, and argument positions are resolved at compile time, so
+		 * no unification map is built at runtime.
+		 *
+		 * r must satisfy can_compile_rule.
+		 */
+		void dump_rule_matcher(std::ostream& oss, const rule_decl& r);
+	}
+}
+
+#endif /* HYPER_COMPILER_RULE_MATCHER_OUTPUT_HH_ */
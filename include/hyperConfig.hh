@@ -7,6 +7,7 @@
 
 #define BINARY_ARCHIVE 0
 #define TEXT_ARCHIVE 1
+#define COMPACT_ARCHIVE 2
 
 #ifndef HYPER_SERIALIZATION
 #define HYPER_SERIALIZATION BINARY_ARCHIVE
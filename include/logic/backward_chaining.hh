@@ -72,6 +72,7 @@ namespace hyper {
 
 					facts_ctx& ctx;
 					const rules& rs;
+					engine_stats* stats;
 
 					void update_hypothesis(hypothesis_id id, const hypothesis& h);
 
@@ -86,7 +87,7 @@ namespace hyper {
 						namespace phx = boost::phoenix;
 						node_id (proof_tree::*f)(node&, const function_call&) = &proof_tree::add_hypothesis_to_node;
 						return std::transform(begin, end, out, 
-								phx::bind(f, *this, phx::ref(n), phx::arg_names::arg1));
+								phx::bind(f, this, phx::ref(n), phx::arg_names::arg1));
 					}
 
 					void compute_node_state(node& n);
@@ -100,8 +101,9 @@ namespace hyper {
 					friend struct explore_node;
 
 				public:
-					proof_tree(facts_ctx& ctx, const rules& rs) : 
-						node_id_generator(0), hyp_id_generator(0), ctx(ctx), rs(rs) 
+					proof_tree(facts_ctx& ctx, const rules& rs, engine_stats* stats = 0) : 
+						node_id_generator(0), hyp_id_generator(0), ctx(ctx), rs(rs),
+						stats(stats)
 					{}
 
 					boost::logic::tribool compute(const function_call& f);
@@ -125,9 +127,10 @@ namespace hyper {
 		struct backward_chaining {
 			const rules& rs;
 			facts_ctx& ctx;
+			engine_stats* stats; /**< null if profiling is disabled */
 
-			backward_chaining(const rules& rs, facts_ctx& ctx):
-				rs(rs), ctx(ctx)
+			backward_chaining(const rules& rs, facts_ctx& ctx, engine_stats* stats = 0):
+				rs(rs), ctx(ctx), stats(stats)
 			{}
 
 			/* Check if f is directly inferable from the facts and the rules */
@@ -4,6 +4,7 @@
 
 #include <map>
 
+#include <logic/engine_stats.hh>
 #include <logic/facts.hh>
 #include <logic/logic_var.hh>
 #include <logic/rules.hh>
@@ -85,6 +86,12 @@ namespace hyper {
 
 				rules rules_;  /**< A set of logic rules, the same for all context */
 
+				engine_stats stats_;
+				bool stats_enabled_;
+
+				/* null if profiling is disabled */
+				engine_stats* stats_ptr() { return stats_enabled_ ? &stats_ : 0; }
+
 				void apply_rules(facts_ctx &);
 
 				/**
@@ -212,15 +219,18 @@ namespace hyper {
 				 * @param identifier is the identifier rule
 				 * @param cond is the list of conditions needed to trigger the rule
 				 * @param action is the list of consequences of the rule
+				 * @param matcher is an optional specialised implementation
+				 * of the rule matching, generated by hyperc
 				 *
 				 * @return if the rule has been successfully inserted
 				 */
 				template <typename FactType>
 				bool add_rule(const std::string& identifier,
 							  const typename std::vector<FactType>& cond,
-							  const typename std::vector<FactType>& action)
+							  const typename std::vector<FactType>& action,
+							  rule::matcher_type matcher = 0)
 				{
-					bool res = rules_.add(identifier, cond, action);
+					bool res = rules_.add(identifier, cond, action, matcher);
 
 					// XXX rewrite it using boost::phoenix::bind
 					for (factsMap::iterator it = facts_.begin(); it != facts_.end(); ++it) 
@@ -364,12 +374,22 @@ namespace hyper {
 				friend std::ostream& operator << (std::ostream&, const engine&);
 
 				const funcDefList& funcs() const { return funcs_; }
+
+				/**
+				 * Profiling counters of the engine. They are only updated
+				 * when profiling is enabled with enable_stats (disabled by
+				 * default).
+				 */
+				const engine_stats& stats() const { return stats_; }
+				void enable_stats(bool enable = true) { stats_enabled_ = enable; }
+				bool stats_enabled() const { return stats_enabled_; }
+				void reset_stats() { stats_.reset(); }
 		};
 
 		std::ostream& operator << (std::ostream&, const engine&);
 
 	
-		bool is_world_consistent(const rules& rs, facts_ctx& facts);
+		bool is_world_consistent(const rules& rs, facts_ctx& facts, engine_stats* stats = 0);
 	}
 }
 
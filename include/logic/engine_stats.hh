@@ -0,0 +1,72 @@
+#ifndef _LOGIC_ENGINE_STATS_HH_
+#define _LOGIC_ENGINE_STATS_HH_
+
+#include <iostream>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace hyper {
+	namespace logic {
+
+		/*
+		 * Profiling counters for the logic engine.
+		 *
+		 * The different parts of the engine receive a pointer on it, which
+		 * is null when profiling is disabled, so the only cost in this case
+		 * is a pointer test.
+		 */
+		struct engine_stats {
+			size_t add_fact_calls;
+			size_t infer_calls;
+
+			/* forward chaining (engine::apply_rules) */
+			size_t fixpoint_iterations; /**< number of passes over the rules */
+			size_t rules_tried;
+			size_t rules_fired;         /**< rules which have produced new facts */
+
+			/* unify() calls, from forward and backward chaining */
+			size_t unify_attempts;
+			size_t unify_successes;
+
+			/* backward chaining */
+			size_t proof_nodes;
+			size_t candidates;          /**< candidate combinaisons enumerated */
+
+			boost::posix_time::time_duration add_fact_time;
+			boost::posix_time::time_duration apply_rules_time;
+			boost::posix_time::time_duration infer_time;
+			boost::posix_time::time_duration backward_chaining_time;
+
+			engine_stats() { reset(); }
+
+			void reset();
+		};
+
+		std::ostream& operator << (std::ostream&, const engine_stats&);
+
+		/*
+		 * Add the time spent in the current scope to d. Do nothing if d is
+		 * null.
+		 */
+		class stats_timer {
+			private:
+				boost::posix_time::time_duration* d;
+				boost::posix_time::ptime start;
+
+			public:
+				stats_timer(boost::posix_time::time_duration* d) : d(d)
+				{
+					if (d)
+						start = boost::posix_time::microsec_clock::universal_time();
+				}
+
+				~stats_timer()
+				{
+					if (d)
+						*d += boost::posix_time::microsec_clock::universal_time() - start;
+				}
+		};
+	}
+}
+
+#endif /* _LOGIC_ENGINE_STATS_HH_ */
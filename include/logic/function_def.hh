@@ -8,12 +8,14 @@
 
 #include <boost/optional/optional_fwd.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace hyper {
 	namespace logic {
 		typedef std::size_t functionId ;
 
 		struct eval_predicate;
+		class generate_cache;
 
 		/*
 		 * In the logic world, everything is untyped
@@ -55,6 +57,13 @@ namespace hyper {
 				funcE list_eval;
 				funcM m;
 
+				/*
+				 * Cache of parsed function_call, indexed by their textual
+				 * representation. It is a pure optimisation, so it can be
+				 * modified even through a const funcDefList.
+				 */
+				boost::scoped_ptr<generate_cache> cache_;
+
 			public:
 				funcDefList();
 				~funcDefList();
@@ -72,6 +81,8 @@ namespace hyper {
 				boost::optional<functionId> getId(const std::string& name) const;
 
 				size_t size() const { return list.size(); }
+
+				generate_cache& cache() const { return *cache_; }
 		};
 	}
 }
@@ -0,0 +1,76 @@
+#ifndef _LOGIC_GENERATE_CACHE_HH_
+#define _LOGIC_GENERATE_CACHE_HH_
+
+#include <logic/expression.hh>
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+namespace hyper {
+	namespace logic {
+
+		/*
+		 * A bounded LRU cache from the textual representation of a
+		 * function_call to its parsed form. Each funcDefList owns one, as the
+		 * functionId stored in the result are only meaningful for it.
+		 *
+		 * Only successful parses are stored : functions are never removed
+		 * from a funcDefList, so a cached entry can't become invalid, while
+		 * a failed parse may succeed after a later funcDefList::add.
+		 */
+		class generate_cache : public boost::noncopyable
+		{
+			private:
+				typedef std::pair<std::string, function_call> entry;
+				typedef std::list<entry> lruL;
+				typedef std::map<std::string, lruL::iterator> indexM;
+
+				lruL lru;    /**< most recently used entry in front */
+				indexM index;
+				size_t capacity_;
+
+				size_t hits_;
+				size_t misses_;
+
+				void shrink();
+
+			public:
+				static const size_t default_capacity = 256;
+
+				generate_cache(size_t capacity = default_capacity) :
+					capacity_(capacity), hits_(0), misses_(0)
+				{}
+
+				/*
+				 * Search expr in the cache. On success, res is filled with the
+				 * cached function_call, and the entry becomes the most
+				 * recently used one.
+				 */
+				bool get(const std::string& expr, function_call& res);
+
+				/*
+				 * Insert a successful parse in the cache, evicting the least
+				 * recently used entry if the cache is full
+				 */
+				void insert(const std::string& expr, const function_call& f);
+
+				void clear();
+
+				/* A capacity of 0 disables the cache */
+				void set_capacity(size_t capacity);
+				size_t capacity() const { return capacity_; }
+				size_t size() const { return index.size(); }
+
+				size_t hits() const { return hits_; }
+				size_t misses() const { return misses_; }
+				void reset_stats() { hits_ = misses_ = 0; }
+		};
+
+		std::ostream& operator << (std::ostream&, const generate_cache&);
+	}
+}
+
+#endif /* _LOGIC_GENERATE_CACHE_HH_ */
@@ -11,9 +11,20 @@
 namespace hyper {
 	namespace logic {
 
+		class facts;
+
 		struct rule {
 			typedef std::string identifier_type;
 
+			/*
+			 * A specialised implementation of the forward chaining matching
+			 * of a rule, generated by hyperc. It must push in res the
+			 * instantiated actions for each way of matching the condition
+			 * against the facts, and returns the number of such matches.
+			 */
+			typedef size_t (*matcher_type)(const rule& r, const facts& f,
+										   std::vector<function_call>& res);
+
 			identifier_type identifier;
 			std::vector<function_call> condition;
 			std::vector<function_call> action;
@@ -38,6 +49,13 @@ namespace hyper {
 			 */
 			map_symbol symbol_to_fun;
 
+			/* 
+			 * If not null, used in place of the generic unification in
+			 * forward chaining
+			 */
+			matcher_type matcher;
+
+			rule() : matcher(0) {}
 		};
 
 		std::ostream& operator << (std::ostream&, const rule&);
@@ -55,10 +73,12 @@ namespace hyper {
 				rules(const funcDefList& funcs_) : funcs(funcs_) {}
 				bool add(const std::string& identifier,
 						 const std::vector<std::string>& cond,
-						 const std::vector<std::string>& action);
+						 const std::vector<std::string>& action,
+						 rule::matcher_type matcher = 0);
 				bool add(const std::string& identifier,
 						 const std::vector<function_call>& cond,
-						 const std::vector<function_call>& action);
+						 const std::vector<function_call>& action,
+						 rule::matcher_type matcher = 0);
 
 				const_iterator begin() const { return r_.begin(); }
 				const_iterator end() const { return r_.end(); }
@@ -5,8 +5,12 @@
 
 #include <model/discover_root.hh>
 #include <model/execute.hh>
+#include <model/remote_cache.hh>
 #include <model/setter.hh>
+#include <model/status_coalescer.hh>
+#include <model/subscription.hh>
 #include <model/update.hh>
+#include <model/worker_pool.hh>
 
 namespace hyper {
 	namespace model {
@@ -21,6 +25,16 @@ namespace hyper {
 
 			boost::asio::io_service io_s;
 
+			/* 
+			 * Liveness messages (ping) go through their own io_service,
+			 * run by a dedicated thread, so a busy main loop does not make
+			 * us look dead for hyperruntime
+			 */
+			boost::asio::io_service liveness_s;
+
+			/* threads running the user functions, see run(size_t) */
+			model::worker_pool workers;
+
 			model::discover_root discover;
 			actor_impl* actor;
 
@@ -29,6 +43,16 @@ namespace hyper {
 			network::local_proxy proxy;
 			model::setter setter;
 
+			/* variables pushed to other agents, and pushed to us */
+			model::variable_publisher publisher;
+			model::variable_subscriber subscriptions;
+
+			/* remote values read recently, for variables with a lease */
+			model::remote_value_cache remote_cache;
+
+			/* status updates of the constraints we execute for other agents */
+			model::status_coalescer ctr_status;
+
 			std::string name;
 			model::functions_map f_map;
 
@@ -54,10 +78,27 @@ namespace hyper {
 			void test_run();
 			void run();
 
+			/*
+			 * Same as run(), but user functions are computed by a pool of
+			 * nb_workers threads. Everything else still runs in the
+			 * calling thread.
+			 */
+			void run(size_t nb_workers);
+
 			void stop();
 
+			/*
+			 * Requests to other agents fail with
+			 * network::protocol_error::request_timeout if they are not
+			 * answered within seconds. 0 means waiting forever.
+			 */
+			void set_request_timeout(double seconds);
+
 			std::ostream& logger(int level);
 
+			/* Use it through HYPER_LOG to skip disabled log statements */
+			bool log_enabled(int level) const;
+
 			logic_layer& logic();
 
 			virtual ~ability();
@@ -80,6 +121,8 @@ namespace hyper {
 			void start();
 
 			private:
+			void run_liveness();
+
 			template <typename T>
 			void export_variable_helper(const std::string& name, const T& value)
 			{
@@ -9,6 +9,7 @@ namespace hyper {
 	namespace model {
 		namespace details {
 			typedef boost::mpl::vector<network::variable_value,
+									   network::variable_values,
 									   network::request_constraint_answer,
 									   network::list_agents> input_cb;
 		}
@@ -42,6 +43,11 @@ namespace hyper {
 				return logger_(level);
 			}
 
+			bool log_enabled(int level) const
+			{
+				return logger_.enabled(level);
+			}
+
 			actor_impl(boost::asio::io_service& io_s, const std::string& name,
 					   int level, const discover_root& discover);
 		};
@@ -1,21 +1,36 @@
 #ifndef HYPER_WAIT_COMPUTE_WAIT_EXPRESSION_HH_
 #define HYPER_WAIT_COMPUTE_WAIT_EXPRESSION_HH_
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/scoped_ptr.hpp>
 
 #include <model/abortable_function.hh>
+#include <network/types.hh>
 
 namespace hyper {
 	namespace model {
+		struct ability;
+
 		/** compute_wait_expression represents a computation represented by
 		 * #fun_ptry which waits until a certain predicate is true.
 		 * 
 		 * It is implemented as a loop test -> wait -> test -> wait ..., with a
 		 * configurable wait #delay_.
+		 *
+		 * If the predicate depends on remote variables, it can subscribe to
+		 * them : the wait is then interrupted as soon as one of them
+		 * changes, and, once the remote agents have confirmed all the
+		 * subscriptions, the loop falls back to a longer #watch_delay_.
 		 */
 		class compute_wait_expression : public abortable_function_base {
+			public:
+				typedef std::vector<std::pair<std::string, std::string> > remote_vars;
+
 			private:
 				boost::scoped_ptr<abortable_computation> fun_ptr; 
 				boost::asio::io_service& io_service_; /**< ref to io_service */
@@ -28,8 +43,26 @@ namespace hyper {
 				bool waiting; /**< true if in the wait phase */
 				cb_type cb_; /**< store the final callback */
 
+				ability* a_; /**< ability owning the subscriptions, if any */
+				remote_vars watched_; /**< remote variables the predicate depends on */
+				boost::posix_time::time_duration watch_delay_; /**< wait time while subscribed */
+				std::vector<network::identifier> watch_ids_; /**< current subscriptions */
+				bool changed_; /**< a watched variable changed during the computation */
+
 				typedef boost::function<void (const boost::system::error_code&)> cb_type;
 
+				/** Subscribe to #watched_, if not already done */
+				void start_watching();
+
+				/** Cancel the subscriptions */
+				void stop_watching();
+
+				/** true if all the subscriptions are confirmed by a first update */
+				bool subscribed() const;
+
+				/** Called when a watched variable has changed */
+				void handle_change();
+
 				/**
 				 * Called when #deadline_ has expired
 				 * @param e is the return code of #deadline_::async_wait
@@ -68,6 +101,25 @@ namespace hyper {
 						abortable_computation* fun_ptr,
 						bool& res);
 
+				/**
+				 * The constructor, for a predicate depending on remote variables
+				 *
+				 * @param a is the ability, used to subscribe to the remote variables
+				 * @param delay is the time between two tests call, and the
+				 * sampling period of the remote variables
+				 * @param watch_delay is the time between two tests call when
+				 * the remote agents have confirmed the subscriptions
+				 * @param fun_ptr represents the test function : it must update res when invocated
+				 * @param res is the result of the test.
+				 * @param watched is the list of (agent, variable) the predicate depends on
+				 */
+				compute_wait_expression(ability& a,
+						boost::posix_time::time_duration delay,
+						boost::posix_time::time_duration watch_delay,
+						abortable_computation* fun_ptr,
+						bool& res,
+						const remote_vars& watched);
+
 				/**
 				 * Retrieve the error associated to this computation. It is
 				 * valid only the last computation fails.
@@ -95,6 +147,8 @@ namespace hyper {
 				 * Resume the current action
 				 */
 				void resume();
+
+				~compute_wait_expression();
 		};
 	}
 }
@@ -10,6 +10,7 @@
 #include <model/actor_impl.hh>
 #include <model/execute.hh>
 #include <model/proxy.hh>
+#include <model/worker_pool.hh>
 
 #include <boost/any.hpp>
 #include <boost/array.hpp>
@@ -56,6 +57,18 @@ namespace hyper {
 				cb(e);
 			}
 
+			template <typename T>
+			void handle_remote_batch_value(const boost::system::error_code& e,
+										   const network::variable_value& v,
+										   T& res, fun_cb cb)
+			{
+				if (e || !v.success)
+					res = boost::none;
+				else
+					res = network::deserialize_value<typename T::value_type>(v.value);
+				cb(e);
+			}
+
 			template <typename T>
 			void handle_local_update(const boost::system::error_code& e, 
 					const hyper::network::error_context& err_ctx, 
@@ -83,12 +96,14 @@ namespace hyper {
 				T& res;
 				hyper::network::error_context& err_ctx;
 				fun_cb cb;
+				boost::shared_ptr<remote_batch_reader> batch;
 				
 				evaluate_logic_expression(boost::asio::io_service& io_s_, 
 										  model::ability & a_, T& res_, 
 										  hyper::network::error_context& err_ctx_,
-										  fun_cb cb_) : 
-					io_s(io_s_), a(a_), res(res_), err_ctx(err_ctx_), cb(cb_) {}
+										  fun_cb cb_,
+										  boost::shared_ptr<remote_batch_reader> batch_) : 
+					io_s(io_s_), a(a_), res(res_), err_ctx(err_ctx_), cb(cb_), batch(batch_) {}
 
 				template <typename U> 
 				void operator() (const U&) const { cb(boost::asio::error::invalid_argument);}
@@ -127,6 +142,12 @@ namespace hyper {
 									p.second, cb);
 
 							a.updater.async_update(p.second, 0, a.name, local_cb);
+						} else if (batch) {
+							/* fetched with the other remote arguments of the function */
+							batch->add(p.first, p.second,
+									boost::bind(&handle_remote_batch_value<T>,
+												boost::asio::placeholders::error, _2,
+												boost::ref(res), cb));
 						} else {
 							remote_proxy* proxy (new remote_proxy(a));
 
@@ -151,9 +172,10 @@ namespace hyper {
 			void evaluate(boost::asio::io_service& io_s, 
 					   const logic::expression &e, ability& a,
 					   hyper::network::error_context & err_ctx,
-					   T& res, fun_cb cb)
+					   T& res, fun_cb cb,
+					   boost::shared_ptr<remote_batch_reader> batch)
 			{
-				return boost::apply_visitor(evaluate_logic_expression<T>(io_s, a, res, err_ctx, cb), e.expr);
+				return boost::apply_visitor(evaluate_logic_expression<T>(io_s, a, res, err_ctx, cb, batch), e.expr);
 			}
 
 			template <typename T>
@@ -187,12 +209,15 @@ namespace hyper {
 				ability &a;
 				hyper::network::error_context& err_ctx;
 				fun_cb cb;
+				boost::shared_ptr<remote_batch_reader> batch;
 
 				compute(T* func_, boost::asio::io_service& io_s_, 
 						const std::vector<logic::expression> & e_, ability & a_,
 						hyper::network::error_context& err_ctx_,
-						fun_cb cb_) : 
-					func(func_), io_s(io_s_), e(e_), a(a_), err_ctx(err_ctx_), cb(cb_) {}
+						fun_cb cb_,
+						boost::shared_ptr<remote_batch_reader> batch_) : 
+					func(func_), io_s(io_s_), e(e_), a(a_), err_ctx(err_ctx_), cb(cb_),
+					batch(batch_) {}
 
 				template <typename U>
 				void operator() (U unused)
@@ -224,7 +249,7 @@ namespace hyper {
 										  boost::ref(a),
 										  boost::ref(err_ctx),
 										  boost::ref(boost::get<U::value>(func->args)),
-										  local_cb));
+										  local_cb, batch));
 				}
 			};
 
@@ -354,7 +379,10 @@ BOOST_PP_REPEAT(BOOST_PP_INC(EVAL_MAX_PARAMS), NEW_EVAL_DECL, _)
 
 			boost::system::error_code err;
 
-			function_execution() {
+			boost::asio::io_service* io_s_;
+			worker_pool* workers_;
+
+			function_execution() : io_s_(0), workers_(0) {
 				details::init_func<function_execution<T> > init_(*this);
 				boost::mpl::for_each<range> (init_);
 				result = boost::none;
@@ -373,8 +401,17 @@ BOOST_PP_REPEAT(BOOST_PP_INC(EVAL_MAX_PARAMS), NEW_EVAL_DECL, _)
 				// compiler normally already has checked that, but ...
 				assert(e.size() == args_size);
 
-				details::compute<function_execution<T> > compute_(this, io_s, e, a, err_ctx, cb);
+				io_s_ = &io_s;
+				workers_ = &a.workers;
+				boost::shared_ptr<remote_batch_reader> batch(new remote_batch_reader(a));
+				details::compute<function_execution<T> > compute_(this, io_s, e, a, err_ctx, cb, batch);
 				boost::mpl::for_each<range> (compute_);
+
+				/* 
+				 * Queued after the evaluation of the arguments, so all the
+				 * remote variables have been collected
+				 */
+				io_s.dispatch(boost::bind(&remote_batch_reader::flush, batch));
 			}	
 
 			bool is_finished() const
@@ -413,14 +450,40 @@ BOOST_PP_REPEAT(BOOST_PP_INC(EVAL_MAX_PARAMS), NEW_EVAL_DECL, _)
 				if (! is_finished()) // wait for other completion
 					return;
 
-				if (is_computable())
-					result = details::eval<function_execution<T>, args_size> (args) ();
-				else
+				if (!is_computable()) {
 					result = boost::none;
+					handler(err);
+					return;
+				}
+
+				/*
+				 * The user function only reads args and writes result, so it
+				 * can safely run on a worker thread, without stalling the
+				 * io_service of the ability
+				 */
+				void (function_execution<T>::*f) () = &function_execution<T>::compute_result;
+				void (function_execution<T>::*h) (const boost::system::error_code&, fun_cb) =
+					&function_execution<T>::handle_result;
+				workers_->async_run(boost::bind(f, this), boost::bind(h, this, _1, handler), *io_s_);
+			}
+
+			/* e is set if the user function has thrown */
+			void handle_result(const boost::system::error_code& e, fun_cb handler)
+			{
+				if (e) {
+					result = boost::none;
+					handler(e);
+					return;
+				}
 
 				handler(err);
 			}
 
+			void compute_result()
+			{
+				result = details::eval<function_execution<T>, args_size> (args) ();
+			}
+
 			boost::any get_result() 
 			{
 				return boost::any(result);
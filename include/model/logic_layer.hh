@@ -107,9 +107,10 @@ namespace hyper {
 			void add_func(const std::string& s, const std::vector<std::string>& args_type);
 
 			void add_rules(const std::string& s, const std::vector<logic::function_call>& premises, 
-												 const std::vector<logic::function_call>& conclusions)
+												 const std::vector<logic::function_call>& conclusions,
+												 logic::rule::matcher_type matcher = 0)
 			{
-				engine.add_rule(s, premises, conclusions);
+				engine.add_rule(s, premises, conclusions, matcher);
 			}
 
 			void async_exec(const logic_constraint& ctr, 
@@ -9,13 +9,17 @@
 #include <boost/system/system_error.hpp>
 
 #include <model/discover_root.hh>
+#include <network/compression.hh>
 
 namespace hyper {
 	namespace model {
 
 		void parse_options(int argc, char** argv, const std::string& name,
 						   bool& background,
-						   int& debug_lvl);
+						   int& debug_lvl,
+						   size_t& nb_workers,
+						   double& request_timeout,
+						   size_t& compression_threshold);
 
 		template <typename Agent>
 		int main(int argc, char** argv, const std::string& name)
@@ -23,7 +27,11 @@ namespace hyper {
 			try {
 				int level;
 				bool bg;
-				parse_options(argc, argv, name, bg, level);
+				size_t nb_workers;
+				double request_timeout;
+				size_t compression_threshold;
+				parse_options(argc, argv, name, bg, level, nb_workers, request_timeout,
+							  compression_threshold);
 				// XXX NON PORTABLE IMPLEMENTATION
 				if (bg) { 
 					if (daemon(1, 1) < 0) 
@@ -31,8 +39,11 @@ namespace hyper {
 								boost::system::error_code(errno, boost::system::system_category()));
 								  
 				}
+				/* before the agent creates its sockets */
+				network::set_compression_threshold(compression_threshold);
 				Agent agent(level);
-				agent.run();
+				agent.set_request_timeout(request_timeout);
+				agent.run(nb_workers);
 			} 
             catch (const hyper::model::root_not_found_error&) 
             {
@@ -7,8 +7,12 @@
 #include <network/utils.hh>
 #include <network/log_level.hh>
 
+#include <map>
+
 #include <boost/asio/placeholders.hpp>
 #include <boost/array.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function/function0.hpp>
 #include <boost/function/function1.hpp>
 #include <boost/function/function2.hpp>
 #include <boost/make_shared.hpp>
@@ -23,9 +27,19 @@ namespace hyper {
 	namespace model {
 			struct ability;
 
+			/* Variables of a remote_values read from the same agent */
+			struct remote_batch
+			{
+				std::string src;
+				network::request_variable_values msg;
+				network::variable_values ans;
+			};
+
 			template <typename T>
 			struct remote_value
 			{
+				typedef T value_type;
+
 				std::string src;
 				network::request_variable_value msg;
 				network::variable_value ans;
@@ -33,9 +47,13 @@ namespace hyper {
 				boost::optional<T> value;
 				bool terminated;
 
+				/* position of the variable in remote_values::batches */
+				size_t batch;
+				size_t pos;
+
 				remote_value() {}
 				remote_value(const std::string& src, const std::string& var_name) : 
-					src(src), value(boost::none), terminated(false)
+					src(src), value(boost::none), terminated(false), batch(0), pos(0)
 				{
 					msg.var_name = var_name;
 				}
@@ -71,18 +89,36 @@ namespace hyper {
 										> remote_vars_conf;
 					tupleT& t;
 					const remote_vars_conf& vars;
+					std::vector<remote_batch>& batches;
 
 					init_remote_values(tupleT& t,
-									   const remote_vars_conf& vars) :
-						t(t), vars(vars) {}
+									   const remote_vars_conf& vars,
+									   std::vector<remote_batch>& batches) :
+						t(t), vars(vars), batches(batches) {}
 
 					template <typename U>
 					void operator() (U)
 					{
-						boost::get<U::value>(t).src = vars[U::value].first;
-						boost::get<U::value>(t).msg.var_name = vars[U::value].second;
+						const std::string& src = vars[U::value].first;
+						const std::string& var_name = vars[U::value].second;
+
+						boost::get<U::value>(t).src = src;
+						boost::get<U::value>(t).msg.var_name = var_name;
 						boost::get<U::value>(t).value = boost::none;
 						boost::get<U::value>(t).terminated = false;
+
+						/* group the variables by agent */
+						size_t i = 0;
+						while (i < batches.size() && batches[i].src != src)
+							++i;
+						if (i == batches.size()) {
+							batches.push_back(remote_batch());
+							batches.back().src = src;
+						}
+
+						boost::get<U::value>(t).batch = i;
+						boost::get<U::value>(t).pos = batches[i].msg.var_names.size();
+						batches[i].msg.var_names.push_back(var_name);
 					}
 				};
 
@@ -159,8 +195,45 @@ namespace hyper {
 					}
 				};
 
-				template <typename tupleT, typename Handler>
-				struct remote_value_async_get;
+				/* Dispatch the answer of the batch @i to its remote_value */
+				template <typename tupleT>
+				struct remote_values_fill_batch
+				{
+					tupleT& t;
+					const remote_batch& batch;
+					size_t i;
+					const boost::system::error_code& e;
+
+					remote_values_fill_batch(tupleT& t, const remote_batch& batch, size_t i,
+											 const boost::system::error_code& e) :
+						t(t), batch(batch), i(i), e(e)
+					{}
+
+					template <typename U>
+					void operator() (U)
+					{
+						typedef typename boost::tuples::element<U::value, tupleT>::type remote_type;
+						typedef typename remote_type::value_type value_type;
+
+						remote_type& value = boost::get<U::value>(t);
+						if (value.batch != i)
+							return;
+
+						value.terminated = true;
+						if (!e && value.pos < batch.ans.values.size())
+							value.ans = batch.ans.values[value.pos];
+						else {
+							value.ans = network::variable_value();
+							value.ans.var_name = value.msg.var_name;
+							value.ans.success = false;
+						}
+
+						if (value.ans.success)
+							value.value = network::deserialize_value<value_type>(value.ans.value);
+						else
+							value.value = boost::none;
+					}
+				};
 			}
 
 			template <typename vectorT>
@@ -178,13 +251,14 @@ namespace hyper {
 				>::type seqReturn;
 
 				tupleT values;
+				std::vector<remote_batch> batches;
 
 				// XXX only valid if size == 0
 				remote_values() {}
 
 				remote_values(const remote_vars_conf& vars)
 				{
-					details::init_remote_values<tupleT, size> init_(values, vars);
+					details::init_remote_values<tupleT, size> init_(values, vars, batches);
 					boost::mpl::for_each<range> (init_);
 				}
 
@@ -240,11 +314,38 @@ namespace hyper {
 								   network::variable_value& ans,
 								   cb_fun cb);
 
+					void async_ask(const std::string& dst, 
+								   const network::request_variable_values& msg,
+								   network::variable_values& ans,
+								   cb_fun cb);
+
+					void log_batch_failures(const boost::system::error_code& e,
+											const remote_batch& batch);
+
 					void clean_up(network::identifier id);
 
+					/*
+					 * Access to the remote value cache of the ability. cached
+					 * returns a value only if dst::var_name has a valid lease
+					 */
+					boost::optional<std::string> cached(const std::string& dst,
+														const std::string& var_name);
+					void cache(const std::string& dst, const network::variable_value& v);
+					void cache(const remote_batch& batch);
+
+					/* Run cb later, in the ability io_service */
+					void post(boost::function<void ()> cb);
+
+					/*
+					 * Serve a batch from the cache, if all its variables are
+					 * cached
+					 */
+					bool get_cached(remote_batch& batch);
+
 					template <typename T, typename Handler>
 					void handle_get(const boost::system::error_code& e,
 									network::identifier id,
+									const std::string& dst,
 								    T& output,
 									boost::tuple<Handler> handler)
 					{
@@ -252,6 +353,7 @@ namespace hyper {
 							output = boost::none;
 							a.logger(WARNING) << "Failed to get the value of " << ans.var_name << std::endl;
 						} else {
+							cache(dst, ans);
 							output = network::deserialize_value<typename T::value_type>(ans.value);
 						}
 
@@ -273,6 +375,34 @@ namespace hyper {
 						}
 					}
 
+					template <typename vectorT, typename Handler>
+					void complete_batch(const boost::system::error_code& e,
+										remote_values<vectorT>& values,
+										size_t i,
+										boost::tuple<Handler> handler)
+					{
+						details::remote_values_fill_batch<typename remote_values<vectorT>::tupleT>
+							fill_(values.values, values.batches[i], i, e);
+						boost::mpl::for_each<typename remote_values<vectorT>::range> (fill_);
+						log_batch_failures(e, values.batches[i]);
+
+						handle_remote_values_get(e, values, handler);
+					}
+
+					template <typename vectorT, typename Handler>
+					void handle_remote_batch_get(const boost::system::error_code& e,
+									network::identifier id,
+									remote_values<vectorT>& values,
+									size_t i,
+									boost::tuple<Handler> handler)
+					{
+						if (!e)
+							cache(values.batches[i]);
+
+						clean_up(id);
+						complete_batch(e, values, i, handler);
+					}
+
 					template <typename T, typename Handler>
 					void handle_remote_value_get(const boost::system::error_code& e,
 									network::identifier id,
@@ -285,6 +415,7 @@ namespace hyper {
 							value.value = boost::none;
 							a.logger(WARNING) << "Failed to get the value of " << value.ans.var_name << std::endl;
 						} else { 
+							cache(value.src, value.ans);
 							value.value = network::deserialize_value<T>(value.ans.value);
 						}
 
@@ -301,8 +432,16 @@ namespace hyper {
 								   T & output,
 								   Handler handler)
 					{
+						boost::optional<std::string> v = cached(actor_dst, var_name);
+						if (v) {
+							output = network::deserialize_value<typename T::value_type>(*v);
+							post(boost::bind<void>(handler, boost::system::error_code()));
+							return;
+						}
+
 						void (remote_proxy::*f)(const boost::system::error_code&,
 								network::identifier,
+								const std::string&,
 								T& output,
 								boost::tuple<Handler> handler) =
 							&remote_proxy::template handle_get<T, Handler>;
@@ -311,6 +450,7 @@ namespace hyper {
 						async_ask(actor_dst, msg, ans, 
 										boost::bind(f, this,
 												    boost::asio::placeholders::error, _2,
+													actor_dst,
 													boost::ref(output),
 													boost::make_tuple(handler)));
 					}
@@ -318,6 +458,14 @@ namespace hyper {
 					template <typename T, typename Handler>
 					void async_get(remote_value<T>& value, Handler handler)
 					{
+						boost::optional<std::string> v = cached(value.src, value.msg.var_name);
+						if (v) {
+							value.terminated = true;
+							value.value = network::deserialize_value<T>(*v);
+							post(boost::bind<void>(handler, boost::system::error_code()));
+							return;
+						}
+
 						void (remote_proxy::*f)(const boost::system::error_code&,
 								network::identifier,
 								remote_value<T>& output,
@@ -331,45 +479,79 @@ namespace hyper {
 											boost::make_tuple(handler)));
 					}
 
+					/*
+					 * Read all the variables of values, with one
+					 * request_variable_values by remote agent. Agents whose
+					 * variables are all in the cache are not asked.
+					 */
 					template <typename vectorT, typename Handler>
 					void async_get(remote_values<vectorT>& values, Handler handler)
 					{
 						values.reset();
 						void (remote_proxy::*f)(const boost::system::error_code&,
+									network::identifier,
 									remote_values<vectorT>& values, 
+									size_t,
 									boost::tuple<Handler> handler)
-							= & remote_proxy::template handle_remote_values_get<vectorT, Handler>;
-
-						details::remote_value_async_get<
-											   typename remote_values<vectorT>::tupleT,
-											   boost::function<void (const boost::system::error_code&)>
-											   > async_get_(*this, values.values, 
-									boost::bind(f, this, boost::asio::placeholders::error,
-														 boost::ref(values),
+							= & remote_proxy::template handle_remote_batch_get<vectorT, Handler>;
+						void (remote_proxy::*complete)(const boost::system::error_code&,
+									remote_values<vectorT>& values, 
+									size_t,
+									boost::tuple<Handler> handler)
+							= & remote_proxy::template complete_batch<vectorT, Handler>;
+
+						for (size_t i = 0; i < values.batches.size(); ++i) {
+							remote_batch& batch = values.batches[i];
+							if (get_cached(batch)) {
+								post(boost::bind(complete, this, boost::system::error_code(),
+												 boost::ref(values), i,
+												 boost::make_tuple(handler)));
+								continue;
+							}
+							async_ask(batch.src, batch.msg, batch.ans,
+									boost::bind(f, this, boost::asio::placeholders::error, _2,
+														 boost::ref(values), i,
 														 boost::make_tuple(handler)));
-						boost::mpl::for_each<typename remote_values<vectorT>::range> (async_get_);
+						}
 					}
 			};
 
-			namespace details {
-				template <typename tupleT, typename Handler>
-				struct remote_value_async_get
-				{
-					remote_proxy& proxy;
-					tupleT& t;
-					Handler handler;
+			/*
+			 * Collect the remote variables read while evaluating the
+			 * arguments of a function, and fetch them with one
+			 * request_variable_values by remote agent when flush() is
+			 * called. It must be owned by a boost::shared_ptr.
+			 */
+			class remote_batch_reader :
+				public boost::enable_shared_from_this<remote_batch_reader>
+			{
+				public:
+					typedef boost::function<void (const boost::system::error_code&,
+												  const network::variable_value&)> cb_type;
 
-					remote_value_async_get(remote_proxy& proxy, tupleT& t, Handler handler) : 
-						proxy(proxy), t(t), handler(handler)
-					{}
+				private:
+					struct batch {
+						network::request_variable_values msg;
+						network::variable_values ans;
+						std::vector<cb_type> cbs;
+					};
+
+					typedef std::map<std::string, batch> map_type;
+					map_type batches;
+					model::ability& a;
 
-					template <typename U>
-					void operator() (U)
-					{
-						proxy.async_get(boost::get<U::value>(t), handler);
-					}
-				};
-			}
+					void handle_get(const boost::system::error_code& e,
+									network::identifier id,
+									const std::string& dst);
+
+				public:
+					remote_batch_reader(model::ability& a);
+
+					void add(const std::string& dst, const std::string& var_name,
+							 cb_type cb);
+
+					void flush();
+			};
 	}
 }
 
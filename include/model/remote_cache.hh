@@ -0,0 +1,66 @@
+#ifndef HYPER_MODEL_REMOTE_CACHE_HH_
+#define HYPER_MODEL_REMOTE_CACHE_HH_
+
+#include <map>
+#include <string>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/optional/optional.hpp>
+
+namespace hyper {
+	namespace model {
+
+		/*
+		 * Cache of the values read from other agents, keyed by (agent,
+		 * variable). A variable is only cached if a lease has been declared
+		 * for it with set_lease : while its lease runs, the last value read
+		 * is served locally instead of asking the remote agent again.
+		 *
+		 * Values are kept serialized, as received from the network.
+		 */
+		class remote_value_cache {
+			private:
+				struct entry {
+					boost::posix_time::time_duration lease;
+					boost::optional<std::string> value;
+					boost::posix_time::ptime date;
+				};
+
+				typedef std::pair<std::string, std::string> key;
+				typedef std::map<key, entry> map_type;
+
+				map_type entries;
+				size_t hits_;
+				size_t misses_;
+
+			public:
+				remote_value_cache();
+
+				/*
+				 * Accept values of agent::var_name up to lease old. A null
+				 * lease disables the cache for this variable.
+				 */
+				void set_lease(const std::string& agent, const std::string& var_name,
+							   boost::posix_time::time_duration lease);
+
+				/* Return the cached value, if it is still valid */
+				boost::optional<std::string> get(const std::string& agent,
+												 const std::string& var_name);
+
+				/* Store a fresh value, if agent::var_name has a lease */
+				void put(const std::string& agent, const std::string& var_name,
+						 const std::string& value);
+
+				/* Forget all the values of agent */
+				void invalidate(const std::string& agent);
+
+				size_t hits() const { return hits_; }
+				size_t misses() const { return misses_; }
+
+				/* Ratio of reads of leased variables served by the cache */
+				double hit_rate() const;
+		};
+	}
+}
+
+#endif /* HYPER_MODEL_REMOTE_CACHE_HH_ */
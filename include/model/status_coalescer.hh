@@ -0,0 +1,74 @@
+#ifndef HYPER_MODEL_STATUS_COALESCER_HH_
+#define HYPER_MODEL_STATUS_COALESCER_HH_
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/function/function1.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <network/msg_constraint.hh>
+
+namespace hyper {
+	namespace model {
+
+		/*
+		 * Coalesce the status updates of the constraints we execute for
+		 * other agents. Updates are queued, and sent together at the end
+		 * of the current turn of the io_service (or after window, if not
+		 * null). Meanwhile, a new non-terminal state (INIT, RUNNING,
+		 * PAUSED, TEMP_FAILURE) of a constraint replaces its queued one,
+		 * so a flapping constraint doesn't flood its requester. Terminal
+		 * states (SUCCESS, FAILURE, INTERRUPTED) are never dropped, and
+		 * all updates are sent in the order of their first occurrence.
+		 */
+		class status_coalescer : private boost::noncopyable
+		{
+			public:
+				typedef boost::function<void (const network::request_constraint_answer&)> send_cb;
+
+			private:
+				typedef std::list<network::request_constraint_answer> queue;
+				typedef std::pair<std::string, network::identifier> key;
+				typedef std::map<key, queue::iterator> index_map;
+
+				boost::asio::io_service& io_s;
+				boost::asio::deadline_timer timer;
+				boost::posix_time::time_duration window;
+				send_cb cb;
+
+				queue pending;
+				/* queued non-terminal update of each constraint */
+				index_map index;
+				bool flush_scheduled;
+				size_t coalesced_;
+
+				void handle_timeout(const boost::system::error_code& e);
+
+			public:
+				status_coalescer(boost::asio::io_service& io_s, send_cb cb,
+								 boost::posix_time::time_duration window =
+									boost::posix_time::time_duration());
+
+				static bool is_terminal(network::request_constraint_answer::state_ s);
+
+				void push(const network::request_constraint_answer& ans);
+
+				/* Send all the queued updates now */
+				void flush();
+
+				/* Drop the queued updates for agent (it is dead) */
+				void invalidate(const std::string& agent);
+
+				/* Number of updates replaced by a more recent one */
+				size_t coalesced() const { return coalesced_; }
+
+				size_t size() const { return pending.size(); }
+		};
+	}
+}
+
+#endif /* HYPER_MODEL_STATUS_COALESCER_HH_ */
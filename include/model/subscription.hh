@@ -0,0 +1,145 @@
+#ifndef HYPER_MODEL_SUBSCRIPTION_HH_
+#define HYPER_MODEL_SUBSCRIPTION_HH_
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <network/msg_proxy.hh>
+#include <network/types.hh>
+
+#include <boost/function/function0.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace hyper {
+	namespace model {
+		struct ability;
+
+		/*
+		 * Serve the subscribe_variable requests received by the ability.
+		 * Each subscribed variable is sampled locally every period, and a
+		 * variable_update is pushed to the subscriber only when its value
+		 * changed (or moved more than the deadband for numeric variables).
+		 */
+		class variable_publisher {
+			public:
+				struct subscription;
+
+			private:
+				typedef std::pair<std::string, network::identifier> key;
+				typedef std::map<key, boost::shared_ptr<subscription> > map_type;
+
+				map_type subs;
+				ability& a;
+
+				void sample(boost::shared_ptr<subscription> sub);
+				void handle_update(const boost::system::error_code& e,
+								   boost::shared_ptr<subscription> sub);
+				void handle_timeout(const boost::system::error_code& e,
+									boost::shared_ptr<subscription> sub);
+				void erase(map_type::iterator it);
+
+			public:
+				variable_publisher(ability& a);
+
+				void subscribe(const network::subscribe_variable& s);
+				void unsubscribe(const network::unsubscribe_variable& s);
+
+				/* Drop all the subscriptions of a dead agent */
+				void remove_subscriber(const std::string& agent);
+
+				/* Drop all the subscriptions */
+				void stop();
+
+				size_t size() const { return subs.size(); }
+
+				~variable_publisher();
+		};
+
+		/*
+		 * Subscriptions of the ability to remote variables. Several
+		 * watchers of the same variable, with the same parameters, share
+		 * one remote subscription. Watchers are called each time the
+		 * remote agent pushes a new value.
+		 *
+		 * A subscription lost with its agent, or whose request can't be
+		 * written, is sent again when the agent (re)appears, or on the
+		 * next watch of the variable.
+		 */
+		class variable_subscriber {
+			public:
+				typedef boost::function<void ()> cb_type;
+
+			private:
+				struct key {
+					std::string agent;
+					std::string var_name;
+					double period;
+					double deadband;
+
+					bool operator < (const key& k) const;
+				};
+
+				struct remote_subscription {
+					network::identifier id;
+					bool subscribed;
+					bool confirmed; /* a value has been pushed since the subscription */
+					std::set<network::identifier> watchers;
+
+					remote_subscription() : id(0), subscribed(false), confirmed(false) {}
+				};
+
+				struct watcher {
+					key k;
+					cb_type cb;
+				};
+
+				typedef std::map<key, remote_subscription> subscription_map;
+				typedef std::map<network::identifier, watcher> watcher_map;
+				typedef std::map<std::pair<std::string, network::identifier>, key> id_map;
+
+				subscription_map subs;
+				watcher_map watchers;
+				id_map by_id;
+				network::identifier next_watcher;
+				ability& a;
+
+				void subscribe(const key& k, remote_subscription& sub);
+				void unsubscribe(const key& k, remote_subscription& sub);
+				void handle_subscribe(const boost::system::error_code& e,
+									  network::subscribe_variable* s, key k);
+				void notify(const key& k);
+
+			public:
+				variable_subscriber(ability& a);
+
+				/*
+				 * Call cb each time var_name of agent changes, until
+				 * unwatch(returned id) is called
+				 */
+				network::identifier watch(const std::string& agent, const std::string& var_name,
+										  double period, double deadband, cb_type cb);
+				void unwatch(network::identifier id);
+
+				/*
+				 * true if the agent has pushed a value of the variable of
+				 * watcher id since the last subscription, so it will push
+				 * the next changes
+				 */
+				bool confirmed(network::identifier id) const;
+
+				void handle_update(const network::variable_update& u);
+
+				/* The agent is dead, wake up its watchers */
+				void remove_agent(const std::string& agent);
+
+				/* The agent is (back) in the system, subscribe again to its variables */
+				void add_agent(const std::string& agent);
+
+				size_t size() const { return subs.size(); }
+		};
+	}
+}
+
+#endif /* HYPER_MODEL_SUBSCRIPTION_HH_ */
@@ -0,0 +1,67 @@
+#ifndef HYPER_MODEL_WORKER_POOL_HH_
+#define HYPER_MODEL_WORKER_POOL_HH_
+
+#include <boost/asio/io_service.hpp>
+#include <boost/function/function0.hpp>
+#include <boost/function/function1.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace hyper {
+	namespace model {
+
+		/*
+		 * Pool of threads used to run user functions outside of the main
+		 * io_service of the ability. The state of the ability is still only
+		 * accessed by the thread running the main io_service : a job must
+		 * only touch its own data, its completion handler is posted back to
+		 * the io_service which submitted it.
+		 *
+		 * Without any thread (the default), jobs are run inline.
+		 */
+		class worker_pool : public boost::noncopyable
+		{
+			public:
+				typedef boost::function<void ()> job_type;
+				typedef boost::function<void (const boost::system::error_code&)> handler_type;
+
+			private:
+				boost::asio::io_service io_s;
+				boost::scoped_ptr<boost::asio::io_service::work> work;
+				boost::thread_group threads;
+				size_t size_;
+
+				void do_job(job_type job, handler_type handler,
+							boost::asio::io_service& origin,
+							boost::shared_ptr<boost::asio::io_service::work>);
+
+			public:
+				worker_pool();
+
+				/* Start @nb_threads threads, only meaningful once */
+				void start(size_t nb_threads);
+
+				/* Wait for the completion of current jobs and join the threads */
+				void stop();
+
+				size_t size() const { return size_; }
+
+				/*
+				 * Run job on a worker thread, then post handler on origin.
+				 * origin is kept busy (its run() does not return) until
+				 * handler has been posted. If job throws, handler receives
+				 * exec_layer_error::execution_failed instead of the
+				 * exception escaping from the worker thread.
+				 */
+				void async_run(job_type job, handler_type handler,
+							   boost::asio::io_service& origin);
+
+				~worker_pool();
+		};
+	}
+}
+
+#endif /* HYPER_MODEL_WORKER_POOL_HH_ */
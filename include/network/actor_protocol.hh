@@ -11,20 +11,80 @@
 #include <boost/mpl/find.hpp>
 #include <boost/mpl/vector.hpp>
 #include <boost/mpl/void.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/variant/variant.hpp>
 #include <boost/variant/get.hpp>
 
 #include <network/client_tcp_impl.hh>
 #include <network/log_level.hh>
+#include <network/msg_constraint.hh>
 #include <network/nameserver.hh>
+#include <network/protocol_error.hh>
+#include <network/timer_wheel.hh>
 #include <network/types.hh>
 
 namespace hyper {
 	namespace network {
-		/* InputM is a mpl sequence of acceptable input type */
+		/*
+		 * True if the answer t tells that the request is still executing on
+		 * a live peer : its end may take any time, so it must not time out.
+		 * A repeated request goes on after its SUCCESS and TEMP_FAILURE
+		 * answers, and only stays silent while its constraint holds.
+		 */
+		template <typename T>
+		bool request_in_progress(const T&, bool /* repeat */) { return false; }
+
+		inline
+		bool request_in_progress(const request_constraint_answer& ans, bool repeat)
+		{
+			switch (ans.state) {
+				case request_constraint_answer::RUNNING:
+				case request_constraint_answer::PAUSED:
+					return true;
+				case request_constraint_answer::FAILURE:
+				case request_constraint_answer::INTERRUPTED:
+					return false;
+				default:
+					return repeat;
+			}
+		}
+
+		/* True if the request t goes on after its first answers (ensure) */
+		template <typename T>
+		bool request_repeated(const T&) { return false; }
+
+		inline
+		bool request_repeated(const request_constraint& r) { return r.repeat; }
+
+		inline
+		bool request_repeated(const request_constraint2& r) { return r.repeat; }
+
+		/* True if the request t is stopped on the peer by an abort message */
+		template <typename T>
+		bool request_abortable(const T&) { return false; }
+
+		inline
+		bool request_abortable(const request_constraint&) { return true; }
+
+		inline
+		bool request_abortable(const request_constraint2&) { return true; }
+
+		/*
+		 * InputM is a mpl sequence of acceptable input type
+		 *
+		 * If built with an io_service, requests can be given a deadline :
+		 * if no answer is triggered before it, the callback is called with
+		 * protocol_error::request_timeout, after the on_timeout function
+		 * of the request, which can abort it on the peer. Each answer
+		 * re-arms the deadline, for requests with several answers, except
+		 * answers telling the request is in progress (see
+		 * request_in_progress), which disarm it : the death of the peer is
+		 * then reported through cancel().
+		 */
 		template <typename InputM>
-		class callback_database 
+		class callback_database : private boost::noncopyable
 		{
 			public:
 				typedef boost::function<void (const boost::system::error_code&)> fun_cb;
@@ -36,6 +96,9 @@ namespace hyper {
 					fun_cb cb;
 					msg_variant input;
 					std::string actor_dst;
+					boost::posix_time::time_duration deadline;
+					bool repeat;
+					cb_end on_timeout;
 				};
 
 				typedef std::set<identifier> set_id;
@@ -44,8 +107,31 @@ namespace hyper {
 				std::map<std::string, set_id> id_by_actor;
 				typedef typename std::map<identifier, cb_info>::iterator iterator;
 
+				boost::shared_ptr<timer_wheel> deadlines;
+				boost::posix_time::time_duration default_deadline_;
+
+				void timeout_helper(identifier id)
+				{
+					iterator it = map_cb.find(id);
+					if (it == map_cb.end())
+						return;
+
+					/* nobody will wait for it anymore, don't let it run */
+					if (it->second.on_timeout)
+						it->second.on_timeout();
+					it->second.cb(make_error_code(protocol_error::request_timeout));
+				}
+
+				void arm(identifier id, boost::posix_time::time_duration deadline)
+				{
+					if (deadlines && !deadline.is_special())
+						deadlines->schedule(id, deadline);
+				}
+
 				void cancel_helper(identifier id)
 				{
+					if (deadlines)
+						deadlines->cancel(id);
 					map_cb[id].cb(boost::asio::error::connection_reset);
 				}
 
@@ -55,14 +141,58 @@ namespace hyper {
 				}
 
 			public:
+				callback_database() : default_deadline_(boost::posix_time::pos_infin) {}
+
+				callback_database(boost::asio::io_service& io_s,
+								  boost::posix_time::time_duration tick =
+									boost::posix_time::milliseconds(100)) :
+					default_deadline_(boost::posix_time::pos_infin)
+				{
+					deadlines = boost::make_shared<timer_wheel>(boost::ref(io_s),
+							boost::bind(&callback_database::timeout_helper, this, _1),
+							tick);
+				}
+
+				/* Deadline of the requests added without explicit deadline */
+				void set_default_deadline(boost::posix_time::time_duration deadline)
+				{
+					default_deadline_ = deadline;
+				}
+
+				boost::posix_time::time_duration default_deadline() const
+				{
+					return default_deadline_;
+				}
+
 				void add(const std::string& actor, identifier id, fun_cb cb)
+				{
+					add(actor, id, cb, default_deadline_);
+				}
+
+				/*
+				 * repeat tells the request goes on after its first
+				 * answers (see request_in_progress). on_timeout is called
+				 * when the deadline expires, before cb.
+				 */
+				void add(const std::string& actor, identifier id, fun_cb cb,
+						 boost::posix_time::time_duration deadline,
+						 bool repeat = false, cb_end on_timeout = cb_end())
 				{
 					cb_info info;
 					info.cb = cb;
 					info.actor_dst = actor;
+					info.deadline = deadline;
+					info.repeat = repeat;
+					info.on_timeout = on_timeout;
 
 					map_cb[id] = info;
 					id_by_actor[actor].insert(id);
+					arm(id, deadline);
+				}
+
+				bool contains(identifier id) const
+				{
+					return map_cb.find(id) != map_cb.end();
 				}
 				
 				template <typename T>
@@ -76,6 +206,12 @@ namespace hyper {
 					iterator it = map_cb.find(id);
 					if (it != map_cb.end()) {
 						it->second.input = input;
+						if (request_in_progress(input, it->second.repeat)) {
+							if (deadlines)
+								deadlines->cancel(id);
+						} else {
+							arm(id, it->second.deadline);
+						}
 						it->second.cb(boost::system::error_code());
 					} else {
 						std::ostringstream oss; 
@@ -104,6 +240,8 @@ namespace hyper {
 
 					if (it != map_cb.end()) {
 						id_by_actor[it->second.actor_dst].erase(id);
+						if (deadlines)
+							deadlines->cancel(id);
 						remove_helper(id);
 					} else {
 						std::ostringstream oss; 
@@ -129,8 +267,8 @@ namespace hyper {
 		 *	- a boost::asio::io_service io_s, running
 		 *	- a method identifier gen_identifier()
 		 *	- a callback_database db to deal with async request
-		 *	- a resolver name_client
-		 *	- a logger logger
+		 *	- a resolver name_client, with async_resolve and invalidate
+		 *	- a logger logger, and log_enabled(level) to use it with HYPER_LOG
 		 */
 
 		template <typename Input>
@@ -152,8 +290,14 @@ namespace hyper {
 			boost::mpl::void_ operator() (const T& t) const
 			{
 				identifier id = t.id;
-				actor.logger(DEBUG_PROTOCOL) << actor_identifier(t);
-				actor.logger(DEBUG_PROTOCOL) << " triggered" << std::endl;
+				/* the request may have timed out, or its agent be dead */
+				if (!actor.db.contains(id)) {
+					HYPER_LOG(actor, DEBUG_PROTOCOL) << actor_identifier(t);
+					HYPER_LOG(actor, DEBUG_PROTOCOL) << " late answer, dropped" << std::endl;
+					return boost::mpl::void_();
+				}
+				HYPER_LOG(actor, DEBUG_PROTOCOL) << actor_identifier(t);
+				HYPER_LOG(actor, DEBUG_PROTOCOL) << " triggered" << std::endl;
 				actor.db.trigger(id, t);
 				return boost::mpl::void_();
 			}
@@ -164,10 +308,11 @@ namespace hyper {
 		{
 			private:
 				Actor& actor;
-				tcp::client<boost::mpl::vector<> > c_;
+				tcp::client<boost::mpl::vector<>, stream_protocol> c_;
 				bool connected;
 				std::string actor_dst;
 				name_resolve solver;
+				std::vector<stream_protocol::endpoint> endpoints;
 
 				template <typename Input, typename Handler>
 				void handle_basic_write(const boost::system::error_code& e,
@@ -191,28 +336,46 @@ namespace hyper {
 				{
 					if (e)
 					{
-						actor.logger(DEBUG_PROTOCOL) << "[" << actor.name << ", " << id;
-						actor.logger(DEBUG_PROTOCOL) << "] Writing failed " << e << std::endl;
+						HYPER_LOG(actor, DEBUG_PROTOCOL) << "[" << actor.name << ", " << id;
+						HYPER_LOG(actor, DEBUG_PROTOCOL) << "] Writing failed " << e << std::endl;
 						boost::get<0>(handler) (e, id);
 					}
 				}
 
+				static void handle_abort(const boost::system::error_code&,
+										 boost::shared_ptr<network::abort> msg)
+				{
+					/* release the message, the request has timed out anyway */
+					(void) msg;
+				}
+
+				/* Stop the request id on the peer */
+				void abort_request(identifier id)
+				{
+					HYPER_LOG(actor, DEBUG_PROTOCOL) << "[" << actor.name << ", " << id;
+					HYPER_LOG(actor, DEBUG_PROTOCOL) << "] Timed out, aborting " << std::endl;
+					boost::shared_ptr<network::abort> msg =
+						boost::make_shared<network::abort>(actor.name, id);
+					async_write(*msg, boost::bind(&actor_client::handle_abort,
+												  boost::asio::placeholders::error, msg));
+				}
+
 				template <typename Output, typename Handler>
 				void handle_request(const boost::system::error_code& err,
 									 identifier id,
 									 Output& output,
 									 boost::tuple<Handler> handler)
 				{
-					actor.logger(DEBUG_PROTOCOL) << "[" << actor.name << ", " << id;
-					actor.logger(DEBUG_PROTOCOL) << "] Callback called " << std::endl;
+					HYPER_LOG(actor, DEBUG_PROTOCOL) << "[" << actor.name << ", " << id;
+					HYPER_LOG(actor, DEBUG_PROTOCOL) << "] Callback called " << std::endl;
 					boost::system::error_code e = err;
 					if (!err) {
 						try {
 							output =  actor.db.template get_input<Output>(id);
 						} catch (const boost::bad_get&)
 						{
-							actor.logger(DEBUG_PROTOCOL) << "[" << actor.name << ", " << id;
-							actor.logger(DEBUG_PROTOCOL) << "] Callback invalid answer " << std::endl;
+							HYPER_LOG(actor, DEBUG_PROTOCOL) << "[" << actor.name << ", " << id;
+							HYPER_LOG(actor, DEBUG_PROTOCOL) << "] Callback invalid answer " << std::endl;
 							e  = boost::asio::error::invalid_argument;
 						}
 					}
@@ -239,9 +402,20 @@ namespace hyper {
 									boost::tuple<Handler> handler)
 				{
 					if (e) {
+						/*
+						 * The resolved address may be stale (the agent
+						 * restarted and registered again), ask the name
+						 * server once more
+						 */
+						actor.name_client.invalidate(actor_dst);
+						if (first_try) {
+							close();
+							return async_write_(input, false, handler);
+						}
 						boost::get<0>(handler)(e);
 					} else {
 						connected=true;
+						c_.async_read_hello();
 						write (input, first_try, handler);
 					}
 				}
@@ -261,7 +435,8 @@ namespace hyper {
 								boost::tuple<Handler>) =
 							&actor_client::template handle_connect<Input, Handler>;
 
-						c_.async_connect(solver.endpoints(), 
+						endpoints = solver.preferred_endpoints();
+						c_.async_connect(endpoints, 
 							boost::bind(f, this, 
 										boost::asio::placeholders::error, 
 										boost::cref(input),
@@ -307,6 +482,18 @@ namespace hyper {
 				template <typename Input, typename Output, typename Handler>
 				identifier async_request(const Input& input, 
 								   Output& output, Handler handler)
+				{
+					return async_request(input, output, handler, actor.db.default_deadline());
+				}
+
+				/*
+				 * If no answer is received before deadline, handler is
+				 * called with protocol_error::request_timeout
+				 */
+				template <typename Input, typename Output, typename Handler>
+				identifier async_request(const Input& input, 
+								   Output& output, Handler handler,
+								   boost::posix_time::time_duration deadline)
 				{
 					input.id = actor.gen_identifier();
 					input.src = actor.name;
@@ -324,14 +511,19 @@ namespace hyper {
 							boost::tuple<Handler>)
 						= &actor_client::template handle_request<Output, Handler>;
 
+					boost::function<void (void)> on_timeout;
+					if (request_abortable(input))
+						on_timeout = boost::bind(&actor_client::abort_request, this, input.id);
+
 					actor.db.add(actor_dst, input.id, 
 								 boost::bind(request_cb,
 											 this, 
 											 boost::asio::placeholders::error,
 											 input.id, boost::ref(output),
-											 boost::make_tuple(handler)));
+											 boost::make_tuple(handler)),
+								 deadline, request_repeated(input), on_timeout);
 
-					actor.logger(DEBUG_PROTOCOL) << actor_identifier(input) << " Writing " << std::endl;
+					HYPER_LOG(actor, DEBUG_PROTOCOL) << actor_identifier(input) << " Writing " << std::endl;
 					async_write(input, boost::bind(write_cb,
 												 this, 
 												 boost::asio::placeholders::error,
@@ -359,8 +551,34 @@ namespace hyper {
 				Actor &actor;
 				db_type db;
 
+				static void handle_broadcast(const boost::system::error_code&,
+											 boost::shared_ptr<const encoded_message> msg)
+				{
+					/* release the reference of this write on msg */
+					(void) msg;
+				}
+
 			public:
 				actor_client_database(Actor & actor_) : actor(actor_) {}
+
+				/*
+				 * Write @t to each actor named in [@begin, @end). @t is
+				 * encoded only once, whatever the number of actors. As for
+				 * a single async_write without handler, failures are
+				 * ignored.
+				 */
+				template <typename T, typename Iterator>
+				void broadcast(const T& t, Iterator begin, Iterator end)
+				{
+					if (begin == end)
+						return;
+
+					boost::shared_ptr<const encoded_message> msg = encode_message(t);
+					for (; begin != end; ++begin)
+						(*this)[*begin].async_write(*msg,
+								boost::bind(&actor_client_database::handle_broadcast,
+											boost::asio::placeholders::error, msg));
+				}
 				actor_client<Actor>& operator[](const std::string& s)
 				{
 					iterator it = db.find(s);
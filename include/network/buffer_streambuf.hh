@@ -0,0 +1,85 @@
+#ifndef _HYPER_NETWORK_BUFFER_STREAMBUF_HH_
+#define _HYPER_NETWORK_BUFFER_STREAMBUF_HH_
+
+#include <streambuf>
+#include <vector>
+
+namespace hyper {
+	namespace network {
+
+		/*
+		 * Output streambuf writing directly in a std::vector<char>, so the
+		 * archive result can be handed to asio without going through
+		 * std::ostringstream::str().
+		 *
+		 * The put area starts small, and grows in overflow(), inside the
+		 * capacity of a recycled vector first : it doesn't allocate
+		 * again, and only the bytes around the message are initialised,
+		 * whatever the capacity. Call finish() once the serialization is
+		 * done, to shrink the vector to the bytes really written.
+		 */
+		class vector_ostreambuf : public std::streambuf
+		{
+			private:
+				std::vector<char>& v_;
+
+				enum { min_size = 256 };
+
+				void reset_put_area(std::size_t used)
+				{
+					char* begin = v_.empty() ? 0 : &v_[0];
+					setp(begin, begin + v_.size());
+					pbump(static_cast<int>(used));
+				}
+
+			public:
+				explicit vector_ostreambuf(std::vector<char>& v) : v_(v)
+				{
+					v_.resize(min_size);
+					reset_put_area(0);
+				}
+
+				/* Number of bytes written since the construction */
+				std::size_t size() const { return pptr() - pbase(); }
+
+				void finish()
+				{
+					std::size_t used = size();
+					v_.resize(used);
+					reset_put_area(used);
+				}
+
+			protected:
+				int_type overflow(int_type c)
+				{
+					std::size_t used = size();
+					v_.resize(2 * v_.size());
+					reset_put_area(used);
+
+					if (traits_type::eq_int_type(c, traits_type::eof()))
+						return traits_type::not_eof(c);
+
+					*pptr() = traits_type::to_char_type(c);
+					pbump(1);
+					return c;
+				}
+		};
+
+		/*
+		 * Input streambuf reading from an existing range of memory, without
+		 * copying it. The range must stay valid while the streambuf is
+		 * used.
+		 */
+		class array_istreambuf : public std::streambuf
+		{
+			public:
+				array_istreambuf(const char* data, std::size_t size)
+				{
+					char* p = const_cast<char*>(data);
+					setg(p, p, p + size);
+				}
+		};
+	}
+}
+
+#endif /* _HYPER_NETWORK_BUFFER_STREAMBUF_HH_ */
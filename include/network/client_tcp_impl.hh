@@ -11,10 +11,18 @@ namespace hyper {
 	namespace network {
 		namespace tcp {
 
-			template <typename OutputM>
+			/*
+			 * @OutputM is the mpl::vector of messages expected in answer.
+			 * @Protocol is the asio stream protocol used to reach the server.
+			 * The methods taking an address and a port as string are only
+			 * usable with ip::tcp.
+			 */
+			template <typename OutputM, typename Protocol = boost::asio::ip::tcp>
 			class client 
 			{
 				public:
+					typedef typename Protocol::endpoint endpoint_type;
+
 					explicit client(boost::asio::io_service& io_service):
 						resolver_(io_service),
 						socket_(io_service),
@@ -78,14 +86,14 @@ namespace hyper {
 					}
 
 					template <typename Handler>
-					void async_connect(const boost::asio::ip::tcp::endpoint& endpoint, 
+					void async_connect(const endpoint_type& endpoint, 
 									   Handler handler)
 					{
 						socket_.socket().async_connect(endpoint, handler);
 					}
 
 					template <typename Handler>
-					void async_connect(const std::vector<boost::asio::ip::tcp::endpoint>& endpoints,
+					void async_connect(const std::vector<endpoint_type>& endpoints,
 									   Handler handler)
 					{
 						if (endpoints.empty()) 
@@ -94,17 +102,17 @@ namespace hyper {
 
 						void (client::*f)(
 								const boost::system::error_code& e,
-								std::vector<boost::asio::ip::tcp::endpoint>::const_iterator,
-								std::vector<boost::asio::ip::tcp::endpoint>::const_iterator,
+								typename std::vector<endpoint_type>::const_iterator,
+								typename std::vector<endpoint_type>::const_iterator,
 								boost::tuple<Handler>)
 							= &client::template handle_connect<Handler>;
 
-						boost::asio::ip::tcp::endpoint endpoint = *endpoints.begin();
+						endpoint_type endpoint = *endpoints.begin();
 
 						socket_.socket().async_connect(endpoint,
 								boost::bind(f, this,
 									boost::asio::placeholders::error,
-									endpoints.begin()++, endpoints.end(),
+									endpoints.begin() + 1, endpoints.end(),
 									boost::make_tuple(handler)));
 					}
 							
@@ -113,6 +121,16 @@ namespace hyper {
 						socket_.close();
 					}
 
+					/*
+					 * For a client which only writes : read the hello of the
+					 * server, once connected, to compress the next messages
+					 * if the server accepts it.
+					 */
+					void async_read_hello()
+					{
+						socket_.async_read_hello();
+					}
+
 					/*
 					 * Send a request @in and wait for an answer @out The
 					 * method can throw a boost::system::system_error in
@@ -191,6 +209,21 @@ namespace hyper {
 													  boost::make_tuple(handler_timeout)));
 					}
 
+					/*
+					 * Wait asynchronously for the next message from the
+					 * server, and decode it in @out. With async_write, it
+					 * allows to pipeline several requests : answers must
+					 * then be read one at a time, in order.
+					 *
+					 * Handler must implement
+					 *		void (*)(const boost::system::error_code&)
+					 */
+					template <typename Output, typename Handler>
+					void async_read(Output& out, Handler handler)
+					{
+						socket_.async_read(out, handler);
+					}
+
 					/*
 					 * Send a message asynchronously @in.
 					 * On completion, @handler is called.
@@ -279,8 +312,8 @@ namespace hyper {
 
 					template <typename Handler>
 					void handle_connect(const boost::system::error_code& err,
-										std::vector<boost::asio::ip::tcp::endpoint>::const_iterator it,
-										std::vector<boost::asio::ip::tcp::endpoint>::const_iterator end,
+										typename std::vector<endpoint_type>::const_iterator it,
+										typename std::vector<endpoint_type>::const_iterator end,
 										boost::tuple<Handler> handler)
 					{
 						if (!err)
@@ -291,12 +324,12 @@ namespace hyper {
 						{
 							// The connection failed. Try the next endpoint in the list.
 							socket_.close();
-							boost::asio::ip::tcp::endpoint endpoint = *it;
+							endpoint_type endpoint = *it;
 
 							void (client::*f)(
 									const boost::system::error_code& e,
-									std::vector<boost::asio::ip::tcp::endpoint>::const_iterator,
-									std::vector<boost::asio::ip::tcp::endpoint>::const_iterator,
+									typename std::vector<endpoint_type>::const_iterator,
+									typename std::vector<endpoint_type>::const_iterator,
 									boost::tuple<Handler>)
 								= &client::template handle_connect<Handler>;
 
@@ -373,7 +406,7 @@ namespace hyper {
 
 					boost::asio::ip::tcp::resolver resolver_;
 					bool use_internal_timer_;
-					serialized_socket<OutputM> socket_;
+					serialized_socket<OutputM, Protocol> socket_;
 					boost::asio::deadline_timer timer_;
 			};
 		}
@@ -0,0 +1,523 @@
+#ifndef HYPER_NETWORK_COMPACT_ARCHIVE_HH_
+#define HYPER_NETWORK_COMPACT_ARCHIVE_HH_
+
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include <boost/archive/archive_exception.hpp>
+#include <boost/archive/basic_archive.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/mpl/bool.hpp>
+#include <boost/mpl/eval_if.hpp>
+#include <boost/mpl/equal_to.hpp>
+#include <boost/mpl/identity.hpp>
+#include <boost/mpl/int.hpp>
+#include <boost/serialization/array.hpp>
+#include <boost/serialization/collection_size_type.hpp>
+#include <boost/serialization/item_version_type.hpp>
+#include <boost/serialization/level.hpp>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/version.hpp>
+#include <boost/type_traits/is_enum.hpp>
+#include <boost/type_traits/is_floating_point.hpp>
+#include <boost/type_traits/is_signed.hpp>
+
+namespace hyper {
+	namespace network {
+		/*
+		 * A compact binary archive, for message exchanged between agents.
+		 *
+		 * Contrary to boost binary archives, there is no archive header, no
+		 * class information, and no object tracking : the structure of the
+		 * data is given by the serialize method of each type, which must be
+		 * the same on both sides, so only values go on the wire :
+		 *   - a version byte at the start of the archive
+		 *   - integers and enums as LEB128 varints (zigzag encoded if
+		 *   signed), so small values take one byte
+		 *   - bool and char as one byte
+		 *   - float and double as little-endian IEEE 754
+		 *   - strings and collections as a varint length followed by their
+		 *   elements, each taking at least one byte
+		 *
+		 * Pointers are not supported.
+		 */
+		enum { compact_archive_version = 1 };
+
+		class compact_oarchive {
+			std::streambuf& m_sb;
+
+			void put(char c)
+			{
+				if (m_sb.sputc(c) == std::streambuf::traits_type::eof())
+					throw boost::archive::archive_exception(
+							boost::archive::archive_exception::output_stream_error);
+			}
+
+			void put_varint(boost::uint64_t v)
+			{
+				while (v >= 0x80) {
+					put(static_cast<char>((v & 0x7f) | 0x80));
+					v >>= 7;
+				}
+				put(static_cast<char>(v));
+			}
+
+			void put_little_endian(boost::uint64_t v, std::size_t size)
+			{
+				for (std::size_t i = 0; i < size; ++i) {
+					put(static_cast<char>(v & 0xff));
+					v >>= 8;
+				}
+			}
+
+			template <typename T>
+			void save_arithmetic(T t, boost::mpl::true_ /* floating */, boost::mpl::false_)
+			{
+				if (sizeof(T) == sizeof(boost::uint32_t)) {
+					boost::uint32_t v;
+					std::memcpy(&v, &t, sizeof(v));
+					put_little_endian(v, sizeof(v));
+				} else {
+					double d = t;
+					boost::uint64_t v;
+					std::memcpy(&v, &d, sizeof(v));
+					put_little_endian(v, sizeof(v));
+				}
+			}
+
+			template <typename T>
+			void save_arithmetic(T t, boost::mpl::false_, boost::mpl::true_ /* signed */)
+			{
+				boost::int64_t v = t;
+				put_varint((static_cast<boost::uint64_t>(v) << 1) ^ static_cast<boost::uint64_t>(v >> 63));
+			}
+
+			template <typename T>
+			void save_arithmetic(T t, boost::mpl::false_, boost::mpl::false_)
+			{
+				put_varint(t);
+			}
+
+			struct save_enum_type
+			{
+				template<typename T>
+				static void invoke(compact_oarchive &ar, const T &t) {
+					ar << static_cast<int>(t);
+				}
+			};
+
+			struct save_primitive
+			{
+				template<typename T>
+				static void invoke(compact_oarchive & ar, const T & t) {
+					ar.save_arithmetic(t, typename boost::is_floating_point<T>::type(),
+											typename boost::is_signed<T>::type());
+				}
+			};
+
+			struct save_only
+			{
+				template<typename T>
+				static void invoke(compact_oarchive & ar, const T & t) {
+					boost::serialization::serialize_adl(
+						ar,
+						const_cast<T &>(t),
+						::boost::serialization::version< T >::value
+					);
+				}
+			};
+
+			template<typename T>
+			void save(const T &t)
+			{
+				typedef
+					BOOST_DEDUCED_TYPENAME boost::mpl::eval_if<boost::is_enum< T >,
+						boost::mpl::identity<save_enum_type>,
+					//else
+					BOOST_DEDUCED_TYPENAME boost::mpl::eval_if<
+						// if its primitive
+							boost::mpl::equal_to<
+								boost::serialization::implementation_level< T >,
+								boost::mpl::int_<boost::serialization::primitive_type>
+							>,
+							boost::mpl::identity<save_primitive>,
+					// else
+						boost::mpl::identity<save_only>
+					> >::type typex;
+				typex::invoke(*this, t);
+			}
+
+		public:
+			///////////////////////////////////////////////////
+			// Implement requirements for archive concept
+
+			typedef boost::mpl::bool_<false> is_loading;
+			typedef boost::mpl::bool_<true> is_saving;
+
+			// this can be a no-op since we ignore pointer polymorphism
+			template<typename T>
+			void register_type(const T * = NULL) {}
+
+			unsigned int get_library_version() const
+			{
+				return boost::archive::BOOST_ARCHIVE_VERSION();
+			}
+
+			void save_binary(const void *address, std::size_t count)
+			{
+				std::streamsize n = static_cast<std::streamsize>(count);
+				if (m_sb.sputn(static_cast<const char*>(address), n) != n)
+					throw boost::archive::archive_exception(
+							boost::archive::archive_exception::output_stream_error);
+			}
+
+			// the << operators
+			template<typename T>
+			compact_oarchive & operator<< (const T& t)
+			{
+				save(t);
+				return *this;
+			}
+
+			compact_oarchive & operator<< (bool b)
+			{
+				put(b ? 1 : 0);
+				return *this;
+			}
+
+			compact_oarchive & operator<< (char c)
+			{
+				put(c);
+				return *this;
+			}
+
+			compact_oarchive & operator<< (signed char c)
+			{
+				put(static_cast<char>(c));
+				return *this;
+			}
+
+			compact_oarchive & operator<< (unsigned char c)
+			{
+				put(static_cast<char>(c));
+				return *this;
+			}
+
+			compact_oarchive & operator<< (const std::string& s)
+			{
+				put_varint(s.size());
+				save_binary(s.data(), s.size());
+				return *this;
+			}
+
+			compact_oarchive & operator<< (const boost::serialization::collection_size_type& t)
+			{
+				put_varint(static_cast<std::size_t>(t));
+				return *this;
+			}
+
+			compact_oarchive & operator<< (const boost::serialization::item_version_type& t)
+			{
+				put_varint(static_cast<unsigned int>(t));
+				return *this;
+			}
+
+			template<typename T, int N>
+			compact_oarchive & operator<< (const T (&t)[N])
+			{
+				for (int i = 0; i < N; ++i)
+					*this << t[i];
+				return *this;
+			}
+
+			template<typename T>
+			compact_oarchive & operator<< (const boost::serialization::nvp< T > & t)
+			{
+				return *this << t.const_value();
+			}
+
+			// the & operator
+			template<typename T>
+			compact_oarchive & operator& (const T & t)
+			{
+				return *this << t;
+			}
+			///////////////////////////////////////////////
+
+			compact_oarchive(std::ostream & os) : m_sb(*os.rdbuf())
+			{
+				put(static_cast<char>(compact_archive_version));
+			}
+		};
+
+		class compact_iarchive {
+			std::streambuf& m_sb;
+
+			/* Largest length accepted when the size of the input is unknown */
+			enum { max_length = 64 * 1024 * 1024 };
+
+			char get()
+			{
+				std::streambuf::int_type c = m_sb.sbumpc();
+				if (c == std::streambuf::traits_type::eof())
+					throw boost::archive::archive_exception(
+							boost::archive::archive_exception::input_stream_error);
+				return std::streambuf::traits_type::to_char_type(c);
+			}
+
+			boost::uint64_t get_varint()
+			{
+				boost::uint64_t v = 0;
+				for (unsigned int shift = 0; shift < 64; shift += 7) {
+					unsigned char c = static_cast<unsigned char>(get());
+					v |= static_cast<boost::uint64_t>(c & 0x7f) << shift;
+					if (!(c & 0x80))
+						return v;
+				}
+				throw boost::archive::archive_exception(
+						boost::archive::archive_exception::input_stream_error);
+			}
+
+			boost::uint64_t get_little_endian(std::size_t size)
+			{
+				boost::uint64_t v = 0;
+				for (std::size_t i = 0; i < size; ++i)
+					v |= static_cast<boost::uint64_t>(static_cast<unsigned char>(get())) << (8 * i);
+				return v;
+			}
+
+			/* Check that the decoded value fits in T */
+			template <typename T, typename U>
+			static T checked_cast(U u)
+			{
+				T t = static_cast<T>(u);
+				if (static_cast<U>(t) != u)
+					throw boost::archive::archive_exception(
+							boost::archive::archive_exception::input_stream_error);
+				return t;
+			}
+
+			/*
+			 * Read the length of a string or of a collection, and check it
+			 * before anything is allocated for it : it can't be more than
+			 * the input left, if it is known (in memory buffers)
+			 */
+			std::size_t get_length()
+			{
+				boost::uint64_t length = get_varint();
+				std::streamsize left = m_sb.in_avail();
+				boost::uint64_t bound = left > 0 ? static_cast<boost::uint64_t>(left) : max_length;
+				if (length > bound)
+					throw boost::archive::archive_exception(
+							boost::archive::archive_exception::input_stream_error);
+				return checked_cast<std::size_t>(length);
+			}
+
+			template <typename T>
+			void load_arithmetic(T& t, boost::mpl::true_ /* floating */, boost::mpl::false_)
+			{
+				if (sizeof(T) == sizeof(boost::uint32_t)) {
+					boost::uint32_t v = static_cast<boost::uint32_t>(get_little_endian(sizeof(v)));
+					std::memcpy(&t, &v, sizeof(v));
+				} else {
+					boost::uint64_t v = get_little_endian(sizeof(v));
+					double d;
+					std::memcpy(&d, &v, sizeof(v));
+					t = static_cast<T>(d);
+				}
+			}
+
+			template <typename T>
+			void load_arithmetic(T& t, boost::mpl::false_, boost::mpl::true_ /* signed */)
+			{
+				boost::uint64_t z = get_varint();
+				boost::int64_t v = static_cast<boost::int64_t>(z >> 1) ^ -static_cast<boost::int64_t>(z & 1);
+				t = checked_cast<T>(v);
+			}
+
+			template <typename T>
+			void load_arithmetic(T& t, boost::mpl::false_, boost::mpl::false_)
+			{
+				t = checked_cast<T>(get_varint());
+			}
+
+			struct load_enum_type
+			{
+				template<typename T>
+				static void invoke(compact_iarchive &ar, T &t) {
+					int value;
+					ar >> value;
+					t = static_cast<T>(value);
+				}
+			};
+
+			struct load_primitive
+			{
+				template<typename T>
+				static void invoke(compact_iarchive & ar, T & t) {
+					ar.load_arithmetic(t, typename boost::is_floating_point<T>::type(),
+										  typename boost::is_signed<T>::type());
+				}
+			};
+
+			struct load_only
+			{
+				template<typename T>
+				static void invoke(compact_iarchive & ar, T & t) {
+					boost::serialization::serialize_adl(
+						ar,
+						t,
+						::boost::serialization::version< T >::value
+					);
+				}
+			};
+
+			template<typename T>
+			void load(T &t)
+			{
+				typedef
+					BOOST_DEDUCED_TYPENAME boost::mpl::eval_if<boost::is_enum< T >,
+						boost::mpl::identity<load_enum_type>,
+					//else
+					BOOST_DEDUCED_TYPENAME boost::mpl::eval_if<
+						// if its primitive
+							boost::mpl::equal_to<
+								boost::serialization::implementation_level< T >,
+								boost::mpl::int_<boost::serialization::primitive_type>
+							>,
+							boost::mpl::identity<load_primitive>,
+					// else
+						boost::mpl::identity<load_only>
+					> >::type typex;
+				typex::invoke(*this, t);
+			}
+
+		public:
+			///////////////////////////////////////////////////
+			// Implement requirements for archive concept
+
+			typedef boost::mpl::bool_<true> is_loading;
+			typedef boost::mpl::bool_<false> is_saving;
+
+			// this can be a no-op since we ignore pointer polymorphism
+			template<typename T>
+			void register_type(const T * = NULL) {}
+
+			// no object tracking, so nothing to do
+			void reset_object_address(const void *, const void *) {}
+
+			unsigned int get_library_version() const
+			{
+				return boost::archive::BOOST_ARCHIVE_VERSION();
+			}
+
+			void load_binary(void *address, std::size_t count)
+			{
+				std::streamsize n = static_cast<std::streamsize>(count);
+				if (m_sb.sgetn(static_cast<char*>(address), n) != n)
+					throw boost::archive::archive_exception(
+							boost::archive::archive_exception::input_stream_error);
+			}
+
+			// the >> operators
+			template<typename T>
+			compact_iarchive & operator>> (T& t)
+			{
+				load(t);
+				return *this;
+			}
+
+			compact_iarchive & operator>> (bool& b)
+			{
+				char c = get();
+				if (c != 0 && c != 1)
+					throw boost::archive::archive_exception(
+							boost::archive::archive_exception::input_stream_error);
+				b = (c == 1);
+				return *this;
+			}
+
+			compact_iarchive & operator>> (char& c)
+			{
+				c = get();
+				return *this;
+			}
+
+			compact_iarchive & operator>> (signed char& c)
+			{
+				c = static_cast<signed char>(get());
+				return *this;
+			}
+
+			compact_iarchive & operator>> (unsigned char& c)
+			{
+				c = static_cast<unsigned char>(get());
+				return *this;
+			}
+
+			compact_iarchive & operator>> (std::string& s)
+			{
+				std::size_t size = get_length();
+				s.resize(size);
+				if (size)
+					load_binary(&s[0], size);
+				return *this;
+			}
+
+			compact_iarchive & operator>> (boost::serialization::collection_size_type& t)
+			{
+				t = boost::serialization::collection_size_type(get_length());
+				return *this;
+			}
+
+			compact_iarchive & operator>> (boost::serialization::item_version_type& t)
+			{
+				t = boost::serialization::item_version_type(
+						checked_cast<unsigned int>(get_varint()));
+				return *this;
+			}
+
+			template<typename T, int N>
+			compact_iarchive & operator>> (T (&t)[N])
+			{
+				for (int i = 0; i < N; ++i)
+					*this >> t[i];
+				return *this;
+			}
+
+			template<typename T>
+			compact_iarchive & operator>> (const boost::serialization::nvp< T > & t)
+			{
+				return *this >> t.value();
+			}
+
+			// the & operator
+			template<typename T>
+			compact_iarchive & operator& (T & t)
+			{
+				return *this >> t;
+			}
+
+			template<typename T>
+			compact_iarchive & operator& (const boost::serialization::nvp< T > & t)
+			{
+				return *this >> t;
+			}
+			///////////////////////////////////////////////
+
+			compact_iarchive(std::istream & is) : m_sb(*is.rdbuf())
+			{
+				if (get() != static_cast<char>(compact_archive_version))
+					throw boost::archive::archive_exception(
+							boost::archive::archive_exception::unsupported_version);
+			}
+		};
+	}
+}
+
+#endif /* HYPER_NETWORK_COMPACT_ARCHIVE_HH_ */
@@ -0,0 +1,38 @@
+#ifndef HYPER_NETWORK_COMPRESSION_HH_
+#define HYPER_NETWORK_COMPRESSION_HH_
+
+#include <cstddef>
+#include <vector>
+
+namespace hyper {
+	namespace network {
+		/*
+		 * Optional compression of the payload of the messages, with zlib.
+		 * A socket only compresses a message if its payload is bigger than
+		 * the compression threshold, and if the peer told it is able to
+		 * decompress it (see header_accept_compressed in msg.hh). Without
+		 * zlib at build time, nothing is ever compressed.
+		 */
+
+		/* True if hyper has been built with zlib */
+		bool compression_available();
+
+		/*
+		 * Payloads smaller than threshold bytes are sent raw. 0 disables
+		 * compression for the sockets created afterwards.
+		 */
+		void set_compression_threshold(std::size_t threshold);
+		std::size_t compression_threshold();
+
+		/*
+		 * Compress in into out. Return false if compression is not
+		 * available, or is useless for this payload.
+		 */
+		bool compress_payload(const std::vector<char>& in, std::vector<char>& out);
+
+		/* Return false if data is not a valid compressed payload */
+		bool decompress_payload(const char* data, std::size_t size, std::vector<char>& out);
+	}
+}
+
+#endif /* HYPER_NETWORK_COMPRESSION_HH_ */
@@ -0,0 +1,81 @@
+#ifndef HYPER_NETWORK_FAILURE_DETECTOR_HH_
+#define HYPER_NETWORK_FAILURE_DETECTOR_HH_
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace hyper {
+	namespace network {
+
+		/*
+		 * Phi accrual failure detector (Hayashibara et al.). Instead of
+		 * a boolean, it gives for each agent a suspicion level phi, from
+		 * the distribution of the intervals between its last heartbeats
+		 * (approximated by a normal distribution). phi = 1 means a 10%
+		 * chance to be wrong when suspecting the agent, phi = 2 1%, and so
+		 * on. So the detection adapts itself to the load of each agent and
+		 * of the network.
+		 *
+		 * The first heartbeat is assumed to follow first_interval, with a
+		 * standard deviation of first_interval / 4, until the first real
+		 * interval is known. The standard deviation never goes under
+		 * min_std_deviation, to not suspect too fast very regular agents.
+		 */
+		class phi_accrual_detector
+		{
+			struct history {
+				std::deque<double> intervals; // in ms
+				double sum;
+				double sum_square;
+				boost::posix_time::ptime last;
+				bool bootstrap;
+
+				history() : sum(0), sum_square(0), bootstrap(true) {}
+			};
+
+			typedef std::map<std::string, history> history_map;
+
+			history_map agents;
+			double threshold;
+			size_t window;
+			double min_std_deviation;
+			double first_interval;
+			/* deviations from the mean of an interval for which phi = threshold */
+			double threshold_deviation;
+
+			void add_interval(history& h, double interval);
+			double mean(const history& h) const;
+			double std_deviation(const history& h) const;
+
+			public:
+				phi_accrual_detector(double threshold = 8.0, size_t window = 100,
+									 boost::posix_time::time_duration min_std_deviation =
+										 boost::posix_time::milliseconds(100),
+									 boost::posix_time::time_duration first_interval =
+										 boost::posix_time::milliseconds(500));
+
+				void heartbeat(const std::string& name, boost::posix_time::ptime now);
+
+				/* The suspicion level of name, 0 if it is not monitored */
+				double phi(const std::string& name, boost::posix_time::ptime now) const;
+
+				bool is_available(const std::string& name, boost::posix_time::ptime now) const
+				{
+					return phi(name, now) < threshold;
+				}
+
+				/*
+				 * Delay after the last heartbeat of name at which phi
+				 * reaches the threshold if nothing else is received
+				 */
+				boost::posix_time::time_duration suspicion_delay(const std::string& name) const;
+
+				void remove(const std::string& name);
+		};
+	}
+}
+
+#endif /* HYPER_NETWORK_FAILURE_DETECTOR_HH_ */
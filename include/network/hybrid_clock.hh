@@ -0,0 +1,75 @@
+#ifndef HYPER_NETWORK_HYBRID_CLOCK_HH_
+#define HYPER_NETWORK_HYBRID_CLOCK_HH_
+
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_duration.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace hyper {
+	namespace network {
+
+		/*
+		 * Hybrid logical clock timestamp : physical is close to the
+		 * wall clock (in microseconds since the epoch, UTC), logical
+		 * orders the events which share the same physical part.
+		 */
+		struct hlc_timestamp {
+			boost::int64_t physical;
+			boost::uint32_t logical;
+
+			hlc_timestamp() : physical(0), logical(0) {}
+			hlc_timestamp(boost::int64_t physical, boost::uint32_t logical) :
+				physical(physical), logical(logical) {}
+			/* The first (or last) timestamp of the universal time t */
+			explicit hlc_timestamp(boost::posix_time::ptime t, boost::uint32_t logical = 0);
+
+			boost::posix_time::ptime time() const;
+		};
+
+		inline bool operator < (const hlc_timestamp& t1, const hlc_timestamp& t2)
+		{
+			return t1.physical < t2.physical ||
+				  (t1.physical == t2.physical && t1.logical < t2.logical);
+		}
+
+		inline bool operator == (const hlc_timestamp& t1, const hlc_timestamp& t2)
+		{
+			return t1.physical == t2.physical && t1.logical == t2.logical;
+		}
+
+		/*
+		 * Hybrid logical clock of the process. Each local event, and each
+		 * message sent, gets a timestamp from now(). Each message received
+		 * moves the clock past its timestamp with update(). So if a causes
+		 * b, even on different agents, the timestamp of a is before the
+		 * one of b, whatever the skew of their wall clocks.
+		 *
+		 * As in the HLC paper, a remote physical time more than max_offset
+		 * ahead of the wall clock is not adopted (it would drag the clock of
+		 * every agent into the future), update() only ticks the local clock
+		 * and reports the skew.
+		 */
+		class hybrid_clock : private boost::noncopyable
+		{
+			boost::mutex m;
+			hlc_timestamp last;
+			boost::int64_t max_offset;
+			boost::int64_t reported_skew;
+
+			hybrid_clock();
+
+			public:
+				static hybrid_clock& instance();
+
+				hlc_timestamp now();
+
+				void update(const hlc_timestamp& remote);
+
+				void set_max_offset(const boost::posix_time::time_duration& offset);
+		};
+	}
+}
+
+#endif /* HYPER_NETWORK_HYBRID_CLOCK_HH_ */
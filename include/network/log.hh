@@ -6,10 +6,12 @@
 #include <sstream>
 #include <string>
 
+#include <network/log_level.hh>
 #include <network/msg_log.hh>
 #include <network/nameserver.hh>
 #include <network/client_tcp_impl.hh>
 
+#include <boost/asio/deadline_timer.hpp>
 #include <boost/iostreams/stream.hpp>
 #include <boost/iostreams/categories.hpp>  // sink_tag
 #include <boost/make_shared.hpp>
@@ -19,45 +21,110 @@ namespace io = boost::iostreams;
 
 namespace hyper {
 	namespace network {
+		/*
+		 * What to drop when the log queue of async_logger is full.
+		 *	- drop_oldest drops the oldest line
+		 *	- drop_by_level drops the oldest of the least important lines
+		 *	(the new one, if it is less important than all the queued ones)
+		 */
+		enum log_drop_policy { drop_oldest, drop_by_level };
+
+		/*
+		 * Send log lines to the logger agent dst. Lines are stamped and
+		 * queued in a bounded queue, and sent in batch, as one log_msgs, when
+		 * batch_lines lines are waiting or after window. Only one batch is
+		 * written at a time : if the logger is slow, or absent, lines are
+		 * dropped following policy, so logging never blocks and never
+		 * grows without bound.
+		 */
 		template <typename Resolver>
 		class async_logger
 		{
 			private:
+				struct log_line {
+					int level;
+					log_msgs::line line;
+				};
+
 				boost::asio::io_service& io_s_;
 				std::string src_;
 				std::string dst_;
 				Resolver& r_;
 				name_resolve solver;
 				bool connected;
-				tcp::client<boost::mpl::vector<log_msg> > c;
+				bool connecting;
+				bool writing;
+				tcp::client<boost::mpl::vector<log_msgs>, stream_protocol> c;
+				std::vector<stream_protocol::endpoint> endpoints;
+
+				std::deque<log_line> lines_;
+				size_t capacity_;
+				size_t batch_lines_;
+				boost::posix_time::time_duration window_;
+				log_drop_policy policy_;
+				boost::asio::deadline_timer timer_;
+				bool timer_armed;
+
+				/* number of lines dropped since the last batch, and overall */
+				size_t dropped_since_batch;
+				size_t dropped_;
 
-				std::deque<log_msg> msgs_;
+				log_msgs batch;
+				/* number of dropped lines reported by the last line of batch */
+				size_t batch_dropped;
 
 				void handle_write(const boost::system::error_code& e)
 				{
+					writing = false;
 					if (e) {
 						// XXX be more smart about real kind of error
 						c.close();
 						connected = false;
+
+						/* the batch is lost, with the drops it reported */
+						size_t lost = batch.lines.size() - (batch_dropped > 0 ? 1 : 0);
+						dropped_ += lost;
+						dropped_since_batch += lost + batch_dropped;
 					}
+					/* send what has been queued during the write */
+					if (!lines_.empty() && !timer_armed)
+						flush();
 				}
 
 				void write_log()
 				{
-					while (!msgs_.empty()) {
-						c.async_write(msgs_.front(), 
-								boost::bind(&async_logger::handle_write, this, 
-											boost::asio::placeholders::error));
-						msgs_.pop_front();
+					if (writing || lines_.empty())
+						return;
+
+					batch.src = src_;
+					batch.lines.clear();
+					for (size_t i = 0; i < lines_.size(); ++i)
+						batch.lines.push_back(lines_[i].line);
+					lines_.clear();
+
+					/* stamped now, so it comes after the lines sent with it */
+					batch_dropped = dropped_since_batch;
+					if (dropped_since_batch > 0) {
+						std::ostringstream oss;
+						oss << dropped_since_batch << " log lines dropped";
+						batch.lines.push_back(log_msgs::line(oss.str()));
+						dropped_since_batch = 0;
 					}
+
+					writing = true;
+					c.async_write(batch, 
+							boost::bind(&async_logger::handle_write, this, 
+										boost::asio::placeholders::error));
 				}
 
 				void handle_connect(const boost::system::error_code& e)
 				{
+					connecting = false;
 					if (e) {
 						// XXX what to do : log to another logger :D	
 					} else {
 						connected=true;
+						c.async_read_hello();
 						write_log();
 					}
 				}
@@ -66,36 +133,104 @@ namespace hyper {
 				{
 					if (e) {
 						// XXX what to do : log to another logger :D	
+						connecting = false;
 					} else {
-						c.async_connect(solver.endpoints(), 
+						endpoints = solver.preferred_endpoints();
+						c.async_connect(endpoints, 
 							boost::bind(&async_logger::handle_connect, this, 
 										boost::asio::placeholders::error));
 					}
 				}
 
+				void handle_timeout(const boost::system::error_code& e)
+				{
+					timer_armed = false;
+					if (!e)
+						flush();
+				}
+
+				/* Send the pending lines, or connect to the logger first */
+				void flush()
+				{
+					if (connected) {
+						write_log();
+					} else if (!connecting) {
+						connecting = true;
+						solver.name(dst_);
+						r_.async_resolve(solver,
+								boost::bind(&async_logger::handle_resolve, this,
+											 boost::asio::placeholders::error));
+					}
+				}
+
+				/* The queue is full, make room for a line of level lvl */
+				bool make_room(int lvl)
+				{
+					typename std::deque<log_line>::iterator victim = lines_.begin();
+					if (policy_ == drop_by_level) {
+						typename std::deque<log_line>::iterator it;
+						for (it = lines_.begin(); it != lines_.end(); ++it)
+							if (it->level > victim->level)
+								victim = it;
+						if (lvl > victim->level)
+							return false;
+					}
+
+					lines_.erase(victim);
+					return true;
+				}
+
 			public:
 				async_logger(boost::asio::io_service & io_s,  const std::string& srcAbility, 
-							 const std::string& loggerAbility, Resolver& r) :
+							 const std::string& loggerAbility, Resolver& r,
+							 size_t capacity = 1024,
+							 size_t batch_lines = 64,
+							 boost::posix_time::time_duration window =
+								boost::posix_time::milliseconds(100),
+							 log_drop_policy policy = drop_by_level) :
 					io_s_(io_s), src_(srcAbility), dst_(loggerAbility), r_(r),
-					connected(false), c(io_s)
+					connected(false), connecting(false), writing(false), c(io_s),
+					capacity_(capacity ? capacity : 1),
+					batch_lines_(batch_lines ? batch_lines : 1),
+					window_(window), policy_(policy), timer_(io_s), timer_armed(false),
+					dropped_since_batch(0), dropped_(0), batch_dropped(0)
 				{}
 
-				void log(const std::string& s)
+				/* Stamp and queue the line s, of level lvl (used by drop_by_level) */
+				void log(const std::string& s, int lvl = NOTHING)
 				{
-					msgs_.push_back(log_msg(src_, s));
-					if (msgs_.size() != 1)
+					log_line l;
+					l.level = lvl;
+					l.line = log_msgs::line(s);
+					if (l.line.msg.empty())
 						return;
 
-					if (!connected) {
-						solver.name(dst_);
-					
-						r_.async_resolve(solver,
-								boost::bind(&async_logger::handle_resolve, this,
-											 boost::asio::placeholders::error));
-					} else {
-						write_log();
+					if (lines_.size() >= capacity_) {
+						dropped_since_batch++;
+						dropped_++;
+						if (!make_room(l.level))
+							return;
+					}
+					lines_.push_back(l);
+
+					if (lines_.size() >= batch_lines_) {
+						flush();
+					} else if (!timer_armed) {
+						timer_armed = true;
+						timer_.expires_from_now(window_);
+						timer_.async_wait(boost::bind(&async_logger::handle_timeout, this,
+													  boost::asio::placeholders::error));
 					}
 				}
+
+				/*
+				 * Number of lines dropped because the queue was full, or
+				 * because their batch couldn't be written
+				 */
+				size_t dropped() const { return dropped_; }
+
+				/* Number of lines waiting to be sent */
+				size_t pending() const { return lines_.size(); }
 		};
 
 		namespace details {
@@ -110,25 +245,30 @@ namespace hyper {
 					}
 			};
 
+			/*
+			 * Pass the text written in the stream to remote, with the
+			 * level of the logger at the time it is written in the sink
+			 */
 			template <typename Resolver>
 			class remote_ability_sink {
 				private:
 					std::string str;
 					async_logger<Resolver> & remote_logger;
+					const int& level;
 
 				public:
 					typedef char      char_type;
 					typedef io::sink_tag  category;
 
-					remote_ability_sink(async_logger<Resolver>& remote) :
-						remote_logger(remote) 
+					remote_ability_sink(async_logger<Resolver>& remote, const int& level) :
+						remote_logger(remote), level(level)
 					{}
 
 					std::streamsize write(const char* s, std::streamsize n)
 					{
 						str.clear();
 						str.insert(0, s, n);
-						remote_logger.log(str);
+						remote_logger.log(str, level);
 						return n;
 					}
 			};
@@ -147,21 +287,33 @@ namespace hyper {
 						const std::string& src_,
 						const std::string& dst_,
 						Resolver& r,
-						int level) : level_(level),
+						int level) : level_(level), current_(NOTHING),
 									 real_(io_s, src_, dst_, r)
 				{
 					void_.open(details::void_handler());
-					out_.open(details::remote_ability_sink<Resolver> (real_));
+					out_.open(details::remote_ability_sink<Resolver> (real_, current_));
 				}
 
 				std::ostream& operator() (int lvl) {
 					if (lvl > level_)
 						return void_;
+					/* the text still buffered in out_ belongs to the previous level */
+					if (lvl != current_) {
+						out_.flush();
+						current_ = lvl;
+					}
 					return out_;
 				}
 
+				bool enabled(int lvl) const { return lvl <= level_; }
+
+				/* Number of lines dropped because the logger agent is too slow, or unreachable */
+				size_t dropped() const { return real_.dropped(); }
+
 			private:
 				int level_;
+				/* level of the text buffered in out_ */
+				int current_;
 				async_logger<Resolver> real_;
 				io::stream<details::void_handler> void_;
 				io::stream<details::remote_ability_sink<Resolver> > out_;
@@ -6,3 +6,9 @@
 #define DEBUG			5
 #define DEBUG_PROTOCOL  6
 #define DEBUG_ALL		7
+
+/*
+ * HYPER_LOG(obj, lvl) << ... ; logs through obj.logger(lvl), but only
+ * evaluates and formats its arguments if obj.log_enabled(lvl) is true.
+ */
+#define HYPER_LOG(obj, lvl) if (!(obj).log_enabled(lvl)) ; else (obj).logger(lvl)
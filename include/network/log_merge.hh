@@ -0,0 +1,71 @@
+#ifndef HYPER_NETWORK_LOG_MERGE_HH_
+#define HYPER_NETWORK_LOG_MERGE_HH_
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include <boost/date_time/posix_time/ptime.hpp>
+#include <boost/function/function1.hpp>
+
+#include <network/msg_log.hh>
+
+namespace hyper {
+	namespace network {
+
+		/*
+		 * Merge the log messages received from several agents in the
+		 * order of their hybrid clock timestamps, so in causal order.
+		 * Messages are queued by agent, and each agent sends its messages
+		 * in order, so a message can be output as soon as every known
+		 * agent has sent something at least as recent (its watermark).
+		 * Agents which don't log anything don't hold the others more than
+		 * max_delay.
+		 */
+		class log_merger
+		{
+			public:
+				typedef boost::function<void (const log_msg&)> output_cb;
+
+			private:
+				struct source {
+					std::deque<log_msg> msgs;
+					hlc_timestamp watermark;
+					bool alive;
+
+					source() : alive(true) {}
+				};
+
+				typedef std::map<std::string, source> source_map;
+
+				source_map sources;
+				output_cb cb;
+				boost::posix_time::time_duration max_delay;
+				size_t size_;
+
+				void output_until(const hlc_timestamp& limit);
+
+			public:
+				log_merger(output_cb cb, boost::posix_time::time_duration max_delay);
+
+				void push(const log_msg& msg);
+
+				/*
+				 * Output the messages which can't be preceded anymore, now
+				 * being the current universal time
+				 */
+				void flush(boost::posix_time::ptime now);
+
+				/* Output all the queued messages */
+				void flush_all();
+
+				/* The agent is dead, don't wait for its messages anymore */
+				void remove_source(const std::string& src);
+
+				/* Number of queued messages */
+				size_t size() const { return size_; }
+		};
+	}
+}
+
+#endif /* HYPER_NETWORK_LOG_MERGE_HH_ */
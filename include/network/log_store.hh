@@ -0,0 +1,125 @@
+#ifndef HYPER_NETWORK_LOG_STORE_HH_
+#define HYPER_NETWORK_LOG_STORE_HH_
+
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+#include <boost/function/function1.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <network/msg_log.hh>
+
+namespace hyper {
+	namespace network {
+
+		/*
+		 * Append-only binary store of log messages, written in hybrid clock
+		 * order by hyperlog. A store named path is made of three files :
+		 *  - path : the records, [date][logical][src size][msg size][src][msg],
+		 *    the date in microseconds since the epoch, logical the logical
+		 *    part of the hybrid clock timestamp, integers in host order
+		 *  - path.idx : one fixed-size log_index_entry for each record, so
+		 *    the records are found by a binary search on the physical part
+		 *    of their hybrid clock timestamp
+		 *  - path.agents : the agent names, one by line, the id of an agent
+		 *    being its line number
+		 *  - path.idx.<id> : the index entries of the agent id only, so a
+		 *    query on one agent doesn't scan the records of the others
+		 *  - path.unsorted : only exists once a record older than a previous
+		 *    one has been appended (a late message), the indexes can't be
+		 *    searched by dichotomy anymore and queries sort their matches
+		 */
+		struct log_index_entry {
+			boost::int64_t stamp;
+			boost::uint64_t offset;
+			boost::uint32_t agent;
+			boost::uint32_t size;
+		};
+
+		struct log_store_error : public std::runtime_error {
+			log_store_error(const std::string& what) :
+				std::runtime_error(what)
+			{}
+		};
+
+		class log_store_writer : private boost::noncopyable
+		{
+			std::string path;
+			std::ofstream data, index, agents;
+			std::map<std::string, boost::uint32_t> ids;
+			std::vector<boost::shared_ptr<std::ofstream> > agent_indexes;
+			boost::uint64_t offset;
+			boost::int64_t last_stamp;
+			bool sorted;
+
+			boost::uint32_t agent_id(const std::string& src);
+			std::ofstream& agent_index(boost::uint32_t id);
+
+			public:
+				/* Open the store, appending to it if it already exists */
+				explicit log_store_writer(const std::string& path);
+
+				void append(const log_msg& msg);
+
+				void flush();
+		};
+
+		struct log_query {
+			boost::posix_time::ptime since; // universal time, not_a_date_time for no bound
+			boost::posix_time::ptime until; // universal time, not_a_date_time for no bound
+			std::string agent;				// empty for all agents
+			std::string grep;				// extended regex on the message
+		};
+
+		/*
+		 * Read-only view of a store, the files are mapped in memory so a
+		 * query only touches the records it returns.
+		 */
+		class log_store_reader : private boost::noncopyable
+		{
+			public:
+				typedef boost::function<void (const log_msg&)> output_cb;
+
+			private:
+				struct mapping {
+					const char* addr;
+					size_t size;
+
+					mapping() : addr(0), size(0) {}
+				};
+
+				std::string path;
+				mapping data, index;
+				std::vector<std::string> agents;
+				bool sorted;
+
+				static void map_file(const std::string& path, mapping& m);
+				static void unmap_file(mapping& m);
+
+				const log_index_entry* entries() const;
+				log_msg read(const log_index_entry& e) const;
+
+				size_t query(const log_index_entry* begin, const log_index_entry* end,
+							 const log_query& q, output_cb cb) const;
+
+			public:
+				explicit log_store_reader(const std::string& path);
+				~log_store_reader();
+
+				/* Number of records */
+				size_t size() const;
+
+				/* Call cb on each record matching q, in date order, and
+				 * return the number of matches */
+				size_t query(const log_query& q, output_cb cb) const;
+		};
+	}
+}
+
+#endif /* HYPER_NETWORK_LOG_STORE_HH_ */
@@ -3,8 +3,9 @@
 
 #include <string>
 
-#include <boost/mpl/vector/vector20.hpp>
+#include <boost/mpl/vector/vector30.hpp>
 
+#include <network/hybrid_clock.hh>
 #include <network/msg_constraint.hh>
 #include <network/msg_log.hh>
 #include <network/msg_name.hh>
@@ -18,8 +19,36 @@ namespace hyper {
 		{
 			uint32_t type;
 			uint32_t size;
+			/* hybrid clock of the sender when it sent the message */
+			hlc_timestamp stamp;
 		};
 
+		/*
+		 * On the wire, a header is type, size, stamp.physical and
+		 * stamp.logical, in little-endian, without padding : its size
+		 * and layout don't depend on the architecture of the agents.
+		 */
+		const std::size_t header_length = 20;
+
+		void encode_header(const header& head, char* out);
+		header decode_header(const char* in);
+
+		/*
+		 * The high bits of header::type are flags : the payload is
+		 * compressed, and the sender accepts compressed payloads. The
+		 * second one lets each connection negotiate compression.
+		 */
+		const uint32_t header_compressed = 0x80000000u;
+		const uint32_t header_accept_compressed = 0x40000000u;
+		const uint32_t header_type_mask = 0x3fffffffu;
+
+		/*
+		 * Type of a header without payload, sent by a server on each
+		 * accepted connection to advertise its flags, so that clients
+		 * which only write learn them too. Readers skip it.
+		 */
+		const uint32_t header_hello = header_type_mask;
+
 		struct ping
 		{
 			template<class Archive>
@@ -54,6 +83,15 @@ namespace hyper {
 			void serialize(Archive& ar, const unsigned int version);
 
 			std::vector<std::string> new_agents;
+
+			/*
+			 * Delta of the agent directory : version after the change,
+			 * and the addresses of new_agents. 0 if there is no directory.
+			 */
+			boost::uint64_t directory_version;
+			std::vector<request_name_answer> addresses;
+
+			inform_new_agent() : directory_version(0) {}
 		};
 
 		struct inform_death_agent
@@ -62,6 +100,11 @@ namespace hyper {
 			void serialize(Archive& ar, const unsigned int version);
 
 			std::vector<std::string> dead_agents;
+
+			/* Version of the agent directory after the change, 0 if none */
+			boost::uint64_t directory_version;
+
+			inform_death_agent() : directory_version(0) {}
 		};
 
 		struct terminate
@@ -75,7 +118,7 @@ namespace hyper {
 			terminate(const std::string& src) : reason(src) {}
 		};
 
-		typedef boost::mpl::vector19<
+		typedef boost::mpl::vector25<
 			request_name,
 			request_name_answer,
 			register_name,
@@ -94,11 +137,15 @@ namespace hyper {
 			terminate,
 			abort, 
 			pause,
-			resume
+			resume,
+			request_variable_values,
+			variable_values,
+			subscribe_variable,
+			unsubscribe_variable,
+			variable_update,
+			log_msgs
 		> message_types;
 
-#define MESSAGE_TYPE_MAX 19
-
 	}
 }
 
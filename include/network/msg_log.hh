@@ -2,8 +2,11 @@
 #define HYPER_NETWORK_MSG_LOG_HH_
 
 #include <string>
+#include <vector>
 #include <boost/date_time/posix_time/ptime.hpp>
 
+#include <network/hybrid_clock.hh>
+
 namespace hyper {
 	namespace network {
 		struct log_msg
@@ -11,13 +14,44 @@ namespace hyper {
 			template <class Archive>
 			void serialize(Archive& ar, const unsigned int version);
 
-			boost::posix_time::ptime date;
+			boost::posix_time::ptime date; // local wall clock, for display
+			hlc_timestamp stamp; // hybrid clock, to order the messages
 			std::string src;
 			std::string msg;
 
 			log_msg() {}
 			log_msg(const std::string& src_, const std::string& msg_);
 		};
+
+		/*
+		 * A batch of log lines of src, each line being dated and stamped
+		 * when it was logged, not when the batch is sent
+		 */
+		struct log_msgs
+		{
+			struct line
+			{
+				template <class Archive>
+				void serialize(Archive& ar, const unsigned int version);
+
+				boost::posix_time::ptime date;
+				hlc_timestamp stamp;
+				std::string msg;
+
+				line() {}
+				/* the line msg, dated and stamped now */
+				explicit line(const std::string& msg_);
+			};
+
+			template <class Archive>
+			void serialize(Archive& ar, const unsigned int version);
+
+			std::string src;
+			std::vector<line> lines;
+
+			/* Append each line, as a log_msg, to out */
+			void split(std::vector<log_msg>& out) const;
+		};
 	}
 }
 
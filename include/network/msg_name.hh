@@ -5,6 +5,7 @@
 #include <vector>
 
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/cstdint.hpp>
 
 namespace hyper {
 	namespace network {
@@ -24,6 +25,8 @@ namespace hyper {
 			std::string name;
 			bool success;
 			std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+			std::string host;
+			std::vector<std::string> local_endpoints; /**< unix socket paths, usable from host */
 		};
 
 		struct register_name
@@ -33,6 +36,8 @@ namespace hyper {
 
 			std::string name;
 			std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+			std::string host;
+			std::vector<std::string> local_endpoints; /**< unix socket paths, usable from host */
 		};
 
 		struct register_name_answer
@@ -42,6 +47,17 @@ namespace hyper {
 
 			std::string name;
 			bool success;
+
+			/*
+			 * Snapshot of the agent directory, at directory_version, so
+			 * that the new agent can resolve names without asking the
+			 * name server. directory_version is 0 if the name server
+			 * doesn't maintain a directory.
+			 */
+			boost::uint64_t directory_version;
+			std::vector<request_name_answer> directory;
+
+			register_name_answer() : success(false), directory_version(0) {}
 		};
 	}
 }
@@ -2,6 +2,7 @@
 #define HYPER_NETWORK_MSG_PROXY_HH_
 
 #include <string>
+#include <vector>
 
 #include <network/types.hh>
 #include <network/runtime_error.hh>
@@ -31,6 +32,71 @@ namespace hyper {
 			error_context err_ctx;
 		};
 
+		/*
+		 * Read several variables of the same agent in one round trip. The
+		 * values are all computed in the same pass, so they form a
+		 * consistent snapshot of the remote agent.
+		 */
+		struct request_variable_values
+		{
+			template<class Archive>
+			void serialize(Archive& ar, const unsigned int version);
+
+			mutable identifier id;
+			mutable std::string src;
+			std::vector<std::string> var_names;
+		};
+
+		/* values[i] is the answer for var_names[i] (id and src are not used) */
+		struct variable_values
+		{
+			template<class Archive>
+			void serialize(Archive& ar, const unsigned int version);
+
+			mutable identifier id;
+			mutable std::string src;
+			std::vector<variable_value> values;
+		};
+
+		/*
+		 * Ask the agent owning var_name to push a variable_update each time
+		 * the variable changes, instead of polling it. The variable is
+		 * sampled every period (in ms), which bounds the rate of updates.
+		 * If deadband is not null, numeric variables are pushed only when
+		 * they moved more than deadband since the last push.
+		 */
+		struct subscribe_variable
+		{
+			template<class Archive>
+			void serialize(Archive& ar, const unsigned int version);
+
+			identifier id;
+			std::string src;
+			std::string var_name;
+			double period;
+			double deadband;
+		};
+
+		struct unsubscribe_variable
+		{
+			template<class Archive>
+			void serialize(Archive& ar, const unsigned int version);
+
+			identifier id;
+			std::string src;
+		};
+
+		/* Pushed to src, id is the one of the subscribe_variable */
+		struct variable_update
+		{
+			template<class Archive>
+			void serialize(Archive& ar, const unsigned int version);
+
+			identifier id;
+			std::string src;
+			std::string var_name;
+			std::string value;
+		};
 	}
 }
 
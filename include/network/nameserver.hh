@@ -1,15 +1,21 @@
 #ifndef _NETWORK_NAMESERVER_HH_
 #define _NETWORK_NAMESERVER_HH_
 
+#include <deque>
 #include <map>
 #include <string>
+#include <vector>
 
+#include <boost/bind.hpp>
+#include <boost/function/function2.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/variant/variant.hpp>
 
+#include <network/msg.hh>
 #include <network/msg_name.hh>
 #include <network/server_tcp_impl.hh>
 #include <network/client_tcp_impl.hh>
+#include <network/transport.hh>
 
 namespace hyper {
 	namespace network {
@@ -28,9 +34,11 @@ namespace hyper {
 			typedef boost::make_variant_over<input_msg>::type input_variant;
 			typedef boost::make_variant_over<output_msg>::type output_variant;
 
-			// for moment, only deal with tcp
 			struct addr_storage {
 				std::vector<boost::asio::ip::tcp::endpoint> tcp_endpoints;
+				/* unix sockets, only reachable from host */
+				std::string host;
+				std::vector<std::string> local_endpoints;
 			};
 
 			class map_addr : private boost::noncopyable
@@ -96,68 +104,81 @@ namespace hyper {
 			const std::vector<boost::asio::ip::tcp::endpoint>& 
 			endpoints() { return rna.endpoints; }
 			bool success() { return rna.success; };
+
+			/* All the endpoints of the agent, the local ones first if usable */
+			std::vector<stream_protocol::endpoint> preferred_endpoints() const
+			{
+				return network::preferred_endpoints(rna.host, rna.local_endpoints, rna.endpoints);
+			}
 		};
 
+		/*
+		 * Client of the name server. Successful answers are cached until
+		 * invalidate() is called for the name (death of the agent, or
+		 * failure to reach the cached endpoints). Concurrent resolutions
+		 * of the same name share one request, and requests for different
+		 * names are pipelined on the connection to the name server.
+		 *
+		 * If the name server maintains a versioned directory of the
+		 * agents (hyperruntime does), the cache is filled with the
+		 * snapshot received on registration, and kept up to date with
+		 * the deltas pushed on each registration or death (see apply).
+		 * The name server is then only asked for unknown names, or after
+		 * a missed delta.
+		 */
 		class name_client {
-			typedef tcp::client<ns::output_msg> ns_client;
-			ns_client client;
-			boost::asio::io_service& io_s;
-			bool is_resolving;
-
-			template <typename Handler>
-			void handle_resolve(const boost::system::error_code &e,
-								name_resolve& solv,
-								boost::tuple<Handler> handler)
-			{
-				is_resolving = false;
-				if (e) {
-					boost::get<0>(handler)(e);
-				} else {
-					if (solv.success()) {
+			public:
+				typedef boost::function<void (const boost::system::error_code&,
+											  const request_name_answer&)> resolve_cb;
+
+			private:
+				typedef tcp::client<ns::output_msg> ns_client;
+				ns_client client;
+				boost::asio::io_service& io_s;
+
+				typedef std::map<std::string, request_name_answer> cache_map;
+				typedef std::map<std::string, std::vector<resolve_cb> > waiting_map;
+
+				cache_map cache;
+				/* callbacks waiting for the answer about a name */
+				waiting_map waiting;
+				/* names asked to the name server, in the order of the answers */
+				std::deque<std::string> in_flight;
+				request_name_answer answer;
+				bool is_reading;
+
+				/* version of the directory replicated in cache, 0 if none */
+				boost::uint64_t directory_version;
+
+				void install(const register_name_answer& rea);
+				bool next_version(boost::uint64_t version);
+
+				void async_resolve_(const std::string& name, resolve_cb cb);
+				void handle_write(const boost::system::error_code& e, request_name* rn);
+				void read_answer();
+				void handle_read(const boost::system::error_code& e);
+				void complete(const std::string& name, const boost::system::error_code& e,
+							  const request_name_answer& ans);
+				void abort_all(const boost::system::error_code& e);
+
+				template <typename Handler>
+				void handle_resolve(const boost::system::error_code &e,
+									const request_name_answer& ans,
+									name_resolve& solv,
+									boost::tuple<Handler> handler)
+				{
+					solv.rna = ans;
+					if (e) {
 						boost::get<0>(handler)(e);
 					} else {
-						// XXX wrong, return a real error from hyper::network::
-						boost::get<0>(handler)(boost::system::error_code());
+						if (solv.success()) {
+							boost::get<0>(handler)(e);
+						} else {
+							// XXX wrong, return a real error from hyper::network::
+							boost::get<0>(handler)(boost::system::error_code());
+						}
 					}
 				}
-			}
-
-			template <typename Handler>
-			void async_resolve_(name_resolve & solv,
-							   boost::tuple<Handler> handler)
-			{
-				/* 
-				 * If we already are in the resolving state, (meaning that we
-				 * are sent a name request, and we are waiting for an answer),
-				 * just postpone the job. It will be scheduled later. Of
-				 * course, if we are out of luck, it can be postponed until the
-				 * end of the universe, but the probably is near 0.0
-				 */
-				if (is_resolving) {
-					void (name_client::*postpone)(
-									   name_resolve& solv,
-									   boost::tuple<Handler>) =
-						&name_client::template async_resolve_<Handler>;
-
-					io_s.post(boost::bind(postpone, this, boost::ref(solv),
-										  handler));
-					return;
-				}
-
-				network::request_name rn;
-				rn.name = solv.name();
-
-				void (name_client::*f)(const boost::system::error_code& e,
-									   name_resolve& solv,
-									   boost::tuple<Handler>) =
-					&name_client::template handle_resolve<Handler>;
-
-				client.async_request(rn, solv.rna, 
-						boost::bind(f, this, boost::asio::placeholders::error,
-											 boost::ref(solv),
-											 handler));
-				is_resolving = true;
-			}
 
 			public:
 
@@ -167,14 +188,35 @@ namespace hyper {
 			name_client(boost::asio::io_service&, 
 							 const std::string&, const std::string&);
 
-			bool register_name(const std::string&, const std::vector<boost::asio::ip::tcp::endpoint>&);
+			bool register_name(const std::string&, const std::vector<boost::asio::ip::tcp::endpoint>&,
+							   const std::vector<std::string>& local_endpoints = std::vector<std::string>());
 			std::pair<bool, std::vector<boost::asio::ip::tcp::endpoint> > sync_resolve(const std::string&);
 
 			template <typename Handler>
 			void async_resolve(name_resolve & solv, Handler handler)
 			{
-				async_resolve_(solv, boost::make_tuple(handler));
+				void (name_client::*f)(const boost::system::error_code& e,
+									   const request_name_answer&,
+									   name_resolve& solv,
+									   boost::tuple<Handler>) =
+					&name_client::template handle_resolve<Handler>;
+
+				async_resolve_(solv.name(), 
+						boost::bind(f, this, _1, _2, boost::ref(solv),
+									boost::make_tuple(handler)));
 			}
+
+			/* Forget the cached address of name */
+			void invalidate(const std::string& name);
+
+			/* Apply the deltas of the directory pushed by the name server */
+			void apply(const inform_new_agent& msg);
+			void apply(const inform_death_agent& msg);
+
+			boost::uint64_t version() const { return directory_version; }
+
+			/* Number of names asked to the name server, without answer yet */
+			size_t pending() const { return in_flight.size(); }
 		};
 	}
 }
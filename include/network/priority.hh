@@ -0,0 +1,84 @@
+#ifndef HYPER_NETWORK_PRIORITY_HH_
+#define HYPER_NETWORK_PRIORITY_HH_
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <network/msg.hh>
+
+namespace hyper {
+	namespace network {
+
+		/*
+		 * Priority classes of the messages. A serialized_socket writes
+		 * the queued control and normal messages before the bulk ones, so
+		 * they are not stuck behind megabytes of values or logs. Control
+		 * messages don't overtake normal ones : an abort must not reach
+		 * the peer before the request it cancels.
+		 */
+		enum message_class { control_class, normal_class, bulk_class, nb_message_classes };
+
+		const char* message_class_name(message_class c);
+
+		template <typename T>
+		struct message_priority {
+			static const message_class value = normal_class;
+		};
+
+#define HYPER_MESSAGE_PRIORITY(T, c) \
+		template <> struct message_priority<T> { static const message_class value = c; };
+
+		HYPER_MESSAGE_PRIORITY(ping, control_class)
+		HYPER_MESSAGE_PRIORITY(terminate, control_class)
+		HYPER_MESSAGE_PRIORITY(abort, control_class)
+		HYPER_MESSAGE_PRIORITY(pause, control_class)
+		HYPER_MESSAGE_PRIORITY(resume, control_class)
+		HYPER_MESSAGE_PRIORITY(variable_value, bulk_class)
+		HYPER_MESSAGE_PRIORITY(variable_values, bulk_class)
+		HYPER_MESSAGE_PRIORITY(variable_update, bulk_class)
+		HYPER_MESSAGE_PRIORITY(log_msg, bulk_class)
+		HYPER_MESSAGE_PRIORITY(log_msgs, bulk_class)
+
+#undef HYPER_MESSAGE_PRIORITY
+
+		/*
+		 * Time spent by the messages of each class between their queueing
+		 * in a serialized_socket and the end of their write, for the whole
+		 * process.
+		 */
+		class message_latency : private boost::noncopyable
+		{
+			public:
+				struct summary {
+					size_t count;
+					boost::posix_time::time_duration total;
+					boost::posix_time::time_duration max;
+
+					summary() : count(0) {}
+
+					boost::posix_time::time_duration mean() const
+					{
+						return count ? total / count : boost::posix_time::time_duration();
+					}
+				};
+
+			private:
+				boost::mutex m;
+				summary stats[nb_message_classes];
+
+				message_latency() {}
+
+			public:
+				static message_latency& instance();
+
+				void record(message_class c, boost::posix_time::time_duration latency);
+
+				summary get(message_class c);
+
+				void reset();
+		};
+	}
+}
+
+#endif /* HYPER_NETWORK_PRIORITY_HH_ */
@@ -0,0 +1,41 @@
+#ifndef HYPER_NETWORK_PROTOCOL_ERROR_HH_
+#define HYPER_NETWORK_PROTOCOL_ERROR_HH_
+
+#include <string>
+
+#include <boost/system/error_code.hpp>
+
+namespace hyper {
+	namespace network {
+		namespace protocol_error {
+			enum protocol_error_t {
+				ok,
+				request_timeout		  // no answer before the deadline of the request
+			};
+		}
+
+		class protocol_category_impl
+			  : public boost::system::error_category
+		{
+			public:
+			  virtual const char* name() const;
+			  virtual std::string message(int ev) const;
+		};
+
+		const boost::system::error_category& protocol_category();
+
+		inline
+		boost::system::error_code make_error_code(protocol_error::protocol_error_t e)
+		{
+			return boost::system::error_code(static_cast<int>(e), protocol_category());
+		}
+	}
+}
+
+namespace boost { namespace system {
+	template <>
+		struct is_error_code_enum<hyper::network::protocol_error::protocol_error_t>
+		: public true_type {};
+}}
+
+#endif /* HYPER_NETWORK_PROTOCOL_ERROR_HH_ */
@@ -9,6 +9,7 @@
 #include <boost/bind.hpp>
 #include <boost/function/function0.hpp>
 #include <boost/optional/optional.hpp>
+#include <boost/type_traits/is_arithmetic.hpp>
 
 #include <network/select_serialization.hh>
 
@@ -48,6 +49,12 @@ namespace hyper {
 			}
 		}
 
+		template <typename T>
+		double numeric_value(const T& value)
+		{
+			return static_cast<double>(value);
+		}
+
 		template <typename T>
 		boost::any capture_value(const T& value)
 		{
@@ -59,6 +66,20 @@ namespace hyper {
 			typedef std::map<std::string, boost::function <std::string ()> > serializer;
 			serializer s;
 
+			/* numeric view of arithmetic variables, to compute deadbands */
+			typedef std::map<std::string, boost::function <double ()> > numeric_map;
+			numeric_map numerics;
+
+			template <typename T>
+			void register_numeric(const std::string&, const T&, boost::false_type) {}
+
+			template <typename T>
+			void register_numeric(const std::string& name, const T& value, boost::true_type)
+			{
+				double (*f) (const T& value) = &numeric_value<T>;
+				numerics.insert(std::make_pair(name, boost::bind(f, boost::cref(value))));
+			}
+
 			public:
 				proxy_serializer() {};
 				template <typename T>
@@ -69,6 +90,8 @@ namespace hyper {
 
 					p = s.insert(std::make_pair(name, 
 								boost::bind(f, boost::cref(value))));
+					if (p.second)
+						register_numeric(name, value, boost::is_arithmetic<T>());
 					return p.second;
 				}
 
@@ -81,6 +104,16 @@ namespace hyper {
 					return it->second();
 				}
 
+				/* Value of name, if it is a known arithmetic variable */
+				boost::optional<double> eval_numeric(const std::string& name) const
+				{
+					numeric_map::const_iterator it;
+					it = numerics.find(name);
+					if (it == numerics.end()) 
+						return boost::none;
+					return it->second();
+				}
+
 				bool remove_variable(const std::string& name)
 				{
 					serializer::iterator it = s.find(name);
@@ -88,6 +121,7 @@ namespace hyper {
 						return false;
 					else {
 						s.erase(it);
+						numerics.erase(name);
 						return true;
 					}
 				}
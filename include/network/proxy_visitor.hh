@@ -13,7 +13,8 @@
 
 namespace hyper {
 	namespace network {
-		typedef boost::mpl::vector< request_variable_value > proxy_input_msg;
+		typedef boost::mpl::vector< request_variable_value,
+								   request_variable_values > proxy_input_msg;
 		typedef boost::mpl::vector< boost::mpl::void_ > proxy_output_msg;
 		typedef boost::make_variant_over< proxy_input_msg>::type proxy_input_variant;
 		typedef boost::make_variant_over< proxy_output_msg>::type proxy_output_variant;
@@ -53,6 +54,42 @@ namespace hyper {
 
 				return boost::mpl::void_();
 			}
+
+			void handle_proxy_values_output(const boost::system::error_code& e, 
+					variable_values* v) const
+			{
+				(void) e;
+				delete v;
+			}
+
+			/* Evaluate all the variables of r in the same pass */
+			void fill_values(const request_variable_values& r, variable_values& res) const
+			{
+				res.id = r.id;
+				res.src = r.src;
+				res.values.resize(r.var_names.size());
+				for (size_t i = 0; i < r.var_names.size(); ++i) {
+					boost::optional<std::string> p = s.eval(r.var_names[i]);
+					variable_value& v = res.values[i];
+					v.var_name = r.var_names[i];
+					v.success = p;
+					if (p)
+						v.value = *p;
+				}
+			}
+
+			proxy_output_variant operator() (const request_variable_values& r) const
+			{
+				variable_values* res(new variable_values);
+				fill_values(r, *res);
+
+				actor.client_db[r.src].async_write(*res, 
+						boost::bind(&proxy_visitor::handle_proxy_values_output,
+									this, boost::asio::placeholders::error,
+									res));
+
+				return boost::mpl::void_();
+			}
 		};
 	}
 }
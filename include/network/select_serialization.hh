@@ -13,6 +13,10 @@
 #include <boost/archive/binary_oarchive.hpp>
 #define HYPER_INPUT_ARCHIVE boost::archive::binary_iarchive
 #define HYPER_OUTPUT_ARCHIVE boost::archive::binary_oarchive
+#elif HYPER_SERIALIZATION == COMPACT_ARCHIVE
+#include <network/compact_archive.hh>
+#define HYPER_INPUT_ARCHIVE hyper::network::compact_iarchive
+#define HYPER_OUTPUT_ARCHIVE hyper::network::compact_oarchive
 #else
 #error "Unknown serialization kind"
 #endif
@@ -5,6 +5,8 @@
 #include <algorithm>
 
 #include <boost/asio/ip/host_name.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 #include <boost/bind.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
@@ -18,22 +20,23 @@
 #include <ifaddrs.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <unistd.h>
 
 
 namespace hyper {
 	namespace network {
 		namespace tcp {
 
-			template <typename InputM, typename OutputM, typename Answer>
+			template <typename InputM, typename OutputM, typename Answer, typename Protocol>
 			class connection_manager;
 
-			template <typename InputM, typename OutputM, typename Answer>
+			template <typename InputM, typename OutputM, typename Answer, typename Protocol>
 			struct dispatch_outbound_message;
 
-			template <typename InputM, typename OutputM, typename Answer>
+			template <typename InputM, typename OutputM, typename Answer, typename Protocol>
 			class connection
 				  : public boost::enable_shared_from_this<
-									connection<InputM, OutputM, Answer> >,
+									connection<InputM, OutputM, Answer, Protocol> >,
 				    private boost::noncopyable
 			{
 				public:
@@ -47,17 +50,32 @@ namespace hyper {
 
 					/* Construct a connection with the given io_service. */
 					explicit connection(boost::asio::io_service& io_service,
-							connection_manager<InputM, OutputM, Answer> & manager,
+							connection_manager<InputM, OutputM, Answer, Protocol> & manager,
 							const Answer& answer) :
-						socket_(io_service), connection_manager_(manager), answer_(answer)
+						socket_(io_service), connection_manager_(manager), answer_(answer),
+						read_paused_(false)
 					{}
 
 					/* Get the socket associated with the connection. */
-					boost::asio::ip::tcp::socket& socket()
+					typename Protocol::socket& socket()
 					{
 						return socket_.socket();
 					}
 
+					/*
+					 * Start a just accepted connection : tell the peer the
+					 * flags of the socket, then read its requests
+					 */
+					void accept()
+					{
+						socket_.async_write_hello(
+								boost::bind(
+									&connection::handle_write,
+									this->shared_from_this(),
+									boost::asio::placeholders::error));
+						start();
+					}
+
 					/* Start the first asynchronous operation for the connection. */
 					void start()
 					{
@@ -80,11 +98,15 @@ namespace hyper {
 					/* Handle completion of a write operation. */
 					void handle_write(const boost::system::error_code& e)
 					{
-						if (!e) {
-							// if succesful, just try to read another request
-							start();
-						} else {
+						if (e) {
 							connection_manager_.stop(this->shared_from_this());
+							return;
+						}
+
+						/* Restart reading if we were waiting for the peer */
+						if (read_paused_ && socket_.pending_writes() < max_pending_answers) {
+							read_paused_ = false;
+							start();
 						}
 					}
 
@@ -99,23 +121,37 @@ namespace hyper {
 					}
 
 				private:
-					/* Handle completion of a read operation. */
+					/* 
+					 * Handle completion of a read operation. 
+					 *
+					 * Requests are pipelined : the answer is queued on the
+					 * socket, which sends them in order, and the next
+					 * request is read without waiting for the write to
+					 * complete. If the peer does not read its answers,
+					 * we stop reading once max_pending_answers are
+					 * queued.
+					 */
 					void handle_read(const boost::system::error_code& e)
 					{
 						if (!e) {
 							outbound_msg_ = boost::apply_visitor(answer_, inbound_msg_);
-							dispatch_outbound_message<InputM, OutputM, Answer> dis(*this);
+							dispatch_outbound_message<InputM, OutputM, Answer, Protocol> dis(*this);
 							boost::apply_visitor(dis, outbound_msg_);
+
+							if (socket_.pending_writes() < max_pending_answers)
+								start();
+							else
+								read_paused_ = true;
 						} else {
 							connection_manager_.stop(this->shared_from_this());
 						}
 					}
 
 					/* Socket for the connection */
-					serialized_socket<InputM> socket_;
+					serialized_socket<InputM, Protocol> socket_;
 
 					/* The manager for this connection */
-					connection_manager<InputM, OutputM, Answer> & connection_manager_;
+					connection_manager<InputM, OutputM, Answer, Protocol> & connection_manager_;
 
 					/* Incoming data are stored in a message_variant */
 					msg_variant_input inbound_msg_;
@@ -125,12 +161,16 @@ namespace hyper {
 
 					/* Answer visitor */
 					Answer answer_;
+
+					/* True if we wait for some answers to be written before reading */
+					bool read_paused_;
+					enum { max_pending_answers = 64 };
 			};
 
-			template <typename InputM, typename OutputM, typename Answer>
+			template <typename InputM, typename OutputM, typename Answer, typename Protocol>
 			struct dispatch_outbound_message : public boost::static_visitor<void>
 			{
-				dispatch_outbound_message(connection<InputM, OutputM, Answer>& conn):
+				dispatch_outbound_message(connection<InputM, OutputM, Answer, Protocol>& conn):
 					conn_(conn) {};
 
 				template <typename T>
@@ -141,13 +181,13 @@ namespace hyper {
 
 				void operator() (const boost::mpl::void_ &) const
 				{
-					conn_.start();
+					/* no answer */
 				}
 
-				connection<InputM, OutputM, Answer>& conn_;
+				connection<InputM, OutputM, Answer, Protocol>& conn_;
 			};
 
-			template <typename InputM, typename OutputM, typename Answer>
+			template <typename InputM, typename OutputM, typename Answer, typename Protocol>
 			class connection_manager : private boost::noncopyable
 			{
 				public:
@@ -156,7 +196,8 @@ namespace hyper {
 						boost::shared_ptr<
 										connection<InputM,
 												   OutputM,
-												   Answer
+												   Answer,
+												   Protocol
 												   > 
 										> connection_ptr;
 					/* Add the specified connection to the manager and start it
@@ -164,7 +205,7 @@ namespace hyper {
 					void start(connection_ptr p)
 					{
 						connections_.insert(p);
-						p->start();
+						p->accept();
 					}
 
 					/* Stop the specified connection */
@@ -179,7 +220,7 @@ namespace hyper {
 					{
 						std::for_each(connections_.begin(), connections_.end(),
 								boost::bind(
-									&connection<InputM, OutputM, Answer>::stop, _1));
+									&connection<InputM, OutputM, Answer, Protocol>::stop, _1));
 						connections_.clear();
 					}
 
@@ -187,6 +228,30 @@ namespace hyper {
 					std::set<connection_ptr> connections_;
 			};
 
+			/* Prepare @acceptor to be bound on @endpoint */
+			template <typename Acceptor>
+			void prepare_bind(Acceptor& acceptor, const boost::asio::ip::tcp::endpoint&)
+			{
+				acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+			}
+
+			/* Release what has been allocated by binding on @endpoint */
+			inline void release_bind(const boost::asio::ip::tcp::endpoint&) {}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+			/* Remove the socket file left by a previous run, if any */
+			template <typename Acceptor>
+			void prepare_bind(Acceptor&, const boost::asio::local::stream_protocol::endpoint& endpoint)
+			{
+				::unlink(endpoint.path().c_str());
+			}
+
+			inline void release_bind(const boost::asio::local::stream_protocol::endpoint& endpoint)
+			{
+				::unlink(endpoint.path().c_str());
+			}
+#endif
+
 			/*
 			 * Provide a basic asynchronous server
 			 * @InputM is the mpl::list of accepted messages in input
@@ -194,16 +259,21 @@ namespace hyper {
 			 * @Answer is of kind variant visitor, which converts an input msg 
 			 * of type make_variant_over<InputM> to an output msg of type
 			 * make_variant_over<OutputM>.
+			 * @Protocol is the asio stream protocol the server listens on.
+			 * The constructors taking an address or a port are only usable
+			 * with ip::tcp, and local_endpoints too.
 			 */
-			template<typename InputM, typename OutputM, typename Answer>
+			template<typename InputM, typename OutputM, typename Answer,
+					 typename Protocol = boost::asio::ip::tcp>
 			class server : private boost::noncopyable
 			{
 				private:
-					void init(const boost::asio::ip::tcp::endpoint& endpoint) 
+					void init(const typename Protocol::endpoint& endpoint) 
 					{
 						acceptor_.open(endpoint.protocol());
-						acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+						prepare_bind(acceptor_, endpoint);
 						acceptor_.bind(endpoint);
+						endpoint_ = endpoint;
 						acceptor_.listen();
 						acceptor_.async_accept(new_connection_->socket(),
 						boost::bind(&server::handle_accept, this, boost::asio::placeholders::error));
@@ -216,7 +286,7 @@ namespace hyper {
 						acceptor_(io_service_),
 						connection_manager_(),
 						new_connection_(
-							new connection<InputM, OutputM, Answer> (
+							new connection<InputM, OutputM, Answer, Protocol> (
 									io_service_, 
 									connection_manager_,
 									ans)),
@@ -229,13 +299,13 @@ namespace hyper {
 						init(endpoint);
 					}
 
-					explicit server(const boost::asio::ip::tcp::endpoint &endpoint,
+					explicit server(const typename Protocol::endpoint &endpoint,
 						const Answer& ans, boost::asio::io_service& io_s) :
 						io_service_(io_s),
 						acceptor_(io_service_),
 						connection_manager_(),
 						new_connection_(
-							new connection<InputM, OutputM, Answer> (
+							new connection<InputM, OutputM, Answer, Protocol> (
 									io_service_, 
 									connection_manager_,
 									ans)),
@@ -250,7 +320,7 @@ namespace hyper {
 						acceptor_(io_service_),
 						connection_manager_(),
 						new_connection_(
-							new connection<InputM, OutputM, Answer> (
+							new connection<InputM, OutputM, Answer, Protocol> (
 									io_service_, 
 									connection_manager_,
 									ans)),
@@ -267,7 +337,7 @@ namespace hyper {
 						acceptor_(io_service_),
 						connection_manager_(),
 						new_connection_(
-							new connection<InputM, OutputM, Answer> (
+							new connection<InputM, OutputM, Answer, Protocol> (
 									io_service_, 
 									connection_manager_,
 									ans)),
@@ -279,6 +349,11 @@ namespace hyper {
 						init(endpoint);
 					}
 									
+				  ~server()
+				  {
+					  release_bind(endpoint_);
+				  }
+
 				  /* stop the server */
 				  void stop()
 				  {
@@ -334,7 +409,7 @@ namespace hyper {
 					  {
 						  connection_manager_.start(new_connection_);
 						  new_connection_.reset(
-								  new connection<InputM, OutputM, Answer> (
+								  new connection<InputM, OutputM, Answer, Protocol> (
 									  io_service_, connection_manager_,
 									  answer_));
 						  acceptor_.async_accept(new_connection_->socket(),
@@ -359,13 +434,16 @@ namespace hyper {
 				  boost::asio::io_service& io_service_;
 
 				  /* Acceptor used to listen for incoming connections. */
-				  boost::asio::ip::tcp::acceptor acceptor_;
+				  typename Protocol::acceptor acceptor_;
+
+				  /* The endpoint we listen on */
+				  typename Protocol::endpoint endpoint_;
 				  
 				  /* The connection manager which owns all live connections. */
-				  connection_manager<InputM, OutputM, Answer> connection_manager_;
+				  connection_manager<InputM, OutputM, Answer, Protocol> connection_manager_;
 				  
 				  /* The next connection to be accepted. */
-				  boost::shared_ptr< connection<InputM, OutputM, Answer> > new_connection_;
+				  boost::shared_ptr< connection<InputM, OutputM, Answer, Protocol> > new_connection_;
 
 				  /* The answer visitor */
 				  Answer answer_;
@@ -2,155 +2,550 @@
 #ifndef _NETWORK_SOCKET_TCP_ASYNC_SERIALIZERD_HH_
 #define _NETWORK_SOCKET_TCP_ASYNC_SERIALIZERD_HH_
 
+#include <list>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
-#define FUSION_MAX_VECTOR_SIZE 20
-
+#include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/read.hpp>
 #include <boost/asio/write.hpp>
 #include <boost/asio/placeholders.hpp>
 #include <boost/bind.hpp>
-#include <boost/fusion/include/as_vector.hpp>
-#include <boost/fusion/sequence/intrinsic/at_c.hpp>
-#include <boost/fusion/adapted/mpl.hpp>
-#include <boost/mpl/at.hpp>
-#include <boost/mpl/end.hpp>
+#include <boost/function.hpp>
 #include <boost/mpl/find.hpp>
-#include <boost/mpl/not.hpp>
+#include <boost/mpl/for_each.hpp>
+#include <boost/mpl/size.hpp>
 #include <boost/mpl/vector.hpp>
-#include <boost/preprocessor/repetition/repeat.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/tuple/tuple.hpp>
-#include <boost/type_traits/is_same.hpp>
+#include <boost/type_traits/add_pointer.hpp>
 #include <boost/variant.hpp>
 
+#include <network/buffer_streambuf.hh>
+#include <network/compression.hh>
 #include <network/msg.hh>
+#include <network/priority.hh>
 #include <network/select_serialization.hh>
 
 namespace hyper {
 	namespace network {
-		namespace tcp {
 
-			template <typename AuthorizedMessages>
-			class serialized_socket;
+		/*
+		 * A message encoded once, to be written as is on any number of
+		 * sockets (see encode_message). It is immutable, and each socket
+		 * writing it holds a reference on it until the end of the write.
+		 */
+		class encoded_message : public boost::enable_shared_from_this<encoded_message>,
+								private boost::noncopyable
+		{
+			public:
+				uint32_t type;
+				message_class priority;
+				std::vector<char> data;
+				/* compressed data, empty if compression is disabled or useless */
+				std::vector<char> compressed;
+		};
+
+		template <typename T>
+		boost::shared_ptr<const encoded_message> encode_message(const T& t)
+		{
+			typedef typename boost::mpl::find<message_types, T>::type iter;
+
+			boost::shared_ptr<encoded_message> msg(new encoded_message());
+			msg->type = iter::pos::value;
+			msg->priority = message_priority<T>::value;
+			{
+				vector_ostreambuf buf(msg->data);
+				std::ostream archive_stream(&buf);
+				{
+					HYPER_OUTPUT_ARCHIVE archive(archive_stream);
+					archive << t;
+				}
+				/* the archive may still write in its destructor (text archives do) */
+				archive_stream.flush();
+				buf.finish();
+			}
 
-			/* Meta-struct to call async_read with the right @T. 
-			 * @index here is the index in @AuthorizedMessages
-			 * @valid tells if it must really be extented or not (valid type ..)
-			 *
-			 * Implementation is after the definition of serialized_socket,
-			 * as we need to know its internals.
-			 */
-			template <typename AuthorizedMessages, typename T, typename Handler, int index, bool valid>
-			struct select_read_data;
+			if (compression_available() && msg->data.size() >= compression_threshold())
+				if (!compress_payload(msg->data, msg->compressed))
+					msg->compressed.clear();
+
+			return msg;
+		}
+
+		namespace tcp {
 
 			/*
-			 * Meta-struct to dispatch to real type T on the base of @index and @message_types
+			 * Run-time table to dispatch an incoming message, on the base
+			 * of its type identifier (its position in @message_types), to
+			 * the read function of the right type.
+			 *
+			 * There is one table for each couple (@Socket, @Handler), built
+			 * once. Message types not part of the authorized messages of
+			 * @Socket are rejected with an invalid_argument error.
 			 */
-			template <typename AuthorizedMessages, typename Handler, int index>
-			struct select_read_data_dispatch 
+			template <typename Socket, typename Handler>
+			class read_dispatch_table
 			{
-				typedef typename boost::make_variant_over<AuthorizedMessages>::type msg_variant;
+				public:
+					typedef Socket socket_type;
+					typedef typename socket_type::authorized_messages authorized_messages;
+					typedef typename socket_type::msg_variant msg_variant;
+					typedef void (*read_fun)(socket_type*, msg_variant&, size_t, boost::tuple<Handler>);
 
-				select_read_data_dispatch(serialized_socket<AuthorizedMessages> * socket) :
-					socket_(socket) {};
+					enum { nb_types = boost::mpl::size<message_types>::value };
 
-				void operator () (msg_variant& m, size_t size, boost::tuple<Handler> handler) 
-				{
-					using namespace boost::mpl;
-					typedef typename at_c<message_types, index>::type iter_type;
-					typedef typename find<AuthorizedMessages, iter_type>::type index_authorized;
-					typedef typename end<AuthorizedMessages>::type index_end;
-					typedef typename boost::is_same<index_authorized, index_end>::type failure;
-					typedef typename not_<failure>::type success;
-
-					select_read_data<
-						AuthorizedMessages,
-						iter_type, 
-						Handler,
-						index_authorized::pos::value, 
-						success::value
-					> s(socket_);
-
-					s(m, size, handler);
-				};
-
-				serialized_socket<AuthorizedMessages>* socket_;
+				private:
+					read_fun table_[nb_types];
+
+					struct register_type {
+						read_fun* table_;
+
+						register_type(read_fun* table) : table_(table) {}
+
+						template <typename T>
+						void operator() (T*) const
+						{
+							typedef typename boost::mpl::find<message_types, T>::type index;
+							table_[index::pos::value] = &socket_type::template read_variant_data<T, Handler>;
+						}
+					};
+
+					read_dispatch_table()
+					{
+						for (size_t i = 0; i < nb_types; ++i)
+							table_[i] = &socket_type::template reject_variant_data<Handler>;
+
+						boost::mpl::for_each<authorized_messages, boost::add_pointer<boost::mpl::_1> >(
+								register_type(table_));
+					}
+
+				public:
+					static const read_dispatch_table& instance()
+					{
+						static read_dispatch_table table;
+						return table;
+					}
+
+					/* Return 0 if @type is not a valid identifier */
+					read_fun operator[] (uint32_t type) const
+					{
+						if (type >= nb_types)
+							return 0;
+						return table_[type];
+					}
 			};
 
-			template <typename AuthorizedMessages> // expect mpl::vector of authorized msg
+			/*
+			 * @AuthorizedMessages is the mpl::vector of messages accepted in
+			 * input. @Protocol is the asio stream protocol used to transport
+			 * them (ip::tcp, local::stream_protocol, ...)
+			 */
+			template <typename AuthorizedMessages, typename Protocol = boost::asio::ip::tcp>
 			class serialized_socket{
 				public:
+					typedef AuthorizedMessages authorized_messages;
 					typedef typename boost::make_variant_over<AuthorizedMessages>::type
 								msg_variant;
+					typedef Protocol protocol_type;
+					typedef typename Protocol::socket socket_type;
 
 					serialized_socket(boost::asio::io_service& io_service) :
-						socket_(io_service)
+						socket_(io_service), write_in_progress_(false),
+						compression_threshold_(compression_available() ? compression_threshold() : 0),
+						peer_accepts_compressed_(false), inbound_compressed_(false)
 					{};
 
-					boost::asio::ip::tcp::socket& socket() {
+					socket_type& socket() {
 						return socket_;
 					}
 
 					void close() {
+						/* the next peer may not accept compressed payloads */
+						peer_accepts_compressed_ = false;
+						/*
+						 * The queued messages are not for the next peer, if
+						 * the socket is reconnected : they fail with the
+						 * write in progress (pending_ is empty otherwise)
+						 */
+						aborted_.splice(aborted_.end(), pending_);
 						return socket_.close();
 					}
 
 				private:
+					typedef boost::function<void (const boost::system::error_code&, std::size_t)>
+								write_handler;
+
+					/* An encoded message, waiting to be written on the socket */
+					struct outbound_message {
+						char header_[header_length];
+						std::vector<char> data_;
+						/* if set, the payload is the one of shared_, not data_ */
+						boost::shared_ptr<const encoded_message> shared_;
+						const std::vector<char>* shared_data_;
+						write_handler handler;
+						message_class priority;
+						boost::posix_time::ptime queued;
+
+						outbound_message() : shared_data_(0), priority(normal_class) {}
+
+						const std::vector<char>& payload() const
+						{
+							return shared_ ? *shared_data_ : data_;
+						}
+
+						std::size_t size() const { return header_length + payload().size(); }
+					};
+
+					typedef typename std::list<outbound_message>::iterator message_iterator;
+
 					template <typename T>
-					void prepare_write(const T& t,
-							std::vector<boost::asio::const_buffer>& buffers)
+					void prepare_write(const T& t, outbound_message& msg)
 					{
 						typedef typename boost::mpl::find<message_types, T>::type iter;
 
 						header head;
 						/* Get the msg type from the mpl:vector message_types */
 						head.type = iter::pos::value;
+						head.stamp = hybrid_clock::instance().now();
+
+						/* Serialize directly in the message buffer */
+						{
+							vector_ostreambuf buf(msg.data_);
+							std::ostream archive_stream(&buf);
+							{
+								HYPER_OUTPUT_ARCHIVE archive(archive_stream);
+								archive << t;
+							}
+							/* the archive may still write in its destructor (text archives do) */
+							archive_stream.flush();
+							buf.finish();
+						}
+
+						if (compression_threshold_ > 0) {
+							head.type |= header_accept_compressed;
+							if (peer_accepts_compressed_ && msg.data_.size() >= compression_threshold_ &&
+								compress_payload(msg.data_, compressed_)) {
+								msg.data_.swap(compressed_);
+								head.type |= header_compressed;
+							}
+						}
+						head.size = (uint32_t) msg.data_.size();
+
+						encode_header(head, msg.header_);
+					}
 
-						/* Compute the size archive */
-						std::ostringstream archive_stream;
-						HYPER_OUTPUT_ARCHIVE archive(archive_stream);
-						archive << t;
-						outbound_data_ = archive_stream.str();
-						head.size = (uint32_t) outbound_data_.size();
+					/* Only choose the payload and the flags of an encoded message */
+					void prepare_write(const encoded_message& m, outbound_message& msg)
+					{
+						header head;
+						head.type = m.type;
+						head.stamp = hybrid_clock::instance().now();
+
+						msg.shared_ = m.shared_from_this();
+						msg.shared_data_ = &m.data;
+						if (compression_threshold_ > 0) {
+							head.type |= header_accept_compressed;
+							if (peer_accepts_compressed_ && !m.compressed.empty()) {
+								msg.shared_data_ = &m.compressed;
+								head.type |= header_compressed;
+							}
+						}
+						head.size = (uint32_t) msg.shared_data_->size();
 
-						memcpy(outbound_header_, static_cast<void*>(&head), header_length);
+						encode_header(head, msg.header_);
+					}
+
+					/* A hello has no payload, only the flags of this socket */
+					void prepare_hello(outbound_message& msg)
+					{
+						header head;
+						head.type = header_hello | header_accept_compressed;
+						head.size = 0;
+						head.stamp = hybrid_clock::instance().now();
+
+						msg.data_.clear();
+						encode_header(head, msg.header_);
+					}
+
+					void handle_read_hello(const boost::system::error_code& e)
+					{
+						if (!e)
+							read_header();
+					}
+
+					/*
+					 * Decode inbound_header_, remember its flags, and return
+					 * it without them. Receiving the message moves the
+					 * hybrid clock past the one of the sender.
+					 */
+					header read_header()
+					{
+						header head = decode_header(inbound_header_);
+						hybrid_clock::instance().update(head.stamp);
+
+						inbound_compressed_ = (head.type & header_compressed) != 0;
+						if (head.type & header_accept_compressed)
+							peer_accepts_compressed_ = true;
+						head.type &= header_type_mask;
+						return head;
+					}
+
+					/*
+					 * Write the first pending messages in a single
+					 * gather-write, up to max_batch_bytes (but at least one
+					 * message), so a control message queued meanwhile only
+					 * waits for the end of this batch. Each message owns its
+					 * buffers, and they stay alive until the completion of
+					 * the write.
+					 */
+					void start_write()
+					{
+						assert(!write_in_progress_ && in_flight_.empty());
+
+						std::size_t bytes = 0;
+						do {
+							bytes += pending_.front().size();
+							in_flight_.splice(in_flight_.end(), pending_, pending_.begin());
+						} while (!pending_.empty() && bytes + pending_.front().size() <= max_batch_bytes);
+						write_in_progress_ = true;
+
+						std::vector<boost::asio::const_buffer> buffers;
+						buffers.reserve(2 * in_flight_.size());
+						typename std::list<outbound_message>::const_iterator it;
+						for (it = in_flight_.begin(); it != in_flight_.end(); ++it) {
+							buffers.push_back(boost::asio::buffer(it->header_));
+							buffers.push_back(boost::asio::buffer(it->payload()));
+						}
+
+						boost::asio::async_write(socket_, buffers,
+								boost::bind(&serialized_socket::handle_write, this,
+									boost::asio::placeholders::error));
+					}
+
+					void handle_write(const boost::system::error_code& e)
+					{
+						/*
+						 * The handlers may hold the last reference to the
+						 * owner of this socket : they are only destroyed
+						 * when we don't touch this anymore, so declared first
+						 */
+						std::vector<write_handler> handlers;
+						handlers.reserve(in_flight_.size() + aborted_.size());
+						std::list<outbound_message> done, aborted;
+						done.swap(in_flight_);
+						aborted.swap(aborted_);
+						write_in_progress_ = false;
+
+						boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+						message_latency& latency = message_latency::instance();
 
 						/*
-						 *  Write the serialized data to the socket. We use "gather-write" to send
-						 *  both the header and the data in a single write operation.
+						 * Handlers may queue new messages, they will be sent
+						 * in a next batch, ahead of the pending bulk ones only
 						 */
-						 buffers.push_back(boost::asio::buffer(outbound_header_));
-						 buffers.push_back(boost::asio::buffer(outbound_data_));
+						message_iterator it;
+						for (it = done.begin(); it != done.end(); ++it) {
+							if (!e)
+								latency.record(it->priority, now - it->queued);
+							handlers.push_back(write_handler());
+							handlers.back().swap(it->handler);
+							handlers.back()(e, e ? 0 : it->size());
+							release_payload(*it);
+						}
+						for (it = aborted.begin(); it != aborted.end(); ++it) {
+							handlers.push_back(write_handler());
+							handlers.back().swap(it->handler);
+							handlers.back()(boost::asio::error::operation_aborted, 0);
+							release_payload(*it);
+						}
+
+						done.splice(done.end(), aborted);
+						while (!done.empty() && free_.size() < max_free_messages)
+							free_.splice(free_.end(), done, done.begin());
+
+						if (!write_in_progress_ && !pending_.empty())
+							start_write();
+					}
+
+					/*
+					 * Get a message from the pool, or a new one if it is
+					 * empty, and queue it. Only the pending bulk messages
+					 * are overtaken : a control message must not reach the
+					 * peer before the request it refers to.
+					 */
+					message_iterator new_message(message_class priority)
+					{
+						message_iterator pos = pending_.end();
+						while (pos != pending_.begin() && priority != bulk_class) {
+							message_iterator prev = pos;
+							if ((--prev)->priority != bulk_class)
+								break;
+							pos = prev;
+						}
+
+						if (free_.empty())
+							pos = pending_.insert(pos, outbound_message());
+						else {
+							pending_.splice(pos, free_, free_.begin());
+							--pos;
+						}
+
+						pos->priority = priority;
+						pos->queued = boost::posix_time::microsec_clock::universal_time();
+						return pos;
+					}
+
+					/* Release the payload, but keep the buffer, unless it is a big one */
+					static void release_payload(outbound_message& msg)
+					{
+						if (msg.data_.capacity() > max_batch_bytes)
+							std::vector<char>().swap(msg.data_);
+						else
+							msg.data_.clear();
+						msg.shared_.reset();
+					}
+
+					/* Give back a message which failed to be prepared, it must not be sent */
+					void cancel_message(message_iterator msg)
+					{
+						release_payload(*msg);
+						if (free_.size() < max_free_messages)
+							free_.splice(free_.end(), pending_, msg);
+						else
+							pending_.erase(msg);
+					}
+
+					/* Deserialize @t from the first @size bytes of inbound_data_ */
+					template <typename T>
+					void decode(T& t, std::size_t size)
+					{
+						assert(size <= inbound_data_.size());
+						const char* data = inbound_data_.empty() ? 0 : &inbound_data_[0];
+						if (inbound_compressed_) {
+							if (!decompress_payload(data, size, inflated_data_))
+								throw std::runtime_error("Invalid compressed payload");
+							data = inflated_data_.empty() ? 0 : &inflated_data_[0];
+							size = inflated_data_.size();
+						}
+
+						array_istreambuf buf(data, size);
+						std::istream archive_stream(&buf);
+						HYPER_INPUT_ARCHIVE archive(archive_stream);
+						archive >> t;
 					}
-					
 
 				public:
 					/*
 					 * This function take a message @t of type T, encode it, and then sent it
 					 * On completion, @handler is called
 					 *
+					 * Messages are sent in order of queueing, except that
+					 * control and normal messages overtake the pending
+					 * bulk ones (see message_priority). Only one write is in flight at a time :
+					 * messages queued while a write is in progress are
+					 * coalesced in the next ones.
+					 *
 					 * Handler must be a compatible with operation
 					 *			void (*)(const boost::system::error_code&, unsigned long int)
 					 */
 					template <typename T, typename Handler>
 					void async_write(const T& t, Handler handler)
 					{
-						 std::vector<boost::asio::const_buffer> buffers;
-						 prepare_write(t, buffers);
-						 boost::asio::async_write(socket_, buffers, handler);
+						message_iterator msg = new_message(message_priority<T>::value);
+						try {
+							prepare_write(t, *msg);
+						} catch (...) {
+							cancel_message(msg);
+							throw;
+						}
+						msg->handler = handler;
+
+						if (!write_in_progress_)
+							start_write();
 					}
 
+					/*
+					 * Write an already encoded message, without encoding it
+					 * again. @m must be owned by a shared_ptr.
+					 */
+					template <typename Handler>
+					void async_write(const encoded_message& m, Handler handler)
+					{
+						message_iterator msg = new_message(m.priority);
+						try {
+							prepare_write(m, *msg);
+						} catch (...) {
+							cancel_message(msg);
+							throw;
+						}
+						msg->handler = handler;
+
+						if (!write_in_progress_)
+							start_write();
+					}
+
+					/*
+					 * Advertise to the peer that this socket accepts
+					 * compressed payloads (see header_hello). Nothing is
+					 * sent if compression is disabled.
+					 */
+					template <typename Handler>
+					void async_write_hello(Handler handler)
+					{
+						if (compression_threshold_ == 0)
+							return;
+
+						message_iterator msg = new_message(control_class);
+						prepare_hello(*msg);
+						msg->handler = handler;
+
+						if (!write_in_progress_)
+							start_write();
+					}
+
+					/*
+					 * Wait for the hello of the peer, on a socket which
+					 * never reads, to know if it accepts compressed
+					 * payloads. Until then, messages are sent raw. Must not
+					 * be mixed with async_read or sync_read.
+					 */
+					void async_read_hello()
+					{
+						boost::asio::async_read(socket_, boost::asio::buffer(inbound_header_),
+								boost::bind(&serialized_socket::handle_read_hello, this,
+									boost::asio::placeholders::error));
+					}
+
+					/* True if the peer told it accepts compressed payloads */
+					bool peer_accepts_compressed() const
+					{
+						return peer_accepts_compressed_;
+					}
+
+					/* Number of messages queued, but not yet written */
+					std::size_t pending_writes() const
+					{
+						return pending_.size() + in_flight_.size() + aborted_.size();
+					}
 
 					/*
 					 * This function takes a message @t of type T, encode it,
-					 * and then sent it.
+					 * and then sent it. It must not be mixed with pending
+					 * async_write.
 					 */
 					template <typename T>
 					void sync_write(const T& t)
 					{
+						 outbound_message msg;
+						 prepare_write(t, msg);
+
 						 std::vector<boost::asio::const_buffer> buffers;
-						 prepare_write(t, buffers);
+						 buffers.push_back(boost::asio::buffer(msg.header_));
+						 buffers.push_back(boost::asio::buffer(msg.payload()));
 						 boost::asio::write(socket_, buffers);
 					}
 
@@ -207,11 +602,13 @@ namespace hyper {
 					template <typename T>
 					void sync_read(T& t)
 					{
-						boost::asio::read(socket_, boost::asio::buffer(inbound_header_));
 						header head;
-						memcpy(&head, inbound_header_, sizeof(head));
+						do {
+							boost::asio::read(socket_, boost::asio::buffer(inbound_header_));
+							head = read_header();
+						} while (head.type == header_hello);
 
-						inbound_data_.reserve(head.size);
+						inbound_data_.resize(head.size);
 
 						typedef typename boost::mpl::find<message_types, T>::type right_index;
 
@@ -222,14 +619,11 @@ namespace hyper {
 							throw boost::system::system_error(error);
 						}
 
-						boost::asio::read(socket_, boost::asio::buffer(&inbound_data_[0], head.size));
+						boost::asio::read(socket_, boost::asio::buffer(inbound_data_));
 
 						try
 						{
-							std::string archive_data(&inbound_data_[0], head.size);
-							std::istringstream archive_stream(archive_data);
-							HYPER_INPUT_ARCHIVE archive(archive_stream);
-							archive >> t;
+							decode(t, head.size);
 						}
 						catch (std::exception&)
 						{
@@ -257,38 +651,50 @@ namespace hyper {
 						else
 						{
 							// Determine the length of the serialized data.
-							header head;
-							memcpy(&head, inbound_header_, sizeof(head));
+							header head = read_header();
+							if (head.type == header_hello)
+								return async_read(m, boost::get<0>(handler));
 
 							inbound_data_.resize(head.size);
+
 							/* 
-							 * Will call the right handle_read_data, or call
+							 * Will call the right read_variant_data, or call
 							 * handler with an invalid_argument error code
 							 */
+							typedef read_dispatch_table<serialized_socket, Handler> table;
+							typename table::read_fun f = table::instance()[head.type];
+							if (f == 0) {
+								std::cerr << "Unknown msg type : " << head.type << std::endl;
+								return reject_variant_data(this, m, head.size, handler);
+							}
 
-							/* XXX TODO
-							 * This code is pretty bad, there is probably a way to compute from
-							 *  the definition of @AuthorizedMessages and @message_types a way to
-							 * generate a run-time structure instead of generating this infamous
-							 * switch-case with PreProcessor. 
-							 *
-							 * If we find a way to fix it, we can remove the depends on
-							 *  MESSAGE_TYPE_MAX, and on @message_types (it will become a template
-							 * parameter).
-							 */
-					#define DECL(z, n, text) \
-						case n : {			 \
-							select_read_data_dispatch<AuthorizedMessages, Handler, n> s ## n(this);	\
-							return s ## n (m, head.size, handler);		\
+							f(this, m, head.size, handler);
 						}
+					}
 
-						switch (head.type) {
-							BOOST_PP_REPEAT(MESSAGE_TYPE_MAX, DECL, )
-							default:
-								;
-						}
-						#undef DECL
-						}
+					/* Read the data of a message of type T, and store it in @m */
+					template <typename T, typename Handler>
+					static void read_variant_data(serialized_socket* socket, msg_variant& m,
+												  size_t size, boost::tuple<Handler> handler)
+					{
+						void (serialized_socket::*f)(
+								const boost::system::error_code&,
+								msg_variant&, size_t,
+								boost::tuple<Handler>);
+						f = &serialized_socket::template handle_read_data<T, Handler>;
+						boost::asio::async_read(socket->socket_,
+								boost::asio::buffer(socket->inbound_data_),
+								boost::bind(f,
+									socket, boost::asio::placeholders::error,
+									boost::ref(m), size, handler));
+					}
+
+					template <typename Handler>
+					static void reject_variant_data(serialized_socket*, msg_variant&,
+													size_t, boost::tuple<Handler> handler)
+					{
+						boost::system::error_code error(boost::asio::error::invalid_argument);
+						boost::get<0>(handler)(error);
 					}
 
 					template <typename T, typename Handler>
@@ -302,8 +708,9 @@ namespace hyper {
 						else 
 						{
 							// Determine the length of the serialized data.
-							header head;
-							memcpy(&head, inbound_header_, sizeof(head));
+							header head = read_header();
+							if (head.type == header_hello)
+								return async_read(t, boost::get<0>(handler));
 
 							typedef typename boost::mpl::find<message_types, T>::type right_index;
 
@@ -316,14 +723,14 @@ namespace hyper {
 							}
 
 							// Issue a read operation to read exactly the number of bytes of the struct
-							inbound_data_.reserve(head.size);
+							inbound_data_.resize(head.size);
 
 							void (serialized_socket::*f)(
 									const boost::system::error_code&,
 									T&, size_t, boost::tuple<Handler>);
 							f = &serialized_socket::template handle_read_data<T, Handler>;
 
-							boost::asio::async_read(socket_, boost::asio::buffer(&inbound_data_[0], head.size),
+							boost::asio::async_read(socket_, boost::asio::buffer(inbound_data_),
 									boost::bind(f,
 										this, boost::asio::placeholders::error, boost::ref(t), head.size,
 										handler));
@@ -345,10 +752,7 @@ namespace hyper {
 							/* Extract the data structure from the data just received. */
 							try
 							{
-								std::string archive_data(&inbound_data_[0], size);
-								std::istringstream archive_stream(archive_data);
-								HYPER_INPUT_ARCHIVE archive(archive_stream);
-								archive >> t;
+								decode(t, size);
 							}
 							catch (std::exception&)
 							{
@@ -374,8 +778,9 @@ namespace hyper {
 
 					template <typename T, typename Handler>
 					void handle_read_data(const boost::system::error_code& e,
-								T& t, msg_variant& m, size_t size, boost::tuple<Handler> handler)
+								msg_variant& m, size_t size, boost::tuple<Handler> handler)
 					{
+						T t;
 						int res = handle_read_data_(e, t, size, handler);
 						if (res == 0) {
 							m = t;
@@ -384,79 +789,44 @@ namespace hyper {
 						}
 					}
 
-					template <typename Authorized, typename T, typename Handler,
-							   int index, bool valid> friend struct select_read_data;
-
-					/* The different kind of messages acceptables */
-					typedef typename boost::fusion::result_of::as_vector<AuthorizedMessages>::type
-							type_msgs;
-					type_msgs msgs;
+					template <typename Socket, typename Handler>
+					friend class read_dispatch_table;
 
 					/* The underlying socket. */
-					boost::asio::ip::tcp::socket socket_;
-					
-					/* The size of a fixed length header.*/
-					enum { header_length = sizeof(header) };
-					
-					/* Holds an outbound header. */
-					char outbound_header_[header_length];
+					socket_type socket_;
 					
-					/* Holds the outbound data. */
-					std::string outbound_data_;
-					
-					/* Holds an inbound header. */
-					char inbound_header_[header_length];
+					/* Messages waiting for the end of the current write */
+					std::list<outbound_message> pending_;
 
-					/* Holds the inbound data. */
-					std::vector<char> inbound_data_;
-			};
+					/* Messages of the current write */
+					std::list<outbound_message> in_flight_;
 
+					/* Messages queued before close(), failed with the current write */
+					std::list<outbound_message> aborted_;
 
-			template <typename AuthorizedMessages, typename T, typename Handler, int index>
-			struct select_read_data<AuthorizedMessages, T, Handler, index, false> 
-			{
-				typedef typename boost::make_variant_over<AuthorizedMessages>::type msg_variant;
-
-				select_read_data(serialized_socket<AuthorizedMessages> * socket) 
-				{
-					(void) socket;
-				};
+					/* Already written messages, kept to recycle their buffers */
+					std::list<outbound_message> free_;
+					enum { max_free_messages = 16 };
 
-				void operator() (msg_variant&, size_t, boost::tuple<Handler> handler) 
-				{
-					std::cerr << "Not acceptable msg : " << index << std::endl;
-					boost::system::error_code error(boost::asio::error::invalid_argument);
-					boost::get<0>(handler)(error);
-				};
-			};
+					/* Bytes above which a gather-write doesn't take more messages */
+					enum { max_batch_bytes = 64 * 1024 };
 
-			template <typename AuthorizedMessages, typename T, typename Handler, int index>
-			struct select_read_data<AuthorizedMessages, T, Handler, index, true> 
-			{
-				typedef serialized_socket<AuthorizedMessages> socket_type;
-				typedef typename socket_type::msg_variant msg_variant;
+					bool write_in_progress_;
+					
+					/* Holds an inbound header. */
+					char inbound_header_[header_length];
 
-				select_read_data(socket_type * socket) :
-					socket_(socket) {};
+					/* Holds the inbound data. */
+					std::vector<char> inbound_data_;
 
-				void operator() (msg_variant&m, size_t size, boost::tuple<Handler> handler) 
-				{
-					void (socket_type::*f)(
-							const boost::system::error_code&,
-							T&,
-							msg_variant&, size_t, 
-							boost::tuple<Handler>);
-					f = & socket_type::template handle_read_data<T, Handler>;
-					boost::asio::async_read(socket_->socket_, 
-							boost::asio::buffer(socket_->inbound_data_),
-							boost::bind(f,
-								socket_, boost::asio::placeholders::error,
-								boost::ref( boost::fusion::at_c<index> (socket_->msgs)),
-								boost::ref(m), size, 
-								handler));
-				}
+					/* Payloads above it are compressed, if the peer accepts it (0 to disable) */
+					std::size_t compression_threshold_;
+					bool peer_accepts_compressed_;
+					bool inbound_compressed_;
 
-				socket_type* socket_;
+					/* Scratch buffers for (de)compression */
+					std::vector<char> compressed_;
+					std::vector<char> inflated_data_;
 			};
 		}
 	}
@@ -0,0 +1,71 @@
+#ifndef HYPER_NETWORK_TIMER_WHEEL_HH_
+#define HYPER_NETWORK_TIMER_WHEEL_HH_
+
+#include <list>
+#include <vector>
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/function/function1.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <network/types.hh>
+
+namespace hyper {
+	namespace network {
+
+		/*
+		 * Hashed timing wheel : deadlines are rounded to a tick, and stored
+		 * in one of nb_slots slots, so arming and cancelling a deadline is
+		 * O(1) whatever the number of deadlines. Only one deadline_timer is
+		 * used, and it only runs while some deadlines are armed.
+		 *
+		 * expire_cb is called in the io_service thread with the identifier
+		 * of each expired deadline.
+		 */
+		class timer_wheel : private boost::noncopyable
+		{
+			public:
+				typedef boost::function<void (identifier)> expire_cb;
+
+			private:
+				struct entry {
+					identifier id;
+					size_t rounds;
+				};
+
+				typedef std::list<entry> slot;
+				typedef std::pair<size_t, slot::iterator> position;
+				typedef boost::unordered_map<identifier, position> index_map;
+
+				boost::asio::deadline_timer timer;
+				boost::posix_time::time_duration tick;
+				std::vector<slot> slots;
+				index_map index;
+				size_t current;
+				bool running;
+				expire_cb cb;
+
+				void start();
+				void handle_tick(const boost::system::error_code& e);
+
+			public:
+				timer_wheel(boost::asio::io_service& io_s, expire_cb cb,
+							boost::posix_time::time_duration tick =
+								boost::posix_time::milliseconds(100),
+							size_t nb_slots = 512);
+
+				/* Arm (or re-arm) the deadline of id, delay from now */
+				void schedule(identifier id, boost::posix_time::time_duration delay);
+
+				void cancel(identifier id);
+
+				/* Cancel all the deadlines */
+				void stop();
+
+				size_t size() const { return index.size(); }
+		};
+	}
+}
+
+#endif /* HYPER_NETWORK_TIMER_WHEEL_HH_ */
@@ -0,0 +1,50 @@
+#ifndef HYPER_NETWORK_TRANSPORT_HH_
+#define HYPER_NETWORK_TRANSPORT_HH_
+
+#include <string>
+#include <vector>
+
+#include <boost/version.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+/*
+ * Agents running on the same host can talk through unix domain sockets,
+ * which are cheaper than loopback tcp. It needs both local sockets and
+ * the generic protocol of asio (boost >= 1.54), to connect to a local or
+ * a tcp endpoint with the same client.
+ */
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS) && BOOST_VERSION >= 105400
+#define HYPER_HAS_LOCAL_SOCKETS
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#endif
+
+namespace hyper {
+	namespace network {
+#ifdef HYPER_HAS_LOCAL_SOCKETS
+		/* Protocol used by clients, able to reach local and tcp endpoints */
+		typedef boost::asio::generic::stream_protocol stream_protocol;
+#else
+		typedef boost::asio::ip::tcp stream_protocol;
+#endif
+
+		/*
+		 * Path of the unix socket where the agent @name listens, shortened
+		 * to fit in a sockaddr_un. Empty if no path fits : the agent is
+		 * then only reachable through tcp.
+		 */
+		std::string local_socket_path(const std::string& name);
+
+		/*
+		 * Compute the endpoints to reach an agent, in order of preference.
+		 * If the agent runs on the same host than us, its local endpoints
+		 * come first. Tcp ones are always present, as fallback.
+		 */
+		std::vector<stream_protocol::endpoint>
+		preferred_endpoints(const std::string& host,
+							const std::vector<std::string>& local_endpoints,
+							const std::vector<boost::asio::ip::tcp::endpoint>& tcp_endpoints);
+	}
+}
+
+#endif /* HYPER_NETWORK_TRANSPORT_HH_ */
@@ -1,4 +1,5 @@
 #include <compiler/extension.hh>
+#include <compiler/extract_symbols.hh>
 #include <compiler/logic_expression_output.hh>
 #include <compiler/output.hh>
 #include <compiler/scope.hh>
@@ -227,11 +228,35 @@ namespace {
 			oss << indent << "hyper::model::abortable_computation* " << oss_name.str();
 			oss << " = new hyper::model::abortable_computation();\n" << std::endl;
 
+			/*
+			 * If the predicate depends on remote variables, subscribe to
+			 * them instead of polling them. Local variables are not
+			 * pushed, so keep the same polling delay if there are some.
+			 */
+			extract_symbols wait_syms(a);
+			for (size_t i = 0; i < w.content.size(); ++i) {
+				const expression_ast* e = boost::get<expression_ast>(&w.content[i].expr);
+				if (e)
+					wait_syms.extract(*e);
+			}
+
+			double delay = w.delay ? *(w.delay) : 50;
 			oss << indent << ptr_object;
-			oss << "->push_back(new hyper::model::compute_wait_expression(a.io_s, boost::posix_time::milliseconds(";
-			oss << (w.delay ? *(w.delay) : 50) << "), \n";
-			oss << indent_next <<  oss_name.str() << ",\n";
-			oss << indent_next << identifier << "));\n";
+			if (wait_syms.remote.empty()) {
+				oss << "->push_back(new hyper::model::compute_wait_expression(a.io_s, boost::posix_time::milliseconds(";
+				oss << delay << "), \n";
+				oss << indent_next <<  oss_name.str() << ",\n";
+				oss << indent_next << identifier << "));\n";
+			} else {
+				double watch_delay = wait_syms.local.empty() ? delay * 10 : delay;
+				oss << "->push_back(new hyper::model::compute_wait_expression(a, boost::posix_time::milliseconds(";
+				oss << delay << "), \n";
+				oss << indent_next << "boost::posix_time::milliseconds(" << watch_delay << "),\n";
+				oss << indent_next <<  oss_name.str() << ",\n";
+				oss << indent_next << identifier << ",\n";
+				oss << wait_syms.remote_list_variables(indent_next);
+				oss << indent_next << ".convert_to_container<hyper::model::compute_wait_expression::remote_vars>()));\n";
+			}
 
 			target = boost::none;
 
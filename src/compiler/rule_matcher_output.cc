@@ -0,0 +1,294 @@
+#include <compiler/expression_ast.hh>
+#include <compiler/output.hh>
+#include <compiler/rule_matcher_output.hh>
+#include <compiler/rules_def_parser.hh>
+#include <compiler/scope.hh>
+
+#include <map>
+
+using namespace hyper::compiler;
+
+namespace {
+	/*
+	 * Simplified view of a rule expression, as seen by the logic engine :
+	 * binary operators are functions with two arguments, and unary
+	 * operators are transparent (see logic_expression_output.cc)
+	 */
+	struct pattern {
+		enum kind { INVALID, VARIABLE, CONSTANT, FUNCTION };
+
+		kind k;
+		std::string var;
+		std::vector<pattern> args;
+
+		pattern(kind k = INVALID) : k(k) {}
+	};
+
+	struct build_pattern : public boost::static_visitor<pattern>
+	{
+		pattern operator() (const empty&) const { return pattern(); }
+
+		template <typename T>
+		pattern operator() (const Constant<T>&) const
+		{
+			return pattern(pattern::CONSTANT);
+		}
+
+		pattern operator() (const std::string& s) const
+		{
+			pattern p(pattern::VARIABLE);
+			p.var = s;
+			return p;
+		}
+
+		pattern operator() (const function_call& f) const
+		{
+			pattern p(pattern::FUNCTION);
+			for (size_t i = 0; i < f.args.size(); ++i)
+				p.args.push_back(boost::apply_visitor(*this, f.args[i].expr));
+			return p;
+		}
+
+		pattern operator() (const expression_ast& e) const
+		{
+			return boost::apply_visitor(*this, e.expr);
+		}
+
+		pattern operator() (const binary_op& op) const
+		{
+			pattern p(pattern::FUNCTION);
+			p.args.push_back(boost::apply_visitor(*this, op.left.expr));
+			p.args.push_back(boost::apply_visitor(*this, op.right.expr));
+			return p;
+		}
+
+		pattern operator() (const unary_op& op) const
+		{
+			return boost::apply_visitor(*this, op.subject.expr);
+		}
+	};
+
+	pattern to_pattern(const expression_ast& e)
+	{
+		return boost::apply_visitor(build_pattern(), e.expr);
+	}
+
+	typedef std::map<std::string, size_t> variableM;
+
+	/* Check that every variable of p is bound and that p is well-formed */
+	bool is_instantiable(const pattern& p, const variableM& vars)
+	{
+		switch (p.k) {
+			case pattern::VARIABLE:
+				return (vars.find(p.var) != vars.end());
+			case pattern::CONSTANT:
+				return true;
+			case pattern::FUNCTION:
+				for (size_t i = 0; i < p.args.size(); ++i)
+					if (!is_instantiable(p.args[i], vars))
+						return false;
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	/*
+	 * Add the variables of a premise to vars. Returns false if the
+	 * premise can't be handled by the generated matcher.
+	 */
+	bool add_premise_variables(const pattern& p, variableM& vars)
+	{
+		if (p.k != pattern::FUNCTION)
+			return false;
+
+		for (size_t i = 0; i < p.args.size(); ++i) {
+			const pattern& arg = p.args[i];
+			if (arg.k == pattern::VARIABLE) {
+				if (vars.find(arg.var) == vars.end()) {
+					size_t idx = vars.size();
+					vars[arg.var] = idx;
+				}
+			} else if (arg.k != pattern::CONSTANT) {
+				/* the generic unification never matches a nested function */
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	std::string var_name(const variableM& vars, const std::string& v)
+	{
+		variableM::const_iterator it = vars.find(v);
+		assert(it != vars.end());
+		std::ostringstream oss;
+		oss << "v" << it->second;
+		return oss.str();
+	}
+
+	std::string indexed_name(const std::string& base, size_t i)
+	{
+		std::ostringstream oss;
+		oss << base << "_" << i;
+		return oss.str();
+	}
+
+	/* Give a name to the sub-function patterns of a conclusion */
+	void dump_conclusion_patterns(std::ostream& oss, const std::string& indent,
+								  const pattern& p, const std::string& name)
+	{
+		for (size_t i = 0; i < p.args.size(); ++i) {
+			if (p.args[i].k != pattern::FUNCTION)
+				continue;
+			std::string sub = indexed_name(name, i);
+			oss << indent << "const logic::function_call& " << sub;
+			oss << " = boost::get<logic::function_call>(" << name << ".args[" << i << "].expr);\n";
+			dump_conclusion_patterns(oss, indent, p.args[i], sub);
+		}
+	}
+
+	void dump_instance(std::ostream& oss, const std::string& indent,
+					   const pattern& p, const variableM& vars,
+					   const std::string& pattern_name, const std::string& name)
+	{
+		oss << indent << "logic::function_call " << name << "(" << pattern_name << ", true);\n";
+		for (size_t i = 0; i < p.args.size(); ++i) {
+			const pattern& arg = p.args[i];
+			oss << indent;
+			switch (arg.k) {
+				case pattern::VARIABLE:
+					oss << name << ".args[" << i << "] = " << var_name(vars, arg.var) << ";\n";
+					break;
+				case pattern::CONSTANT:
+					oss << name << ".args[" << i << "] = " << pattern_name << ".args[" << i << "];\n";
+					break;
+				case pattern::FUNCTION:
+					{
+					std::string sub = indexed_name(name, i);
+					oss << "{\n";
+					dump_instance(oss, indent + "\t", arg, vars, indexed_name(pattern_name, i), sub);
+					oss << indent << "\t" << name << ".args[" << i << "] = " << sub << ";\n";
+					oss << indent << "}\n";
+					}
+					break;
+				default:
+					assert(false);
+			}
+		}
+	}
+}
+
+namespace hyper {
+	namespace compiler {
+		bool can_compile_rule(const rule_decl& r)
+		{
+			if (r.premises.empty())
+				return false;
+
+			variableM vars;
+			for (size_t i = 0; i < r.premises.size(); ++i)
+				if (!add_premise_variables(to_pattern(r.premises[i]), vars))
+					return false;
+
+			for (size_t i = 0; i < r.conclusions.size(); ++i) {
+				pattern p = to_pattern(r.conclusions[i]);
+				if (p.k != pattern::FUNCTION || !is_instantiable(p, vars))
+					return false;
+			}
+
+			return true;
+		}
+
+		std::string rule_matcher_name(const rule_decl& r)
+		{
+			return "match_" + scope::get_identifier(r.name);
+		}
+
+		void dump_rule_matcher(std::ostream& oss, const rule_decl& r)
+		{
+			assert(can_compile_rule(r));
+
+			std::vector<pattern> premises, conclusions;
+			std::transform(r.premises.begin(), r.premises.end(),
+						   std::back_inserter(premises), to_pattern);
+			std::transform(r.conclusions.begin(), r.conclusions.end(),
+						   std::back_inserter(conclusions), to_pattern);
+
+			const std::string indent = "\t\t\t";
+
+			oss << indent << "/* specialised matcher for rule " << r.name << " */\n";
+			oss << indent << "size_t " << rule_matcher_name(r);
+			oss << "(const logic::rule& r, const logic::facts& f,\n";
+			oss << indent << "\t\tstd::vector<logic::function_call>& res)\n";
+			oss << indent << "{\n";
+			if (conclusions.empty())
+				oss << indent << "\t(void) res;\n";
+			oss << indent << "\tsize_t matches = 0;\n";
+
+			for (size_t i = 0; i < premises.size(); ++i) {
+				oss << indent << "\tconst logic::function_call& " << indexed_name("p", i);
+				oss << " = r.condition[" << i << "];\n";
+			}
+
+			for (size_t i = 0; i < conclusions.size(); ++i) {
+				std::string name = indexed_name("q", i);
+				oss << indent << "\tconst logic::function_call& " << name;
+				oss << " = r.action[" << i << "];\n";
+				dump_conclusion_patterns(oss, indent + "\t", conclusions[i], name);
+			}
+
+			/*
+			 * One nested loop per premise, in order. Variables are bound at
+			 * their first occurence, and checked against the fact at the
+			 * next ones.
+			 */
+			variableM vars;
+			std::string loop_indent = indent + "\t";
+			for (size_t i = 0; i < premises.size(); ++i) {
+				std::string it = indexed_name("it", i);
+				std::string p = indexed_name("p", i);
+				oss << loop_indent << "for (logic::facts::const_iterator " << it << " = f.begin(" << p << ".id);\n";
+				oss << loop_indent << "\t\t" << it << " != f.end(" << p << ".id); ++" << it << ") {\n";
+				loop_indent += "\t";
+
+				for (size_t j = 0; j < premises[i].args.size(); ++j) {
+					const pattern& arg = premises[i].args[j];
+					oss << loop_indent;
+					if (arg.k == pattern::CONSTANT) {
+						oss << "if (" << it << "->args[" << j << "] != " << p << ".args[" << j << "]) continue;\n";
+					} else if (vars.find(arg.var) != vars.end()) {
+						oss << "if (" << it << "->args[" << j << "] != " << var_name(vars, arg.var) << ") continue;\n";
+					} else {
+						size_t idx = vars.size();
+						vars[arg.var] = idx;
+						oss << "const logic::expression& " << var_name(vars, arg.var);
+						oss << " = " << it << "->args[" << j << "]; // " << arg.var << "\n";
+					}
+				}
+			}
+
+			oss << loop_indent << "++matches;\n";
+			if (conclusions.empty()) {
+				/* first match is enough to detect an inconsistency */
+				oss << loop_indent << "return matches;\n";
+			}
+
+			for (size_t i = 0; i < conclusions.size(); ++i) {
+				std::string name = indexed_name("c", i);
+				oss << loop_indent << "{\n";
+				dump_instance(oss, loop_indent + "\t", conclusions[i], vars, indexed_name("q", i), name);
+				oss << loop_indent << "\tres.push_back(" << name << ");\n";
+				oss << loop_indent << "}\n";
+			}
+
+			for (size_t i = premises.size(); i > 0; --i) {
+				loop_indent.erase(loop_indent.size() - 1);
+				oss << loop_indent << "}\n";
+			}
+
+			oss << indent << "\treturn matches;\n";
+			oss << indent << "}\n\n";
+		}
+	}
+}
@@ -9,6 +9,7 @@
 #include <compiler/extension.hh>
 #include <compiler/logic_expression_output.hh>
 #include <compiler/output.hh>
+#include <compiler/rule_matcher_output.hh>
 #include <compiler/universe.hh>
 #include <compiler/scope.hh>
 #include <compiler/task_parser.hh>
@@ -829,12 +830,14 @@ struct output_logic_rules {
 			oss << ",\n";
 		};
 		if (r.conclusions.empty()) 
-			oss << "\t\t\t\t\tstd::vector<std::string>());\n";
+			oss << "\t\t\t\t\tstd::vector<std::string>()";
 		else {
 			oss << "\t\t\t\t\tboost::assign::list_of";
 			std::for_each(r.conclusions.begin(), r.conclusions.end(), dump_rule(oss, a, u));
-			oss << ");\n";
 		};
+		if (can_compile_rule(r)) 
+			oss << ",\n\t\t\t\t\t&" << rule_matcher_name(r);
+		oss << ");\n";
 	}
 };
 
@@ -860,23 +863,32 @@ universe::dump_ability_import_module_impl(std::ostream& oss, const std::string&
 	}
 
 	oss << "#include <" << name << "/import.hh>\n\n";
+	oss << "#include <logic/facts.hh>\n";
+	oss << "#include <logic/rules.hh>\n";
 	oss << "#include <model/logic_layer_impl.hh>\n\n";
-	oss << "#include <boost/assign/list_of.hpp>\n\n";
+	oss << "#include <boost/assign/list_of.hpp>\n";
+	oss << "#include <boost/variant/get.hpp>\n\n";
 
 	//find functions prefixed by name::
 	std::vector<functionDef>  funcs = fList.select(select_ability_funs(name));
 
+	std::vector<rule_decl> rules; 
+	hyper::utils::copy_if(rList.l.begin(), rList.l.end(), std::back_inserter(rules), 
+						  is_local_rules(name));
+
 	namespaces n(oss, name);
+
+	/* specialised matchers for the rules, registered in import_funcs */
+	for (size_t i = 0; i < rules.size(); ++i)
+		if (can_compile_rule(rules[i]))
+			dump_rule_matcher(oss, rules[i]);
+
 	oss << "\t\t\tvoid import_funcs(model::ability &a) {" << std::endl;
 	std::vector<type> types = tList.select(import_types(name));
 
 	std::for_each(types.begin(), types.end(), output_logic_type(oss));
 	std::for_each(funcs.begin(), funcs.end(), output_import_helper(oss, *this));
 
-	std::vector<rule_decl> rules; 
-	hyper::utils::copy_if(rList.l.begin(), rList.l.end(), std::back_inserter(rules), 
-						  is_local_rules(name));
-
 	std::for_each(rules.begin(), rules.end(), output_logic_rules(oss, *it->second, *this));
 
 	oss << "\t\t\t}" << std::endl;
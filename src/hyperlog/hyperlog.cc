@@ -1,6 +1,9 @@
 #include <vector>
 #include <string>
 
+#include <network/compression.hh>
+#include <network/log_merge.hh>
+#include <network/log_store.hh>
 #include <network/msg.hh>
 #include <network/ping.hh>
 #include <network/nameserver.hh>
@@ -8,11 +11,17 @@
 
 #include <model/discover_root.hh>
 
+#include <boost/date_time/c_local_time_adjustor.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/optional/optional.hpp>
+#include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
 
+namespace po = boost::program_options;
 
 namespace {
 	typedef boost::mpl::vector<hyper::network::log_msg,
+							   hyper::network::log_msgs,
 							   hyper::network::inform_new_agent,
 							   hyper::network::inform_death_agent> input_msg;
 	typedef boost::mpl::vector<boost::mpl::void_> output_msg;
@@ -22,25 +31,46 @@ namespace {
 
 	struct logger_visitor : public boost::static_visitor<output_variant>
 	{
-		std::vector<hyper::network::log_msg> & log_msgs_;
+		hyper::network::log_merger & merger_;
 
-		logger_visitor(std::vector<hyper::network::log_msg>& log_msgs): log_msgs_(log_msgs) {}
+		logger_visitor(hyper::network::log_merger& merger): merger_(merger) {}
+
+		/* messages of hyperlog itself are dated on reception, never wait for them */
+		void push_root(const std::string& msg) const
+		{
+			merger_.push(hyper::network::log_msg("root", msg));
+			merger_.remove_source("root");
+		}
 
 		output_variant operator() (const hyper::network::log_msg& msg) const
 		{
-			log_msgs_.push_back(msg);
+			merger_.push(msg);
+			/* output what the new watermark of its agent releases */
+			merger_.flush(boost::posix_time::microsec_clock::universal_time());
+			return boost::mpl::void_();
+		}
+
+		output_variant operator() (const hyper::network::log_msgs& msgs) const
+		{
+			/* each line keeps its own stamp in the merge */
+			std::vector<hyper::network::log_msg> lines;
+			msgs.split(lines);
+			for (size_t i = 0; i < lines.size(); ++i)
+				merger_.push(lines[i]);
+			merger_.flush(boost::posix_time::microsec_clock::universal_time());
 			return boost::mpl::void_();
 		}
 
 		output_variant operator() (const hyper::network::inform_death_agent& msg) const
 		{
-			// don't care but avoids some warning message
 			std::ostringstream oss;
 			oss << "Following agent(s) die : ";
 			std::copy(msg.dead_agents.begin(), msg.dead_agents.end(),
 					  std::ostream_iterator<std::string>(oss, ", "));
-			hyper::network::log_msg log("root", oss.str());
-			log_msgs_.push_back(log);
+			push_root(oss.str());
+
+			for (size_t i = 0; i < msg.dead_agents.size(); ++i)
+				merger_.remove_source(msg.dead_agents[i]);
 
 			return boost::mpl::void_();
 		}
@@ -51,43 +81,33 @@ namespace {
 			oss << "New agent(s) in the system : ";
 			std::copy(msg.new_agents.begin(), msg.new_agents.end(),
 					  std::ostream_iterator<std::string>(oss, ", "));
-			hyper::network::log_msg log("root", oss.str());
-			log_msgs_.push_back(log);
+			push_root(oss.str());
 
 			return boost::mpl::void_();
 		}
 	};
 
-	struct cmp_log_msg_by_date
+	struct display_log 
 	{
-		bool operator() (const hyper::network::log_msg& msg1, 
-						 const hyper::network::log_msg& msg2) const
+		void operator() (const hyper::network::log_msg& msg) const
 		{
-			return (msg1.date < msg2.date);
+			std::cout << "[" << boost::posix_time::to_iso_string(msg.date) << "]";
+			std::cout << "[" << msg.src << "] ";
+			std::cout << msg.msg << std::endl;
 		}
 	};
 
-	struct too_young_msg
+	struct output_log
 	{
-		boost::posix_time::time_duration delay_;
+		boost::optional<hyper::network::log_store_writer&> store_;
 
-		too_young_msg(boost::posix_time::time_duration delay) : delay_(delay) {}
+		output_log(boost::optional<hyper::network::log_store_writer&> store) : store_(store) {}
 
-		bool operator() (const hyper::network::log_msg msg) const
+		void operator() (const hyper::network::log_msg& msg) const
 		{
-			boost::posix_time::ptime oldest(boost::posix_time::microsec_clock::local_time());
-			oldest -= delay_;
-			return (msg.date > oldest);
-		}
-	};
-
-	struct display_log 
-	{
-		void operator() (const hyper::network::log_msg& msg)
-		{
-			std::cout << "[" << boost::posix_time::to_iso_string(msg.date) << "]";
-			std::cout << "[" << msg.src << "] ";
-			std::cout << msg.msg << std::endl;
+			display_log()(msg);
+			if (store_)
+				store_->append(msg);
 		}
 	};
 
@@ -98,28 +118,23 @@ namespace {
 		boost::posix_time::time_duration delay_;
 		boost::asio::deadline_timer timer_;
 
-		std::vector<hyper::network::log_msg> & log_msgs_;
-
+		hyper::network::log_merger & merger_;
+		boost::optional<hyper::network::log_store_writer&> store_;
 
 		periodic_check(boost::asio::io_service& io_s, 
 					   boost::posix_time::time_duration delay,
-					   std::vector<hyper::network::log_msg>& log_msgs):
+					   hyper::network::log_merger& merger,
+					   boost::optional<hyper::network::log_store_writer&> store):
 			io_s_(io_s), delay_(delay), timer_(io_s_),
-			log_msgs_(log_msgs)
+			merger_(merger), store_(store)
 		{}
 
 		void handle_timeout(const boost::system::error_code& e)
 		{
-			/* Make a chance to reorder msg in the right way */
 			if (!e) {
-				std::sort(log_msgs_.begin(), log_msgs_.end(), cmp_log_msg_by_date());
-				std::vector<hyper::network::log_msg>::iterator it;
-				it = std::find_if(log_msgs_.begin(), log_msgs_.end(), too_young_msg(delay_*2));
-				if (it != log_msgs_.begin())
-				{
-					std::for_each(log_msgs_.begin(), it, display_log());
-					log_msgs_.erase(log_msgs_.begin(), it); 
-				}
+				merger_.flush(boost::posix_time::microsec_clock::universal_time());
+				if (store_)
+					store_->flush();
 
 				run();
 			}
@@ -133,25 +148,130 @@ namespace {
 									  boost::asio::placeholders::error));
 		}
 	};
+
+	void usage(const po::options_description& desc)
+	{
+		std::cout << "Usage: hyperlog [options]\n";
+		std::cout << desc;
+	}
+
+	/* The store is indexed on hybrid clock timestamps, in universal time */
+	boost::posix_time::ptime local_to_utc(const std::string& date)
+	{
+		using namespace boost::posix_time;
+		typedef boost::date_time::c_local_adjustor<ptime> adjustor;
+
+		ptime now = second_clock::universal_time();
+		return time_from_string(date) - (adjustor::utc_to_local(now) - now);
+	}
+
+	int query(const po::variables_map& vm)
+	{
+		hyper::network::log_query q;
+		if (vm.count("since"))
+			q.since = local_to_utc(vm["since"].as<std::string>());
+		if (vm.count("until"))
+			q.until = local_to_utc(vm["until"].as<std::string>());
+		if (vm.count("agent"))
+			q.agent = vm["agent"].as<std::string>();
+		if (vm.count("grep"))
+			q.grep = vm["grep"].as<std::string>();
+
+		hyper::network::log_store_reader reader(vm["query"].as<std::string>());
+		reader.query(q, display_log());
+		return 0;
+	}
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help,h", "produce help message")
+		("store,s", po::value<std::string>(), "also append the merged logs to this store")
+		("query,q", po::value<std::string>(), "print the logs of this store and exit")
+		("since", po::value<std::string>(), "with --query, logs from this date (YYYY-MM-DD HH:MM:SS)")
+		("until", po::value<std::string>(), "with --query, logs up to this date (YYYY-MM-DD HH:MM:SS)")
+		("agent,a", po::value<std::string>(), "with --query, logs of this agent only")
+		("grep,g", po::value<std::string>(), "with --query, logs matching this extended regex only")
+		("compression-threshold", po::value<size_t>()->default_value(
+									hyper::network::compression_threshold()),
+		 "accept compressed logs bigger than this number of bytes (0 to disable)")
+		;
+
+	po::variables_map vm;
+	try {
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+		po::notify(vm);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		usage(desc);
+		return -1;
+	}
+
+	if (vm.count("help")) {
+		usage(desc);
+		return 0;
+	}
+
+	if (vm.count("query")) {
+		try {
+			return query(vm);
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			return -1;
+		}
+	}
+
+	hyper::network::set_compression_threshold(vm["compression-threshold"].as<size_t>());
+
 	typedef hyper::network::tcp::server<input_msg, output_msg, logger_visitor> logger_server;
 	boost::asio::io_service io_s;
-	std::vector<hyper::network::log_msg> msgs;
+
+	boost::scoped_ptr<hyper::network::log_store_writer> store_writer;
+	boost::optional<hyper::network::log_store_writer&> store;
+	if (vm.count("store")) {
+		try {
+			store_writer.reset(new hyper::network::log_store_writer(vm["store"].as<std::string>()));
+		} catch (const hyper::network::log_store_error& e) {
+			std::cerr << e.what() << std::endl;
+			return -1;
+		}
+		store = *store_writer;
+	}
+
+	/* agents which don't log are waited for two periods at most */
+	boost::posix_time::time_duration delay = boost::posix_time::milliseconds(100);
+	hyper::network::log_merger merger(output_log(store), delay * 2);
 
 	hyper::model::discover_root discover;
 	hyper::network::name_client name_client_(io_s, discover.root_addr(), discover.root_port());
-	logger_visitor vis(msgs);
+	logger_visitor vis(merger);
 	logger_server serv(vis, io_s);
-	bool res = name_client_.register_name("logger", serv.local_endpoints());
+	std::vector<std::string> local_addrs;
+#ifdef HYPER_HAS_LOCAL_SOCKETS
+	typedef hyper::network::tcp::server<input_msg, output_msg, logger_visitor,
+										boost::asio::local::stream_protocol> local_logger_server;
+	boost::scoped_ptr<local_logger_server> local_serv;
+	std::string local_path = hyper::network::local_socket_path("logger");
+	/* without a unix socket, the agents still reach us through tcp */
+	try {
+		if (!local_path.empty()) {
+			local_serv.reset(new local_logger_server(
+					boost::asio::local::stream_protocol::endpoint(local_path), vis, io_s));
+			local_addrs.push_back(local_path);
+		}
+	} catch (const std::exception& e) {
+		std::cerr << "Can't listen on " << local_path << " : " << e.what() << std::endl;
+	}
+#endif
+	bool res = name_client_.register_name("logger", serv.local_endpoints(), local_addrs);
 	if (res == false) {
 		std::cerr << "Failed to register logger, exiting ... " << std::endl;
 		return -1;
 	}
 
-	periodic_check check(io_s, boost::posix_time::milliseconds(100), msgs);
+	periodic_check check(io_s, delay, merger, store);
 	hyper::network::ping_process ping(io_s, boost::posix_time::milliseconds(100),
 									  "logger", discover.root_addr(), discover.root_port());
 
@@ -1,6 +1,9 @@
 #include <network/actor_protocol.hh>
+#include <network/compression.hh>
+#include <network/failure_detector.hh>
 #include <network/log.hh>
 #include <network/nameserver.hh>
+#include <network/timer_wheel.hh>
 
 #include <hyperConfig.hh>
 
@@ -30,11 +33,23 @@ namespace details {
 	struct ability_context 
 	{
 		network::ns::addr_storage addr;
-		int timeout_occurence;
+		/* key of the agent in the liveness timing wheel */
+		network::identifier liveness_id;
 	};
 	
 	typedef std::map<std::string, ability_context> runtime_map;
 
+	network::request_name_answer make_answer(const std::string& name, const ability_context& ctx)
+	{
+		network::request_name_answer ans;
+		ans.name = name;
+		ans.success = true;
+		ans.endpoints = ctx.addr.tcp_endpoints;
+		ans.host = ctx.addr.host;
+		ans.local_endpoints = ctx.addr.local_endpoints;
+		return ans;
+	}
+
 	struct trivial_name_client {
 		const runtime_map& map;
 
@@ -45,10 +60,15 @@ namespace details {
 		{
 			runtime_map::const_iterator it = map.find(solv.name());
 			solv.rna.success = (it != map.end());
-			if (it != map.end()) 
+			if (it != map.end()) {
 				solv.rna.endpoints = it->second.addr.tcp_endpoints;
+				solv.rna.host = it->second.addr.host;
+				solv.rna.local_endpoints = it->second.addr.local_endpoints;
+			}
 			handler(boost::system::error_code());
 		}
+
+		void invalidate(const std::string&) {}
 	};
 
 	struct runtime_actor {
@@ -62,17 +82,12 @@ namespace details {
 				    name_client(map),
 					logger(io_s, name, "logger", name_client, DEBUG_ALL)
 		{}
+
+		bool log_enabled(int level) const { return logger.enabled(level); }
 	};
 
 	typedef hyper::network::actor_client_database<runtime_actor> client_db;
 
-	void handle_new_agent_write(const boost::system::error_code&,
-							    boost::shared_ptr<network::inform_new_agent> ptr)
-	{
-		// let the system release the last reference on ptr
-		(void) ptr;
-	}
-
 	void handle_list_agents(const boost::system::error_code&,
 							boost::shared_ptr<network::list_agents> ptr)
 	{
@@ -80,42 +95,138 @@ namespace details {
 		(void) ptr;
 	}
 
-	struct broadcast_inform  {
-		boost::shared_ptr<network::inform_new_agent> ptr;
-		client_db &db;
+	struct agent_name
+	{
+		std::string operator() (const std::pair<std::string, ability_context>& p) const
+		{
+			return p.first;
+		}
+	};
+
+
+	/*
+	 * Track the liveness of the agents. Each message naming its sender
+	 * is a heartbeat, and arms a deadline in a timing wheel, at the time
+	 * the phi accrual detector would suspect the agent. So nothing is
+	 * done for the living agents, whatever their number.
+	 */
+	struct liveness_check
+	{
+		boost::asio::io_service& io_s_;
+
+		runtime_map& map_;
+		client_db& db_;
+		boost::uint64_t& directory_version_;
+
+		boost::posix_time::time_duration tick_;
+		network::phi_accrual_detector detector_;
+		network::timer_wheel wheel_;
+		std::map<network::identifier, std::string> names_;
+		network::identifier next_id_;
+
+		/* agents found dead, not yet announced to the survivors */
+		std::vector<std::string> dead_agents_;
+
+		liveness_check(boost::asio::io_service& io_s, runtime_map& map, client_db& db,
+					   boost::uint64_t& directory_version,
+					   double threshold, boost::posix_time::time_duration interval) :
+			io_s_(io_s), map_(map), db_(db), directory_version_(directory_version),
+			tick_(interval / 10),
+			detector_(threshold, 100, interval / 5, interval),
+			wheel_(io_s, boost::bind(&liveness_check::handle_expire, this, _1), tick_),
+			next_id_(0)
+		{}
 
-		broadcast_inform (boost::shared_ptr<network::inform_new_agent> ptr_,
-						 client_db& db) :
-			ptr(ptr_), db(db) {}
+		/* Start to monitor a newly registered agent */
+		network::identifier watch(const std::string& name)
+		{
+			network::identifier id = next_id_++;
+			names_[id] = name;
+			detector_.heartbeat(name, boost::posix_time::microsec_clock::universal_time());
+			wheel_.schedule(id, detector_.suspicion_delay(name));
+			return id;
+		}
 
-		void operator() (const std::pair<std::string, ability_context>& p) const
+		void heartbeat(const std::string& name)
 		{
-			std::vector<std::string>::const_iterator it;
-			it = std::find(ptr->new_agents.begin(), ptr->new_agents.end(),
-						   p.first);
-			/* Don't send a message to new agent, they know their own existence */
-			if (it != ptr->new_agents.end())
-				return; 
-
-			db[p.first].async_write(*ptr, 
-					boost::bind(&handle_new_agent_write,
-						boost::asio::placeholders::error,
-						ptr));
+			runtime_map::const_iterator it = map_.find(name);
+			if (it == map_.end())
+				return;
+
+			detector_.heartbeat(name, boost::posix_time::microsec_clock::universal_time());
+			wheel_.schedule(it->second.liveness_id, detector_.suspicion_delay(name));
 		}
-	};
 
+		void handle_expire(network::identifier id)
+		{
+			std::map<network::identifier, std::string>::iterator it = names_.find(id);
+			if (it == names_.end())
+				return;
+
+			std::string name = it->second;
+			boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+			if (detector_.is_available(name, now)) {
+				/* the wheel may be up to one tick early */
+				wheel_.schedule(id, tick_);
+				return;
+			}
+
+			names_.erase(it);
+			detector_.remove(name);
+			db_[name].close();
+			map_.erase(name);
+
+			/* announce all the agents dead at the same time in one message */
+			if (dead_agents_.empty())
+				io_s_.post(boost::bind(&liveness_check::inform_survivors, this));
+			dead_agents_.push_back(name);
+		}
+
+		void inform_survivors()
+		{
+			network::inform_death_agent msg;
+
+			/* an agent may have registered again since its death (quick restart) */
+			std::vector<std::string> dead;
+			std::swap(dead, dead_agents_);
+			for (size_t i = 0; i < dead.size(); ++i)
+				if (map_.find(dead[i]) == map_.end())
+					msg.dead_agents.push_back(dead[i]);
+
+			if (msg.dead_agents.empty())
+				return;
+
+			std::cout << "the following agents seems dead : ";
+			std::copy(msg.dead_agents.begin(), msg.dead_agents.end(), 
+					  std::ostream_iterator<std::string>(std::cout, " "));
+			std::cout << std::endl;
+
+			msg.directory_version = ++directory_version_;
+
+			std::vector<std::string> survivors;
+			std::transform(map_.begin(), map_.end(), std::back_inserter(survivors),
+						   agent_name());
+			db_.broadcast(msg, survivors.begin(), survivors.end());
+		}
+	};
 
 	struct runtime_visitor : public boost::static_visitor<output_variant>
 	{
 		runtime_map &map;
 		client_db &db;
+		liveness_check &liveness;
+		/* incremented on each change of map, pushed to the agents */
+		boost::uint64_t &directory_version;
 		const std::vector<boost::asio::ip::tcp::endpoint>& root_endpoint;
 
 		runtime_visitor(runtime_map& map_, 
 						client_db &db,
+						liveness_check &liveness,
+						boost::uint64_t &directory_version,
 						const std::vector<boost::asio::ip::tcp::endpoint>& root_endpoint
 						) :
-			map(map_), db(db), root_endpoint(root_endpoint)
+			map(map_), db(db), liveness(liveness), directory_version(directory_version),
+			root_endpoint(root_endpoint)
 		{}
 
 		output_variant operator() (const network::request_name& r) const
@@ -130,8 +241,11 @@ namespace details {
 				runtime_map::iterator it = map.find(r.name);
 
 				res_msg.success = (it != map.end());
-				if (it != map.end()) 
+				if (it != map.end()) {
 					res_msg.endpoints = it->second.addr.tcp_endpoints;
+					res_msg.host = it->second.addr.host;
+					res_msg.local_endpoints = it->second.addr.local_endpoints;
+				}
 			}
 
 			return res_msg;
@@ -143,11 +257,13 @@ namespace details {
 
 			ability_context ctx;
 			ctx.addr.tcp_endpoints = r.endpoints;
-			ctx.timeout_occurence = 0;
+			ctx.addr.host = r.host;
+			ctx.addr.local_endpoints = r.local_endpoints;
 
 			runtime_map::iterator it = map.find(r.name);
 			bool already_here = (it != map.end());
 			if (!already_here) {
+				ctx.liveness_id = liveness.watch(r.name);
 				map.insert(std::make_pair(r.name, ctx));
 			}
 
@@ -156,10 +272,26 @@ namespace details {
 			res_msg.success = !already_here;
 
 			if (!already_here) {
-				boost::shared_ptr<network::inform_new_agent> ptr_msg;
-				ptr_msg = boost::make_shared<network::inform_new_agent>();
-				ptr_msg->new_agents.push_back(r.name);
-				std::for_each(map.begin(), map.end(), broadcast_inform(ptr_msg, db));
+				directory_version++;
+
+				/* the new agent gets the whole directory, the others the delta */
+				res_msg.directory_version = directory_version;
+				res_msg.directory.reserve(map.size());
+				runtime_map::const_iterator it;
+				for (it = map.begin(); it != map.end(); ++it)
+					res_msg.directory.push_back(make_answer(it->first, it->second));
+
+				network::inform_new_agent msg;
+				msg.new_agents.push_back(r.name);
+				msg.directory_version = directory_version;
+				msg.addresses.push_back(make_answer(r.name, ctx));
+
+				/* Don't send a message to new agent, they know their own existence */
+				std::vector<std::string> others;
+				for (it = map.begin(); it != map.end(); ++it)
+					if (it->first != r.name)
+						others.push_back(it->first);
+				db.broadcast(msg, others.begin(), others.end());
 			}
 
 			return res_msg;
@@ -167,23 +299,15 @@ namespace details {
 
 		output_variant operator() (const network::ping& p) const
 		{
-			runtime_map::iterator it = map.find(p.name);
-			if (it != map.end())
-				it->second.timeout_occurence = 0;
-
+			liveness.heartbeat(p.name);
 			return boost::mpl::void_();
 		}
 
-		struct agent_name
-		{
-			std::string operator() (const std::pair<std::string, ability_context>& p) const
-			{
-				return p.first;
-			}
-		};
-
 		output_variant operator() (const network::request_list_agents& p) const
 		{
+			/* any message of an agent is a proof of its liveness */
+			liveness.heartbeat(p.src);
+
 			boost::shared_ptr<network::list_agents> agents = boost::make_shared<network::list_agents>();
 			/* copy the request key in the answer */
 			agents->id = p.id;
@@ -198,92 +322,6 @@ namespace details {
 		}
 	};
 
-	struct periodic_check
-	{
-		boost::asio::io_service& io_s_;
-
-		boost::posix_time::time_duration delay_;
-		boost::asio::deadline_timer timer_;
-
-		runtime_map& map_;
-		client_db& db_;
-
-		periodic_check(boost::asio::io_service& io_s, 
-					   boost::posix_time::time_duration delay,
-					   runtime_map& map, client_db& db) :
-			io_s_(io_s), delay_(delay), timer_(io_s_),
-			map_(map), db_(db)
-		{}
-
-
-		void handle_write(const boost::system::error_code&, 
-						  boost::shared_ptr<network::inform_death_agent> ptr)
-		{
-			// do nothing, decrement ptr ref, so it will be released correctly
-			// when all write are finished
-			(void) ptr;
-		}
-
-		struct inform_survivor {
-			periodic_check & check;
-			boost::shared_ptr<network::inform_death_agent> ptr;
-
-			inform_survivor(periodic_check& check_,
-					boost::shared_ptr<network::inform_death_agent> ptr_) :
-				check(check_), ptr(ptr_) {}
-
-			void operator() (const std::pair<std::string, ability_context>& p) const
-			{
-				check.db_[p.first].async_write(*ptr, 
-						boost::bind(&periodic_check::handle_write, &check, 
-									boost::asio::placeholders::error,
-									ptr));
-			}
-		};
-
-		void handle_timeout(const boost::system::error_code& e)
-		{
-			if (!e) {
-				std::vector<std::string> dead_agents;
-				runtime_map::iterator it = map_.begin();
-				while (it != map_.end())
-				{
-					if (it->second.timeout_occurence > 2) {
-						dead_agents.push_back(it->first);
-						db_[it->first].close();
-						map_.erase(it++);
-					} else {
-						it->second.timeout_occurence++;
-						++it;
-					}
-				}
-
-				if (! dead_agents.empty()) {
-					boost::shared_ptr<network::inform_death_agent> ptr_msg;
-					ptr_msg = boost::make_shared<network::inform_death_agent>();
-
-					std::cout << "the following agents seems dead : ";
-					std::copy(dead_agents.begin(), dead_agents.end(), 
-							  std::ostream_iterator<std::string>(std::cout, " "));
-					std::cout << std::endl;
-
-					std::swap(ptr_msg->dead_agents, dead_agents);
-					std::for_each(map_.begin(), map_.end(), inform_survivor(*this, ptr_msg));
-				}
-
-				run();
-			}
-		}
-
-		void run()
-		{
-			timer_.expires_from_now(delay_);
-			timer_.async_wait(boost::bind(&periodic_check::handle_timeout, 
-									  this,
-									  boost::asio::placeholders::error));
-		}
-	};
-
 }
 
 void usage(const po::options_description& desc, const std::string& name)
@@ -295,12 +333,19 @@ void usage(const po::options_description& desc, const std::string& name)
 int main(int argc, char** argv)
 {
 	int port;
+	double phi_threshold;
+	size_t compression_threshold;
 
 	po::options_description desc("Allowed options");
 	desc.add_options()
 		("help,h", "produce help message")
 		("port,p", po::value<int>(&port)->default_value(4242),
 				   "select the port where hyperruntime listen")
+		("phi-threshold", po::value<double>(&phi_threshold)->default_value(8.0),
+				   "suspicion level from which an agent is considered dead")
+		("compression-threshold", po::value<size_t>(&compression_threshold)->default_value(
+										hyper::network::compression_threshold()),
+				   "compress the messages bigger than this number of bytes (0 to disable)")
 	;
 
 	po::variables_map vm;
@@ -318,13 +363,22 @@ int main(int argc, char** argv)
 		exit(-1);
 	}
 
+	if (phi_threshold <= 0) {
+		std::cerr << "Invalid phi threshold " << phi_threshold << std::endl;
+		exit(-1);
+	}
+
+	hyper::network::set_compression_threshold(compression_threshold);
 
 	std::vector<boost::asio::ip::tcp::endpoint> root_endpoints;
 	details::runtime_map map;
 	details::runtime_actor actor(map);
 	details::client_db db(actor);
 
-	details::runtime_visitor runtime_vis(map, db, root_endpoints);
+	boost::uint64_t directory_version = 0;
+	details::liveness_check liveness(actor.io_s, map, db, directory_version, phi_threshold,
+			boost::posix_time::microseconds(static_cast<long>(AGENT_TIMEOUT * 1000)));
+	details::runtime_visitor runtime_vis(map, db, liveness, directory_version, root_endpoints);
 
 	typedef network::tcp::server<details::input_msg, 
 								  details::output_msg, 
@@ -334,11 +388,6 @@ int main(int argc, char** argv)
         tcp_runtime_impl runtime(port, runtime_vis, actor.io_s);
         root_endpoints = runtime.local_endpoints();
 
-        details::periodic_check check( actor.io_s, 
-                                       boost::posix_time::milliseconds(AGENT_TIMEOUT), 
-                                       map, db);
-                             
-        check.run();
         actor.io_s.run();
 	} catch(const boost::system::system_error& e) {
 		std::cerr << "Error detected : " << e.what() << "\nExiting ..." << std::endl;
@@ -130,17 +130,24 @@ namespace {
 	{
 		const function_call &f;
 		std::vector<unifyM>& unify_vect;
+		engine_stats* stats;
 
-		apply_goal_unification(const function_call& f_, std::vector<unifyM>& unify_vect_):
-			f(f_), unify_vect(unify_vect_)
+		apply_goal_unification(const function_call& f_, std::vector<unifyM>& unify_vect_,
+							   engine_stats* stats):
+			f(f_), unify_vect(unify_vect_), stats(stats)
 		{}
 
 		void operator() (const function_call& f_rule)
 		{
 			unifyM m;
 			unify_res r = unify(f_rule, f, m);
-			if (r.first)
+			if (stats)
+				++stats->unify_attempts;
+			if (r.first) {
+				if (stats)
+					++stats->unify_successes;
 				unify_vect.push_back(r.second);
+			}
 		}
 	};
 }
@@ -183,6 +190,8 @@ namespace hyper { namespace logic {
 		assert(current < node_id_generator); 
 
 		bm_node.insert(bm_node_type::value_type(current, n));
+		if (stats)
+			++stats->proof_nodes;
 
 		return current;
 	}
@@ -261,7 +270,7 @@ namespace hyper { namespace logic {
 				} else {
 					facts_ctx current_facts = ctx;
 					current_facts.add(hyp.f);
-					if (!is_world_consistent(rs, current_facts)) {
+					if (!is_world_consistent(rs, current_facts, stats)) {
 						n.state = proven_false;
 						hyp.state = proven_false;
 					}
@@ -348,7 +357,7 @@ namespace hyper { namespace logic {
 			std::vector<unifyM> unify_vect;
 
 			std::for_each(r.action.begin(), r.action.end(),
-						  apply_goal_unification(f, unify_vect));
+						  apply_goal_unification(f, unify_vect, t.stats));
 
 			if (unify_vect.empty())
 				return;
@@ -384,6 +393,8 @@ namespace hyper { namespace logic {
 					while (has_next)
 					{
 						has_next = candidates.next(m);
+						if (t.stats)
+							++t.stats->candidates;
 						std::vector<function_call> v_f;
 						std::transform(r.condition.begin(), r.condition.end(),
 								std::back_inserter(v_f),
@@ -574,7 +585,7 @@ namespace hyper { namespace logic {
 
 	bool backward_chaining::infer(const function_call& f)
 	{
-		details::proof_tree tree(ctx, rs);
+		details::proof_tree tree(ctx, rs, stats);
 		boost::logic::tribool b = tree.compute(f);
 		return b;
 	}
@@ -582,7 +593,7 @@ namespace hyper { namespace logic {
 	bool backward_chaining::infer(const function_call& f, std::vector<function_call>& hyp)
 	{
 		hyp.clear();
-		details::proof_tree tree(ctx, rs);
+		details::proof_tree tree(ctx, rs, stats);
 		boost::logic::tribool b = tree.compute(f);
 		if (boost::logic::indeterminate(b)) 
 			tree.fill_hypothesis(f, hyp);
@@ -26,10 +26,11 @@ namespace {
 		const facts& facts_;
 		std::vector<unifyM>& unify_vect;
 		const function_call &f;
+		engine_stats* stats;
 
 		apply_unification_(const facts& facts__, std::vector<unifyM>& unify_vect__,
-						   const function_call &f_):
-			facts_(facts__), unify_vect(unify_vect__), f(f_)
+						   const function_call &f_, engine_stats* stats):
+			facts_(facts__), unify_vect(unify_vect__), f(f_), stats(stats)
 		{}
 
 		void operator() (const  unifyM& m)
@@ -38,8 +39,13 @@ namespace {
 			for (facts::const_iterator it = facts_.begin(id) ; it != facts_.end(id); ++it)
 			{
 				unify_res r = unify(f, *it, m);
-				if (r.first)
+				if (stats)
+					++stats->unify_attempts;
+				if (r.first) {
+					if (stats)
+						++stats->unify_successes;
 					unify_vect.push_back(r.second);
+				}
 			}
 		}
 	};
@@ -51,16 +57,18 @@ namespace {
 	{
 		const facts& facts_;
 		std::vector<unifyM>& unify_vect;
+		engine_stats* stats;
 
-		apply_unification(const facts& facts__, std::vector<unifyM>& unify_vect__):
-			facts_(facts__), unify_vect(unify_vect__)
+		apply_unification(const facts& facts__, std::vector<unifyM>& unify_vect__,
+						  engine_stats* stats):
+			facts_(facts__), unify_vect(unify_vect__), stats(stats)
 		{}
 
 		void operator() (const function_call& f)
 		{
 			std::vector<unifyM> tmp;
 			std::for_each(unify_vect.begin(), unify_vect.end(), 
-						  apply_unification_(facts_, tmp, f));
+						  apply_unification_(facts_, tmp, f, stats));
 
 			unify_vect = tmp;
 		}
@@ -145,7 +153,7 @@ namespace {
 	};
 
 	std::vector<unifyM> 
-	compute_rule_unification(const rule& r, const facts_ctx& facts)
+	compute_rule_unification(const rule& r, const facts_ctx& facts, engine_stats* stats)
 	{
 		// generate an empty ctx for starting the algorithm
 		std::vector<unifyM> unify_vect(1);
@@ -155,19 +163,26 @@ namespace {
 		 * and one condition, refining unifyM context at each condition. 
 		 */
 		std::for_each(r.condition.begin(), r.condition.end(), 
-					  apply_unification(facts.f, unify_vect));
+					  apply_unification(facts.f, unify_vect, stats));
 
 		return unify_vect;
 	}
 
 	struct lead_to_inconsistency {
 		const facts_ctx& facts;
+		engine_stats* stats;
 
-		lead_to_inconsistency(const facts_ctx& facts) : facts(facts) {}
+		lead_to_inconsistency(const facts_ctx& facts, engine_stats* stats) :
+			facts(facts), stats(stats) {}
 
 		bool operator() (const rule& r)
 		{
-			std::vector<unifyM> vec = compute_rule_unification(r, facts);
+			if (r.matcher) {
+				std::vector<function_call> unused;
+				return (r.matcher(r, facts.f, unused) != 0);
+			}
+
+			std::vector<unifyM> vec = compute_rule_unification(r, facts, stats);
 			return !vec.empty();
 		}
 	};
@@ -185,19 +200,36 @@ namespace {
 	struct apply_rule 
 	{
 		facts_ctx& facts;
+		engine_stats* stats;
 
-		apply_rule(facts_ctx& facts) : facts(facts) {};
+		apply_rule(facts_ctx& facts, engine_stats* stats) : facts(facts), stats(stats) {};
 
 		bool operator() (const rule& r)
 		{
-			std::vector<unifyM> unify_vect = compute_rule_unification(r, facts);
-
-			// generating new fact
 			size_t facts_size = facts.f.size();
-			std::for_each(r.action.begin(), r.action.end(),
-						  add_facts(facts.f, unify_vect));
 
-			return (facts.f.size() != facts_size);
+			if (r.matcher) {
+				std::vector<function_call> new_facts;
+				r.matcher(r, facts.f, new_facts);
+
+				bool (facts::*add_f) (const function_call& f) = & facts::add;
+				std::for_each(new_facts.begin(), new_facts.end(),
+							  boost::bind(add_f, boost::ref(facts.f), _1));
+			} else {
+				std::vector<unifyM> unify_vect = compute_rule_unification(r, facts, stats);
+
+				// generating new fact
+				std::for_each(r.action.begin(), r.action.end(),
+							  add_facts(facts.f, unify_vect));
+			}
+
+			bool fired = (facts.f.size() != facts_size);
+			if (stats) {
+				++stats->rules_tried;
+				if (fired)
+					++stats->rules_fired;
+			}
+			return fired;
 		}
 	};
 
@@ -285,7 +317,7 @@ namespace {
 
 namespace hyper {
 	namespace logic {
-		engine::engine() : rules_(funcs_) 
+		engine::engine() : rules_(funcs_), stats_enabled_(false)
 		{}
 
 		bool engine::add_type(const std::string& name)
@@ -446,11 +478,16 @@ namespace hyper {
 		}
 
 		bool engine::generate_theory(facts_ctx& current_facts, const std::string& identifier) {
+			engine_stats* stats = stats_ptr();
+			stats_timer timer(stats ? &stats->add_fact_time : 0);
+			if (stats)
+				++stats->add_fact_calls;
+
 			apply_rules(current_facts);
 
 			/* If the new fact does not lead to any inconstency, really commit
 			 * it */
-			if (is_world_consistent(rules_, current_facts)) {
+			if (is_world_consistent(rules_, current_facts, stats)) {
 				set_facts(identifier, current_facts);
 				return true;
 			} else 
@@ -465,13 +502,8 @@ namespace hyper {
 			facts_ctx current_facts = get_facts(identifier);
 				std::for_each(exprs.begin(), exprs.end(), 
 						  boost::bind(f, boost::ref(current_facts), _1));
-			apply_rules(current_facts);
 
-			if (is_world_consistent(rules_, current_facts)) {
-				set_facts(identifier, current_facts);
-				return true;
-			} else 
-				return false;
+			return generate_theory(current_facts, identifier);
 		}
 
 		/*
@@ -480,15 +512,22 @@ namespace hyper {
 		 */
 		void engine::apply_rules(facts_ctx& current_facts)
 		{
+			engine_stats* stats = stats_ptr();
+			stats_timer timer(stats ? &stats->apply_rules_time : 0);
+
 			current_facts.new_rule();
 			rules::const_iterator it = rules_.begin();
+			if (stats)
+				++stats->fixpoint_iterations;
 
 			while (it != rules_.end())
 			{
-				bool new_fact = apply_rule(current_facts)(*it);
-				if (new_fact) 
+				bool new_fact = apply_rule(current_facts, stats)(*it);
+				if (new_fact) {
 					it = rules_.begin();
-				else
+					if (stats)
+						++stats->fixpoint_iterations;
+				} else
 					++it;
 			}
 		}
@@ -496,6 +535,11 @@ namespace hyper {
 		boost::logic::tribool engine::infer_(const function_call& f,
 											const std::string& identifier)
 		{
+			engine_stats* stats = stats_ptr();
+			stats_timer timer(stats ? &stats->infer_time : 0);
+			if (stats)
+				++stats->infer_calls;
+
 			facts_ctx& current_facts = get_facts(identifier);
 
 			boost::logic::tribool b = current_facts.f.matches(f);
@@ -506,8 +550,11 @@ namespace hyper {
 
 			current_facts.compute_possible_expression(rules_);
 
-			backward_chaining chaining(rules_, current_facts);
-			has_concluded = chaining.infer(f);
+			backward_chaining chaining(rules_, current_facts, stats);
+			{
+				stats_timer bc_timer(stats ? &stats->backward_chaining_time : 0);
+				has_concluded = chaining.infer(f);
+			}
 			
 			if (has_concluded)
 				return true;
@@ -519,6 +566,11 @@ namespace hyper {
 										    std::vector<function_call>& hyps,
 											const std::string& identifier)
 		{
+			engine_stats* stats = stats_ptr();
+			stats_timer timer(stats ? &stats->infer_time : 0);
+			if (stats)
+				++stats->infer_calls;
+
 			facts_ctx& current_facts = get_facts(identifier);
 			boost::logic::tribool b = current_facts.f.matches(f);
 			if (!boost::logic::indeterminate(b))
@@ -528,9 +580,12 @@ namespace hyper {
 
 			current_facts.compute_possible_expression(rules_);
 
-			backward_chaining chaining(rules_, current_facts);
+			backward_chaining chaining(rules_, current_facts, stats);
 			std::vector<function_call> hyps_;
-			has_concluded = chaining.infer(f, hyps_);
+			{
+				stats_timer bc_timer(stats ? &stats->backward_chaining_time : 0);
+				has_concluded = chaining.infer(f, hyps_);
+			}
 
 			if (has_concluded)
 				return true;
@@ -551,7 +606,7 @@ namespace hyper {
 		}
 
 		bool
-		is_world_consistent(const rules& rs, facts_ctx& facts)
+		is_world_consistent(const rules& rs, facts_ctx& facts, engine_stats* stats)
 		{
 			std::vector<rule> rules;
 			hyper::utils::copy_if(rs.begin(), rs.end(), std::back_inserter(rules),
@@ -563,7 +618,7 @@ namespace hyper {
 						boost::bind(&facts::matches, &facts.f, _1));
 
 			bool res = ! hyper::utils::any(rules.begin(), rules.end(), 
-									 lead_to_inconsistency(facts));
+									 lead_to_inconsistency(facts, stats));
 			res = res and hyper::utils::all(matches.begin(), matches.end(),
 										   std::bind2nd(std::equal_to<bool>(), true));
 			return res;
@@ -0,0 +1,39 @@
+#include <logic/engine_stats.hh>
+
+#include <boost/date_time/posix_time/posix_time_io.hpp>
+
+namespace hyper {
+	namespace logic {
+		void engine_stats::reset()
+		{
+			add_fact_calls = 0;
+			infer_calls = 0;
+			fixpoint_iterations = 0;
+			rules_tried = 0;
+			rules_fired = 0;
+			unify_attempts = 0;
+			unify_successes = 0;
+			proof_nodes = 0;
+			candidates = 0;
+
+			add_fact_time = boost::posix_time::time_duration();
+			apply_rules_time = boost::posix_time::time_duration();
+			infer_time = boost::posix_time::time_duration();
+			backward_chaining_time = boost::posix_time::time_duration();
+		}
+
+		std::ostream& operator << (std::ostream& os, const engine_stats& s)
+		{
+			os << "add_fact : " << s.add_fact_calls << " calls in " << s.add_fact_time << "\n";
+			os << "  apply_rules : " << s.apply_rules_time << ", ";
+			os << s.fixpoint_iterations << " iterations, ";
+			os << s.rules_fired << "/" << s.rules_tried << " rules fired\n";
+			os << "infer : " << s.infer_calls << " calls in " << s.infer_time << "\n";
+			os << "  backward_chaining : " << s.backward_chaining_time << ", ";
+			os << s.proof_nodes << " proof nodes, ";
+			os << s.candidates << " candidates\n";
+			os << "unify : " << s.unify_successes << "/" << s.unify_attempts << " succeeded";
+			return os;
+		}
+	}
+}
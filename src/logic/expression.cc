@@ -1,4 +1,5 @@
 #include <logic/expression.hh>
+#include <logic/generate_cache.hh>
 
 #include <iostream>
 
@@ -381,6 +382,12 @@ namespace hyper {
 
 		generate_return generate(const std::string& expr, const funcDefList& funcs)
 		{
+			generate_return result;
+			if (funcs.cache().get(expr, result.e)) {
+				result.res = true;
+				return result;
+			}
+
     		typedef std::string::const_iterator base_iterator_type;
 
     		typedef lex::lexertl::token<
@@ -405,7 +412,6 @@ namespace hyper {
 			base_iterator_type it = expr.begin();
 			iterator_type iter = our_lexer.begin(it, expr.end());
 			iterator_type end = our_lexer.end();
-			generate_return result;
 			bool r;
 			try {
 				r  = phrase_parse(iter, end, g, qi::in_state("WS")[our_lexer.self], result.e);
@@ -424,6 +430,8 @@ namespace hyper {
 			}
 
 			result.res = (r && iter == end);
+			if (result.res)
+				funcs.cache().insert(expr, result.e);
 			return result;
 		}
 
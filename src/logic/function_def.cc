@@ -1,11 +1,12 @@
 #include <logic/function_def.hh>
 #include <logic/eval.hh>
+#include <logic/generate_cache.hh>
 
 #include <boost/optional/optional.hpp>
 
 namespace hyper {
 	namespace logic {
-		funcDefList::funcDefList()
+		funcDefList::funcDefList() : cache_(new generate_cache())
 		{
 			list_eval.push_back(new eval<notAPredicate, 0>());
 		}
@@ -0,0 +1,65 @@
+#include <logic/generate_cache.hh>
+
+#include <ostream>
+
+namespace hyper {
+	namespace logic {
+		bool generate_cache::get(const std::string& expr, function_call& res)
+		{
+			indexM::iterator it = index.find(expr);
+			if (it == index.end()) {
+				++misses_;
+				return false;
+			}
+
+			++hits_;
+			lru.splice(lru.begin(), lru, it->second);
+			res = it->second->second;
+			return true;
+		}
+
+		void generate_cache::insert(const std::string& expr, const function_call& f)
+		{
+			if (capacity_ == 0)
+				return;
+
+			indexM::iterator it = index.find(expr);
+			if (it != index.end()) {
+				it->second->second = f;
+				lru.splice(lru.begin(), lru, it->second);
+				return;
+			}
+
+			lru.push_front(std::make_pair(expr, f));
+			index[expr] = lru.begin();
+			shrink();
+		}
+
+		void generate_cache::shrink()
+		{
+			while (index.size() > capacity_) {
+				index.erase(lru.back().first);
+				lru.pop_back();
+			}
+		}
+
+		void generate_cache::clear()
+		{
+			lru.clear();
+			index.clear();
+		}
+
+		void generate_cache::set_capacity(size_t capacity)
+		{
+			capacity_ = capacity;
+			shrink();
+		}
+
+		std::ostream& operator << (std::ostream& os, const generate_cache& c)
+		{
+			os << "generate_cache : " << c.size() << "/" << c.capacity();
+			os << " entries, " << c.hits() << " hits, " << c.misses() << " misses";
+			return os;
+		}
+	}
+}
@@ -85,9 +85,11 @@ namespace {
 				    const typename std::vector<FactT>& cond,
 				    const typename std::vector<FactT>& action,
 				    const funcDefList& funcs,
+				    rule::matcher_type matcher,
 				    std::vector<rule>& r_)
 	{
 		rule r;
+		r.matcher = matcher;
 		{
 		bool res = true;
 		converter c(res, funcs, r.condition);
@@ -129,16 +131,18 @@ namespace hyper {
 
 		bool rules::add(const std::string& identifier,
 						const std::vector<std::string>& cond,
-						const std::vector<std::string>& action)
+						const std::vector<std::string>& action,
+						rule::matcher_type matcher)
 		{
-			return add_helper(identifier, cond, action, funcs, r_);
+			return add_helper(identifier, cond, action, funcs, matcher, r_);
 		}
 
 		bool rules::add(const std::string& identifier,
 						const std::vector<function_call>& cond,
-						const std::vector<function_call>& action)
+						const std::vector<function_call>& action,
+						rule::matcher_type matcher)
 		{
-			return add_helper(identifier, cond, action, funcs, r_);
+			return add_helper(identifier, cond, action, funcs, matcher, r_);
 		}
 
 		std::ostream& operator << (std::ostream& os, const rules& r)
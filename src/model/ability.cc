@@ -6,10 +6,15 @@
 #include <network/log_level.hh>
 #include <network/msg.hh>
 #include <network/ping.hh>
+#include <network/priority.hh>
 #include <network/server_tcp_impl.hh>
 
 #include <hyperConfig.hh>
 
+#include <boost/scoped_ptr.hpp>
+#include <boost/system/system_error.hpp>
+#include <boost/thread/thread.hpp>
+
 namespace hyper { namespace model {
 	void handle_constraint_answer(hyper::model::ability &, 
 			const boost::system::error_code&, 
@@ -18,47 +23,53 @@ namespace hyper { namespace model {
 		delete ans;
 	}
 
+	void send_ctr_status(hyper::model::ability& a, const network::request_constraint_answer& status)
+	{
+		network::request_constraint_answer* ans = new network::request_constraint_answer(status);
+		a.actor->client_db[ans->src].async_write(*ans,
+				boost::bind(&handle_constraint_answer, boost::ref(a), 
+					boost::asio::placeholders::error,  ans));
+	}
+
 	void update_ctr_status(hyper::model::ability& a, hyper::model::logic_constraint ctr, 
 						   const hyper::network::error_context& err_ctx)
 	{
 		if (ctr.internal)
 			return;
 
-		network::request_constraint_answer* ans = new network::request_constraint_answer();
-		ans->id = ctr.id;
-		ans->src = ctr.src;
-		ans->state = ctr.s;
-		ans->err_ctx = err_ctx;
+		network::request_constraint_answer ans;
+		ans.id = ctr.id;
+		ans.src = ctr.src;
+		ans.state = ctr.s;
+		ans.err_ctx = err_ctx;
 
-		a.logger(DEBUG) << ctr << " Sending constraint update status " ;
-		switch(ans->state) {
+		HYPER_LOG(a, DEBUG) << ctr << " Sending constraint update status " ;
+		switch(ans.state) {
 			case network::request_constraint_answer::INIT:
-				a.logger(DEBUG) << "init";
+				HYPER_LOG(a, DEBUG) << "init";
 				break;
 			case network::request_constraint_answer::RUNNING:
-				a.logger(DEBUG) << "running";
+				HYPER_LOG(a, DEBUG) << "running";
 				break;
 			case network::request_constraint_answer::PAUSED:
-				a.logger(DEBUG) << "paused";
+				HYPER_LOG(a, DEBUG) << "paused";
 				break;
 			case network::request_constraint_answer::TEMP_FAILURE:
-				a.logger(DEBUG) << "temporary_failure";
+				HYPER_LOG(a, DEBUG) << "temporary_failure";
 				break;
 			case network::request_constraint_answer::SUCCESS:
-				a.logger(DEBUG) << "success";
+				HYPER_LOG(a, DEBUG) << "success";
 				break;
 			case network::request_constraint_answer::FAILURE:
-				a.logger(DEBUG) << "failure";
+				HYPER_LOG(a, DEBUG) << "failure";
 				break;
 			case network::request_constraint_answer::INTERRUPTED:
-				a.logger(DEBUG) << "interrupted";
+				HYPER_LOG(a, DEBUG) << "interrupted";
 				break;
 		}
-		a.logger(DEBUG)	<< std::endl;
+		HYPER_LOG(a, DEBUG)	<< std::endl;
 
-		a.actor->client_db[ctr.src].async_write(*ans,
-				boost::bind(&handle_constraint_answer, boost::ref(a), 
-					boost::asio::placeholders::error,  ans));
+		a.ctr_status.push(ans);
 	}
 }}
 
@@ -71,11 +82,26 @@ namespace {
 		delete ans;
 	}
 
+	void handle_write_values(const boost::system::error_code& ,
+			network::variable_values* ans)
+	{
+		delete ans;
+	}
+
+	/* State of a request_variable_values, while updating its variables */
+	struct pending_variable_values {
+		network::request_variable_values msg;
+		std::vector<bool> failed;
+		std::vector<network::error_context> errors;
+		size_t remaining;
+	};
 
 	typedef boost::mpl::vector<network::request_variable_value,
+							   network::request_variable_values,
 							   network::request_constraint,
 							   network::request_constraint2,
 							   network::variable_value,
+							   network::variable_values,
 							   network::request_constraint_answer,
 							   network::inform_new_agent,
 							   network::list_agents,
@@ -83,7 +109,10 @@ namespace {
 							   network::terminate,
 							   network::abort,
 							   network::pause,
-							   network::resume> input_msg;
+							   network::resume,
+							   network::subscribe_variable,
+							   network::unsubscribe_variable,
+							   network::variable_update> input_msg;
 	typedef boost::mpl::vector<network::variable_value,
 							   network::request_constraint_answer,
 							   boost::mpl::void_> output_msg;
@@ -100,6 +129,11 @@ namespace {
 		{
 			a.actor->client_db[agent].close();
 			a.alive_agents.erase(agent);
+			a.publisher.remove_subscriber(agent);
+			a.subscriptions.remove_agent(agent);
+			a.remote_cache.invalidate(agent);
+			a.ctr_status.invalidate(agent);
+			a.actor->name_client.invalidate(agent);
 		}
 	};
 
@@ -119,9 +153,9 @@ namespace {
 				const hyper::network::error_context& err_ctx,
 				const network::request_variable_value& m) const
 		{
-			a.logger(DEBUG) << "[" << m.src << ", " << m.id << "]";
+			HYPER_LOG(a, DEBUG) << "[" << m.src << ", " << m.id << "]";
 			if (e) {
-				a.logger(DEBUG) << " Failed to update value " << std::endl;
+				HYPER_LOG(a, DEBUG) << " Failed to update value " << std::endl;
 				network::variable_value* ans(new network::variable_value());
 				ans->id = m.id;
 				ans->src = m.src;
@@ -133,18 +167,18 @@ namespace {
 							boost::asio::placeholders::error,
 							ans));
 			} else {
-				a.logger(DEBUG) << " Value succesfully updated " << std::endl;
+				HYPER_LOG(a, DEBUG) << " Value succesfully updated " << std::endl;
 				proxy_vis(m);
 			}
 		}
 
 		output_variant operator() (const network::request_variable_value& m) const
 		{
-			a.logger(INFORMATION) << "[" << m.src << ", " << m.id;
-			a.logger(INFORMATION) << "] Request for  the value of " << m.var_name << std::endl;
+			HYPER_LOG(a, INFORMATION) << "[" << m.src << ", " << m.id;
+			HYPER_LOG(a, INFORMATION) << "] Request for  the value of " << m.var_name << std::endl;
 
-			a.logger(DEBUG) << "[" << m.src << ", " << m.id << "]";
-			a.logger(DEBUG) << " Updating value " << std::endl;
+			HYPER_LOG(a, DEBUG) << "[" << m.src << ", " << m.id << "]";
+			HYPER_LOG(a, DEBUG) << " Updating value " << std::endl;
 
 			model::updater::cb_type f = boost::bind(
 					&ability_visitor::handle_update_value, this,
@@ -154,6 +188,69 @@ namespace {
 			return boost::mpl::void_();
 		}
 
+		void handle_update_values(const boost::system::error_code& e,
+				const hyper::network::error_context& err_ctx,
+				size_t i,
+				boost::shared_ptr<pending_variable_values> p) const
+		{
+			if (e) {
+				p->failed[i] = true;
+				p->errors[i] = err_ctx;
+			}
+
+			if (--p->remaining != 0)
+				return;
+
+			/* all variables are up to date, read them in one pass */
+			network::variable_values* ans(new network::variable_values());
+			proxy_vis.fill_values(p->msg, *ans);
+			for (size_t j = 0; j < p->failed.size(); ++j) {
+				if (p->failed[j]) {
+					ans->values[j].success = false;
+					ans->values[j].err_ctx = p->errors[j];
+				}
+			}
+
+			HYPER_LOG(a, DEBUG) << "[" << p->msg.src << ", " << p->msg.id << "]";
+			HYPER_LOG(a, DEBUG) << " Values succesfully updated " << std::endl;
+			a.actor->client_db[p->msg.src].async_write(*ans, 
+					boost::bind(&handle_write_values,
+						boost::asio::placeholders::error,
+						ans));
+		}
+
+		output_variant operator() (const network::request_variable_values& m) const
+		{
+			if (a.log_enabled(INFORMATION)) {
+				a.logger(INFORMATION) << "[" << m.src << ", " << m.id;
+				a.logger(INFORMATION) << "] Request for the values of ";
+				std::copy(m.var_names.begin(), m.var_names.end(),
+						  std::ostream_iterator<std::string>(a.logger(INFORMATION), " "));
+				a.logger(INFORMATION) << std::endl;
+			}
+
+			if (m.var_names.empty()) {
+				proxy_vis(m);
+				return boost::mpl::void_();
+			}
+
+			boost::shared_ptr<pending_variable_values> p =
+				boost::make_shared<pending_variable_values>();
+			p->msg = m;
+			p->failed.resize(m.var_names.size(), false);
+			p->errors.resize(m.var_names.size());
+			p->remaining = m.var_names.size();
+
+			for (size_t i = 0; i < m.var_names.size(); ++i) {
+				model::updater::cb_type f = boost::bind(
+						&ability_visitor::handle_update_values, this,
+						boost::asio::placeholders::error,
+						_2, i, p);
+				a.updater.async_update(m.var_names[i], m.id, m.src, f);
+			}
+			return boost::mpl::void_();
+		}
+
 
 
 		void handle_async_exec_completion(network::request_constraint_answer::state_ s,
@@ -175,8 +272,8 @@ namespace {
 			ctr.internal = false;
 			ctr.delay = r.delay;
 
-			a.logger(INFORMATION) << ctr << " Handling ";
-			a.logger(INFORMATION) << r.constraint << std::endl;
+			HYPER_LOG(a, INFORMATION) << ctr << " Handling ";
+			HYPER_LOG(a, INFORMATION) << r.constraint << std::endl;
 
 			a.logic().async_exec(ctr, r.constraint, r.unify_list, 
 					boost::bind(&ability_visitor::handle_async_exec_completion, this,
@@ -195,8 +292,8 @@ namespace {
 			ctr.internal = false;
 			ctr.delay = r.delay;
 
-			a.logger(INFORMATION) << ctr << " Handling ";
-			a.logger(INFORMATION) << r.constraint << std::endl;
+			HYPER_LOG(a, INFORMATION) << ctr << " Handling ";
+			HYPER_LOG(a, INFORMATION) << r.constraint << std::endl;
 
 			a.logic().async_exec(ctr, r.constraint, r.unify_list,
 					boost::bind(&ability_visitor::handle_async_exec_completion, this,
@@ -207,7 +304,13 @@ namespace {
 
 		output_variant operator() (const network::variable_value& v) const
 		{
-			a.logger(INFORMATION) << "[" << v.src << ", " << v.id << "] Final answer " << std::endl;
+			HYPER_LOG(a, INFORMATION) << "[" << v.src << ", " << v.id << "] Final answer " << std::endl;
+			return actor_vis(v);
+		}
+
+		output_variant operator() (const network::variable_values& v) const
+		{
+			HYPER_LOG(a, INFORMATION) << "[" << v.src << ", " << v.id << "] Final answer " << std::endl;
 			return actor_vis(v);
 		}
 
@@ -218,12 +321,12 @@ namespace {
 			case network::request_constraint_answer::RUNNING:
 			case network::request_constraint_answer::PAUSED:
 			case network::request_constraint_answer::TEMP_FAILURE:
-				a.logger(INFORMATION) << "[" << v.src << ", " << v.id << "] Answer " << std::endl;
+				HYPER_LOG(a, INFORMATION) << "[" << v.src << ", " << v.id << "] Answer " << std::endl;
 				break;
 			case network::request_constraint_answer::SUCCESS:
 			case network::request_constraint_answer::FAILURE:
 			case network::request_constraint_answer::INTERRUPTED:
-				a.logger(INFORMATION) << "[" << v.src << ", " << v.id << "] Final answer " << std::endl;
+				HYPER_LOG(a, INFORMATION) << "[" << v.src << ", " << v.id << "] Final answer " << std::endl;
 				break;
 			}
 			return actor_vis(v);
@@ -231,11 +334,14 @@ namespace {
 
 		output_variant operator() (const network::inform_death_agent& d) const
 		{
-			a.logger(INFORMATION) << "Receive information about the death of agent(s) : ";
-			std::copy(d.dead_agents.begin(), d.dead_agents.end(), 
-					std::ostream_iterator<std::string>(a.logger(INFORMATION), ", "));
-			a.logger(INFORMATION) << std::endl;
+			if (a.log_enabled(INFORMATION)) {
+				a.logger(INFORMATION) << "Receive information about the death of agent(s) : ";
+				std::copy(d.dead_agents.begin(), d.dead_agents.end(), 
+						std::ostream_iterator<std::string>(a.logger(INFORMATION), ", "));
+				a.logger(INFORMATION) << std::endl;
+			}
 
+			a.actor->name_client.apply(d);
 			std::for_each(d.dead_agents.begin(), d.dead_agents.end(),
 					boost::bind(&model::actor_impl::cb_db::cancel, &a.actor->db, _1));
 			std::for_each(d.dead_agents.begin(), d.dead_agents.end(),
@@ -244,9 +350,32 @@ namespace {
 			return boost::mpl::void_();
 		}
 
+		output_variant operator() (const network::subscribe_variable& s) const
+		{
+			HYPER_LOG(a, INFORMATION) << "[" << s.src << ", " << s.id << "] Subscription to ";
+			HYPER_LOG(a, INFORMATION) << s.var_name << std::endl;
+			a.publisher.subscribe(s);
+			return boost::mpl::void_();
+		}
+
+		output_variant operator() (const network::unsubscribe_variable& s) const
+		{
+			HYPER_LOG(a, INFORMATION) << "[" << s.src << ", " << s.id << "] End of subscription" << std::endl;
+			a.publisher.unsubscribe(s);
+			return boost::mpl::void_();
+		}
+
+		output_variant operator() (const network::variable_update& u) const
+		{
+			HYPER_LOG(a, DEBUG) << "[" << u.src << ", " << u.id << "] New value for ";
+			HYPER_LOG(a, DEBUG) << u.var_name << std::endl;
+			a.subscriptions.handle_update(u);
+			return boost::mpl::void_();
+		}
+
 		output_variant operator() (const network::terminate& t) const
 		{
-			a.logger(INFORMATION) << "Exiting by terminaison request : " << t.reason << std::endl;
+			HYPER_LOG(a, INFORMATION) << "Exiting by terminaison request : " << t.reason << std::endl;
 			a.stop();
 			return boost::mpl::void_();
 		}
@@ -254,6 +383,9 @@ namespace {
 		output_variant operator() (const network::inform_new_agent& l) const
 		{
 			a.alive_agents.insert(l.new_agents.begin(), l.new_agents.end());
+			a.actor->name_client.apply(l);
+			std::for_each(l.new_agents.begin(), l.new_agents.end(),
+					boost::bind(&model::variable_subscriber::add_agent, &a.subscriptions, _1));
 			return boost::mpl::void_();
 		}
 
@@ -264,25 +396,30 @@ namespace {
 
 		output_variant operator() (const network::abort& abort) const
 		{
-			a.logger(INFORMATION) << "[" << abort.src << ", " << abort.id << "] Abort requested " << std::endl;
+			HYPER_LOG(a, INFORMATION) << "[" << abort.src << ", " << abort.id << "] Abort requested " << std::endl;
 			a.logic().abort(abort.src, abort.id);
 			return boost::mpl::void_();
 		}
 
 		output_variant operator() (const network::pause& pause) const
 		{
-			a.logger(INFORMATION) << "[" << pause.src << ", " << pause.id << "] Pause requested " << std::endl;
+			HYPER_LOG(a, INFORMATION) << "[" << pause.src << ", " << pause.id << "] Pause requested " << std::endl;
 			a.logic().pause(pause.src, pause.id);
 			return boost::mpl::void_();
 		}
 
 		output_variant operator() (const network::resume& resume) const
 		{
-			a.logger(INFORMATION) << "[" << resume.src << ", " << resume.id << "] Resume requested " << std::endl;
+			HYPER_LOG(a, INFORMATION) << "[" << resume.src << ", " << resume.id << "] Resume requested " << std::endl;
 			a.logic().resume(resume.src, resume.id);
 			return boost::mpl::void_();
 		}
 	};
+
+	void throw_system_error(const boost::system::error_code& e)
+	{
+		throw boost::system::system_error(e);
+	}
 }
 
 namespace hyper {
@@ -303,6 +440,21 @@ namespace hyper {
 
 
 			tcp_ability_impl serv;
+#ifdef HYPER_HAS_LOCAL_SOCKETS
+			typedef network::tcp::server<input_msg, 
+										 output_msg, 
+										 ability_visitor,
+										 boost::asio::local::stream_protocol>
+			local_ability_impl;
+
+			/*
+			 * Agents on the same host reach us through this unix socket,
+			 * if it can be created. Otherwise, local_serv is null and
+			 * local_path empty.
+			 */
+			std::string local_path;
+			boost::scoped_ptr<local_ability_impl> local_serv;
+#endif
 			network::ping_process ping;
 			model::logic_layer logic;
 
@@ -310,18 +462,43 @@ namespace hyper {
 				a(a_), 
 				vis(a_),
 				serv(vis, a.io_s),
-				ping(a.io_s, boost::posix_time::milliseconds(AGENT_TIMEOUT), a.name, 
+#ifdef HYPER_HAS_LOCAL_SOCKETS
+				local_path(network::local_socket_path(a.name)),
+#endif
+				ping(a.liveness_s, boost::posix_time::milliseconds(AGENT_TIMEOUT), a.name, 
 					 a.discover.root_addr(), a.discover.root_port()),
 				logic(a_)
 			{
 				if (a.log_level >= DEBUG)
 					std::cout << "discover " << a.discover.root_addr() << " " << a.discover.root_port() << std::endl;
+#ifdef HYPER_HAS_LOCAL_SOCKETS
+				start_local_serv();
+#endif
+			}
+
+#ifdef HYPER_HAS_LOCAL_SOCKETS
+			/* Without a unix socket, the agent still runs over tcp */
+			void start_local_serv()
+			{
+				try {
+					if (!local_path.empty())
+						local_serv.reset(new local_ability_impl(
+								boost::asio::local::stream_protocol::endpoint(local_path), vis, a.io_s));
+				} catch (const std::exception& e) {
+					std::cerr << "Can't listen on " << local_path << " : " << e.what();
+					std::cerr << ", only reachable through tcp" << std::endl;
+				}
+
+				if (!local_serv)
+					local_path.clear();
 			}
+#endif
 		};
 		actor_impl::actor_impl(boost::asio::io_service& io_s, const std::string& name, int level, 
 							   const discover_root& discover):
 			io_s(io_s), name(name),
 			name_client(io_s, discover.root_addr(), discover.root_port()),
+			db(io_s),
 			client_db(*this),
 			base_id(0),
 			logger_(io_s, name, "logger", name_client, level)
@@ -332,6 +509,9 @@ namespace hyper {
 			actor(new actor_impl(io_s, name_, level, discover)),
 			updater(*this),
 			setter(*this),
+			publisher(*this),
+			subscriptions(*this),
+			ctr_status(io_s, boost::bind(&send_ctr_status, boost::ref(*this), _1)),
 			name(name_),
 			log_level(level),
 			impl(new ability_impl(*this))
@@ -340,12 +520,19 @@ namespace hyper {
 		void ability::register_name()
 		{
 			const std::vector<boost::asio::ip::tcp::endpoint>& addrs = impl->serv.local_endpoints();
-			bool res = actor->name_client.register_name(name, addrs);
+			std::vector<std::string> local_addrs;
+#ifdef HYPER_HAS_LOCAL_SOCKETS
+			if (impl->local_serv)
+				local_addrs.push_back(impl->local_path);
+#endif
+			bool res = actor->name_client.register_name(name, addrs, local_addrs);
 			if (res) {
 				if (log_level >= DEBUG) {
 					std::cout << "Successfully registring " << name << " on " ;
 					std::copy(addrs.begin(), addrs.end(), 
 							std::ostream_iterator<boost::asio::ip::tcp::endpoint>(std::cout, " "));
+					std::copy(local_addrs.begin(), local_addrs.end(), 
+							std::ostream_iterator<std::string>(std::cout, " "));
 					std::cout << std::endl;
 				}
 			}
@@ -384,14 +571,78 @@ namespace hyper {
 		
 		void ability::run()
 		{
+			run(0);
+		}
+
+		void ability::run(size_t nb_workers)
+		{
+			workers.start(nb_workers);
 			impl->ping.run();
-			io_s.run();
+			boost::thread liveness(boost::bind(&ability::run_liveness, this));
+
+			try {
+				io_s.run();
+			} catch (...) {
+				liveness_s.stop();
+				liveness.join();
+				throw;
+			}
+
+			liveness_s.stop();
+			liveness.join();
+			workers.stop();
+		}
+
+		void ability::run_liveness()
+		{
+			try {
+				liveness_s.run();
+			} catch (const boost::system::system_error& e) {
+				/* report the failure in the main loop, as before */
+				io_s.post(boost::bind(throw_system_error, e.code()));
+			}
 		}
 	
 		void ability::stop()
 		{
-			impl->ping.stop();
+			liveness_s.post(boost::bind(&network::ping_process::stop, &impl->ping));
 			impl->serv.stop();
+#ifdef HYPER_HAS_LOCAL_SOCKETS
+			if (impl->local_serv)
+				impl->local_serv->stop();
+#endif
+			publisher.stop();
+			/* don't lose the last status updates */
+			ctr_status.flush();
+
+			if (ctr_status.coalesced() > 0)
+				logger(INFORMATION) << "Constraint status : " << ctr_status.coalesced()
+									<< " updates coalesced" << std::endl;
+
+			if (remote_cache.hits() + remote_cache.misses() > 0) {
+				logger(INFORMATION) << "Remote cache : " << remote_cache.hits() << " hits, ";
+				logger(INFORMATION) << remote_cache.misses() << " misses" << std::endl;
+			}
+
+			network::message_latency& latency = network::message_latency::instance();
+			for (size_t i = 0; i < network::nb_message_classes; ++i) {
+				network::message_class c = static_cast<network::message_class>(i);
+				network::message_latency::summary sum = latency.get(c);
+				if (sum.count == 0)
+					continue;
+				logger(INFORMATION) << "Write latency (" << network::message_class_name(c) << ") : ";
+				logger(INFORMATION) << sum.count << " messages, mean " << sum.mean().total_microseconds();
+				logger(INFORMATION) << " us, max " << sum.max.total_microseconds() << " us" << std::endl;
+			}
+		}
+
+		void ability::set_request_timeout(double seconds)
+		{
+			if (seconds <= 0.0)
+				actor->db.set_default_deadline(boost::posix_time::pos_infin);
+			else
+				actor->db.set_default_deadline(
+					boost::posix_time::microseconds(static_cast<long>(seconds * 1e6)));
 		}
 
 		std::ostream& ability::logger(int level)
@@ -399,6 +650,11 @@ namespace hyper {
 			return actor->logger(level);
 		}
 
+		bool ability::log_enabled(int level) const
+		{
+			return actor->log_enabled(level);
+		}
+
 		logic_layer& ability::logic()
 		{
 			return impl->logic;
@@ -1,3 +1,4 @@
+#include <model/ability.hh>
 #include <model/compute_wait_expression.hh>
 
 #include <boost/asio/placeholders.hpp>
@@ -10,18 +11,69 @@ namespace hyper {
 				abortable_computation* fun_ptr,
 				bool &res) :
 			fun_ptr(fun_ptr), io_service_(io_s), delay_(delay), deadline_(io_s),
-			res(res), user_ask_abort(false), must_pause(false), running(false), waiting(false)
+			res(res), user_ask_abort(false), must_pause(false), running(false), waiting(false),
+			a_(0), changed_(false)
 		{}
 
+		compute_wait_expression::compute_wait_expression(ability& a,
+				boost::posix_time::time_duration delay,
+				boost::posix_time::time_duration watch_delay,
+				abortable_computation* fun_ptr,
+				bool &res,
+				const remote_vars& watched) :
+			fun_ptr(fun_ptr), io_service_(a.io_s), delay_(delay), deadline_(a.io_s),
+			res(res), user_ask_abort(false), must_pause(false), running(false), waiting(false),
+			a_(&a), watched_(watched), watch_delay_(watch_delay), changed_(false)
+		{}
+
+		void compute_wait_expression::start_watching()
+		{
+			if (!a_ || !watch_ids_.empty())
+				return;
+
+			double period = delay_.total_microseconds() / 1000.0;
+			for (size_t i = 0; i < watched_.size(); ++i)
+				watch_ids_.push_back(a_->subscriptions.watch(
+							watched_[i].first, watched_[i].second, period, 0.0,
+							boost::bind(&compute_wait_expression::handle_change, this)));
+		}
+
+		void compute_wait_expression::stop_watching()
+		{
+			for (size_t i = 0; i < watch_ids_.size(); ++i)
+				a_->subscriptions.unwatch(watch_ids_[i]);
+			watch_ids_.clear();
+		}
+
+		bool compute_wait_expression::subscribed() const
+		{
+			if (watch_ids_.empty())
+				return false;
+			for (size_t i = 0; i < watch_ids_.size(); ++i)
+				if (!a_->subscriptions.confirmed(watch_ids_[i]))
+					return false;
+			return true;
+		}
+
+		void compute_wait_expression::handle_change()
+		{
+			if (waiting) 
+				deadline_.cancel();
+			else
+				changed_ = true;
+		}
+
 		bool compute_wait_expression::handle_error(const boost::system::error_code& e, cb_type cb)
 		{
 			if (user_ask_abort) {
+				stop_watching();
 				cb(make_error_code(boost::system::errc::interrupted));
 				running = false;
 				return true;
 			}
 
 			if (e) {
+				stop_watching();
 				cb(e);
 				running = false;
 				return true;
@@ -34,7 +86,11 @@ namespace hyper {
 				const boost::system::error_code& e, cb_type cb)
 		{
 			waiting = false;
-			if (!handle_error(e, cb))
+			/* the timer is only cancelled by handle_change, to wake us up */
+			boost::system::error_code err = e;
+			if (err == boost::asio::error::operation_aborted)
+				err = boost::system::error_code();
+			if (!handle_error(err, cb))
 				compute(cb);
 		}
 
@@ -44,6 +100,7 @@ namespace hyper {
 			if (handle_error(e, cb)) return;
 
 			if (res) { 
+				stop_watching();
 				running = false;
 				return cb(boost::system::error_code());
 			}
@@ -51,9 +108,14 @@ namespace hyper {
 			if (must_pause)
 				return;
 
+			/* something changed while computing, test again right now */
+			if (changed_)
+				return compute(cb);
+
 			waiting = true;
 			running = false;
-			deadline_.expires_from_now(delay_);
+			/* don't rely on the updates until they are really pushed */
+			deadline_.expires_from_now(subscribed() ? watch_delay_ : delay_);
 			deadline_.async_wait(boost::bind(&compute_wait_expression::handle_timeout, 
 						this,
 						boost::asio::placeholders::error,
@@ -64,9 +126,12 @@ namespace hyper {
 		{
 			running = true;
 			cb_ = cb;
+			changed_ = false;
 			if (must_pause)
 				return;
 
+			start_watching();
+
 			fun_ptr->compute(boost::bind(&compute_wait_expression::handle_computation, 
 										 this,
 										 boost::asio::placeholders::error,
@@ -103,5 +168,10 @@ namespace hyper {
 				compute(cb_);
 			}
 		}
+
+		compute_wait_expression::~compute_wait_expression()
+		{
+			stop_watching();
+		}
 	}
 }
@@ -137,7 +137,7 @@ namespace hyper {
 
 		void logic_layer::async_exec_(logic_ctx_ptr ctx)
 		{
-			a_.logger(DEBUG) << ctx->ctr << " Try to set unification pattern " << std::endl;
+			HYPER_LOG(a_, DEBUG) << ctx->ctr << " Try to set unification pattern " << std::endl;
 			hyper::network::async_parallel_for_each(ctx->unify_list.begin(), ctx->unify_list.end(),
 												   boost::bind(&setter::set, a_.setter, _1, _2), 
 												   boost::bind(&logic_layer::handle_unification_computation,
@@ -156,7 +156,7 @@ namespace hyper {
 						logic::generate(constraint, engine.funcs());
 
 			if (ret_exec.res == false) {
-				a_.logger(WARNING) << ctx->ctr << " Fail to parse " << constraint << std::endl;
+				HYPER_LOG(a_, WARNING) << ctx->ctr << " Fail to parse " << constraint << std::endl;
 				return handle_failure(ctx, make_error_code(logic_layer_error::parse_error));
 			}
 			ctx->call_exec = ret_exec.e;
@@ -179,7 +179,7 @@ namespace hyper {
 						logic::generate(f, engine.funcs());
 
 			if (ret_exec.res == false) {
-				a_.logger(WARNING) << ctx->ctr << " Fail to adapt " << f << " to local context" << std::endl;
+				HYPER_LOG(a_, WARNING) << ctx->ctr << " Fail to adapt " << f << " to local context" << std::endl;
 				return handle_failure(ctx, make_error_code(logic_layer_error::parse_error));
 			}
 			ctx->call_exec = ret_exec.e;
@@ -197,7 +197,7 @@ namespace hyper {
 
 			ctx->s_ = logic_context::EXEC;
 
-			a_.logger(DEBUG) << ctx->ctr << " Computation of the state " << std::endl;
+			HYPER_LOG(a_, DEBUG) << ctx->ctr << " Computation of the state " << std::endl;
 			ctx->exec_err_ctx.clear();
 			return async_eval_expression(a_.io_s, ctx->call_exec,
 										  a_, ctx->exec_res,
@@ -211,8 +211,8 @@ namespace hyper {
 		{
 			CHECK_INTERRUPT
 
-			a_.logger(DEBUG) <<  ctx->ctr << " End execution with ";
-			a_.logger(DEBUG) << (success ? "success" : "failure")  << std::endl;
+			HYPER_LOG(a_, DEBUG) <<  ctx->ctr << " End execution with ";
+			HYPER_LOG(a_, DEBUG) << (success ? "success" : "failure")  << std::endl;
 			if (success) 
 				handle_success(ctx);
 			else 
@@ -228,14 +228,14 @@ namespace hyper {
 		{
 			CHECK_INTERRUPT
 
-			a_.logger(DEBUG) <<  ctx->ctr << " Finish computation of async_task " << std::endl;
+			HYPER_LOG(a_, DEBUG) <<  ctx->ctr << " Finish computation of async_task " << std::endl;
 			if (success) {
-				a_.logger(DEBUG) <<  ctx->ctr << " Start execution " << std::endl;
+				HYPER_LOG(a_, DEBUG) <<  ctx->ctr << " Start execution " << std::endl;
 				ctx->s_ = logic_context::LOGIC_EXEC;
 				ctx->logic_tree.async_execute(
 						boost::bind(&logic_layer::handle_exec_task_tree, this, _1, ctx));
 			} else {
-				a_.logger(DEBUG) << ctx->ctr << " No solution found ! " << std::endl;
+				HYPER_LOG(a_, DEBUG) << ctx->ctr << " No solution found ! " << std::endl;
 				handle_failure(ctx, make_error_code(logic_layer_error::no_solution_found));
 			}
 		}
@@ -268,10 +268,10 @@ namespace hyper {
 		{
 			CHECK_INTERRUPT
 
-			a_.logger(DEBUG) <<  ctx->ctr << " Finish the constraint computation " << std::endl;
+			HYPER_LOG(a_, DEBUG) <<  ctx->ctr << " Finish the constraint computation " << std::endl;
 
 			if (e  || !ctx->exec_res) {
-				a_.logger(DEBUG) << ctx->ctr << " Failed to evaluate" << std::endl;
+				HYPER_LOG(a_, DEBUG) << ctx->ctr << " Failed to evaluate" << std::endl;
 				hyper::network::runtime_failure f = hyper::network::execution_failure(ctx->call_exec);
 				f.error_cause = ctx->exec_err_ctx;
 				ctx->err_ctx.push_back(f);
@@ -279,7 +279,7 @@ namespace hyper {
 			}
 
 			if (ctx->exec_res && *(ctx->exec_res)) {
-				a_.logger(INFORMATION) << ctx->ctr << " Already enforced" << std::endl;
+				HYPER_LOG(a_, INFORMATION) << ctx->ctr << " Already enforced" << std::endl;
 				return handle_success(ctx);
 			}
 
@@ -301,8 +301,8 @@ namespace hyper {
 
 				if (! ctx->must_pause) {
 					ctx->deadline_.expires_from_now(boost::posix_time::milliseconds(ctx->ctr.delay));
-					a_.logger(DEBUG) << ctx->ctr << " Sleeping " << ctx->ctr.delay << " ms ";
-					a_.logger(DEBUG) << "before verifying again the ctr " << std::endl;
+					HYPER_LOG(a_, DEBUG) << ctx->ctr << " Sleeping " << ctx->ctr.delay << " ms ";
+					HYPER_LOG(a_, DEBUG) << "before verifying again the ctr " << std::endl;
 					ctx->deadline_.async_wait(boost::bind(&logic_layer::handle_timeout, this,
 														  boost::asio::placeholders::error,
 														  ctx));
@@ -329,7 +329,7 @@ namespace hyper {
 
 			CHECK_INTERRUPT
 
-			a_.logger(DEBUG) << ctx->ctr << " Computation of the state " << std::endl;
+			HYPER_LOG(a_, DEBUG) << ctx->ctr << " Computation of the state " << std::endl;
 			ctx->exec_err_ctx.clear();
 			return async_eval_expression(a_.io_s, ctx->call_exec,
 										  a_, ctx->exec_res,
@@ -356,8 +356,8 @@ namespace hyper {
 			std::map<std::string, logic_ctx_ptr>::iterator it;
 			it = running_ctx.find(make_key(src, id));
 			if (it == running_ctx.end()) {
-				a_.logger(DEBUG) << "Don't find ctx for request [" << src << ", " << id << "]";
-				a_.logger(DEBUG) << std::endl;
+				HYPER_LOG(a_, DEBUG) << "Don't find ctx for request [" << src << ", " << id << "]";
+				HYPER_LOG(a_, DEBUG) << std::endl;
 				return;
 			}
 
@@ -382,8 +382,8 @@ namespace hyper {
 			std::map<std::string, logic_ctx_ptr>::iterator it;
 			it = running_ctx.find(make_key(src, id));
 			if (it == running_ctx.end()) {
-				a_.logger(DEBUG) << "Don't find ctx for request [" << src << ", " << id << "]";
-				a_.logger(DEBUG) << std::endl;
+				HYPER_LOG(a_, DEBUG) << "Don't find ctx for request [" << src << ", " << id << "]";
+				HYPER_LOG(a_, DEBUG) << std::endl;
 				return;
 			}
 
@@ -392,7 +392,7 @@ namespace hyper {
 				case logic_context::EXEC:
 				case logic_context::LOGIC:
 				case logic_context::LOGIC_EXEC:
-					a_.logger(DEBUG) << "Will pause logic_tree " << std::endl;
+					HYPER_LOG(a_, DEBUG) << "Will pause logic_tree " << std::endl;
 					it->second->logic_tree.pause();
 					break;
 				case logic_context::WAIT:
@@ -408,8 +408,8 @@ namespace hyper {
 			std::map<std::string, logic_ctx_ptr>::iterator it;
 			it = running_ctx.find(make_key(src, id));
 			if (it == running_ctx.end()) {
-				a_.logger(DEBUG) << "Don't find ctx for request [" << src << ", " << id << "]";
-				a_.logger(DEBUG) << std::endl;
+				HYPER_LOG(a_, DEBUG) << "Don't find ctx for request [" << src << ", " << id << "]";
+				HYPER_LOG(a_, DEBUG) << std::endl;
 				return;
 			}
 
@@ -1,4 +1,5 @@
 #include <model/main.hh>
+#include <network/compression.hh>
 #include <boost/program_options.hpp>
 
 namespace po = boost::program_options;
@@ -15,7 +16,10 @@ namespace {
 namespace hyper {
 	namespace model {
 		void parse_options(int argc, char** argv, const std::string& name, bool& background,
-																		   int& debug_lvl)
+																		   int& debug_lvl,
+																		   size_t& nb_workers,
+																		   double& request_timeout,
+																		   size_t& compression_threshold)
 		{
 			po::options_description desc("Allowed options");
 			desc.add_options()
@@ -23,6 +27,13 @@ namespace hyper {
 			("help,h", "produce help message")
 			("debug_level,d", po::value<int>(&debug_lvl)->implicit_value(0),
 			 "enable verbosity (optionally specify level)")
+			("workers,j", po::value<size_t>(&nb_workers)->default_value(0),
+			 "number of threads computing user functions (0 to compute them inline)")
+			("request-timeout", po::value<double>(&request_timeout)->default_value(0.0),
+			 "seconds to wait for the answer of another agent (0 to wait forever)")
+			("compression-threshold", po::value<size_t>(&compression_threshold)->default_value(
+											network::compression_threshold()),
+			 "compress the messages bigger than this number of bytes (0 to disable)")
 			;
 
 			po::variables_map vm;
@@ -12,9 +12,123 @@ namespace hyper {
 			a.actor->client_db[dst].async_request(msg, ans, cb);
 		}
 
+		void remote_proxy::async_ask(const std::string& dst, const network::request_variable_values& msg,
+							  network::variable_values& ans, cb_fun cb)
+		{
+			a.actor->client_db[dst].async_request(msg, ans, cb);
+		}
+
 		void remote_proxy::clean_up(network::identifier id)
 		{
 			a.actor->db.remove(id);
 		}
+
+		boost::optional<std::string> remote_proxy::cached(const std::string& dst,
+														  const std::string& var_name)
+		{
+			return a.remote_cache.get(dst, var_name);
+		}
+
+		void remote_proxy::cache(const std::string& dst, const network::variable_value& v)
+		{
+			if (v.success)
+				a.remote_cache.put(dst, v.var_name, v.value);
+		}
+
+		void remote_proxy::cache(const remote_batch& batch)
+		{
+			for (size_t i = 0; i < batch.ans.values.size(); ++i)
+				cache(batch.src, batch.ans.values[i]);
+		}
+
+		void remote_proxy::post(boost::function<void ()> cb)
+		{
+			a.io_s.post(cb);
+		}
+
+		bool remote_proxy::get_cached(remote_batch& batch)
+		{
+			std::vector<network::variable_value> values(batch.msg.var_names.size());
+			bool all_cached = true;
+			for (size_t i = 0; i < batch.msg.var_names.size(); ++i) {
+				boost::optional<std::string> v = cached(batch.src, batch.msg.var_names[i]);
+				values[i].var_name = batch.msg.var_names[i];
+				values[i].success = false;
+				if (v) {
+					values[i].success = true;
+					values[i].value = *v;
+				} else {
+					all_cached = false;
+				}
+			}
+
+			if (all_cached)
+				batch.ans.values = values;
+			return all_cached;
+		}
+
+		void remote_proxy::log_batch_failures(const boost::system::error_code& e,
+											  const remote_batch& batch)
+		{
+			for (size_t i = 0; i < batch.msg.var_names.size(); ++i) {
+				if (e || i >= batch.ans.values.size() || !batch.ans.values[i].success) {
+					a.logger(WARNING) << "Failed to get the value of " << batch.src;
+					a.logger(WARNING) << "::" << batch.msg.var_names[i] << std::endl;
+				}
+			}
+		}
+
+		remote_batch_reader::remote_batch_reader(model::ability& a) : a(a) {}
+
+		void remote_batch_reader::add(const std::string& dst, const std::string& var_name,
+									  cb_type cb)
+		{
+			boost::optional<std::string> cached = a.remote_cache.get(dst, var_name);
+			if (cached) {
+				network::variable_value v;
+				v.var_name = var_name;
+				v.success = true;
+				v.value = *cached;
+				a.io_s.post(boost::bind(cb, boost::system::error_code(), v));
+				return;
+			}
+
+			batch& b = batches[dst];
+			b.msg.var_names.push_back(var_name);
+			b.cbs.push_back(cb);
+		}
+
+		void remote_batch_reader::flush()
+		{
+			map_type::iterator it;
+			for (it = batches.begin(); it != batches.end(); ++it) 
+				a.actor->client_db[it->first].async_request(it->second.msg, it->second.ans,
+						boost::bind(&remote_batch_reader::handle_get, shared_from_this(),
+									boost::asio::placeholders::error, _2, it->first));
+		}
+
+		void remote_batch_reader::handle_get(const boost::system::error_code& e,
+											 network::identifier id,
+											 const std::string& dst)
+		{
+			a.actor->db.remove(id);
+
+			batch& b = batches[dst];
+			for (size_t i = 0; i < b.cbs.size(); ++i) {
+				network::variable_value v;
+				if (!e && i < b.ans.values.size()) {
+					v = b.ans.values[i];
+				} else {
+					v.var_name = b.msg.var_names[i];
+					v.success = false;
+				}
+
+				if (!v.success)
+					a.logger(WARNING) << "Failed to get the value of " << dst << "::" << v.var_name << std::endl;
+				else
+					a.remote_cache.put(dst, v.var_name, v.value);
+				b.cbs[i](e, v);
+			}
+		}
 	}
 }
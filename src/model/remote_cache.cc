@@ -0,0 +1,73 @@
+#include <model/remote_cache.hh>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace {
+	boost::posix_time::ptime now()
+	{
+		return boost::posix_time::microsec_clock::universal_time();
+	}
+}
+
+namespace hyper {
+	namespace model {
+		remote_value_cache::remote_value_cache() : hits_(0), misses_(0) {}
+
+		void remote_value_cache::set_lease(const std::string& agent, const std::string& var_name,
+										   boost::posix_time::time_duration lease)
+		{
+			key k(agent, var_name);
+			if (lease <= boost::posix_time::time_duration()) {
+				entries.erase(k);
+				return;
+			}
+
+			entries[k].lease = lease;
+		}
+
+		boost::optional<std::string> remote_value_cache::get(const std::string& agent,
+															 const std::string& var_name)
+		{
+			map_type::iterator it = entries.find(key(agent, var_name));
+			if (it == entries.end())
+				return boost::none;
+
+			entry& e = it->second;
+			if (e.value && now() - e.date <= e.lease) {
+				hits_++;
+				return e.value;
+			}
+
+			misses_++;
+			e.value = boost::none;
+			return boost::none;
+		}
+
+		void remote_value_cache::put(const std::string& agent, const std::string& var_name,
+									 const std::string& value)
+		{
+			map_type::iterator it = entries.find(key(agent, var_name));
+			if (it == entries.end())
+				return;
+
+			it->second.value = value;
+			it->second.date = now();
+		}
+
+		void remote_value_cache::invalidate(const std::string& agent)
+		{
+			map_type::iterator it;
+			for (it = entries.begin(); it != entries.end(); ++it)
+				if (it->first.first == agent)
+					it->second.value = boost::none;
+		}
+
+		double remote_value_cache::hit_rate() const
+		{
+			size_t total = hits_ + misses_;
+			if (total == 0)
+				return 0.0;
+			return static_cast<double>(hits_) / total;
+		}
+	}
+}
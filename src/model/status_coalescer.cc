@@ -0,0 +1,86 @@
+#include <model/status_coalescer.hh>
+
+#include <boost/asio/placeholders.hpp>
+#include <boost/bind.hpp>
+
+namespace hyper {
+	namespace model {
+		status_coalescer::status_coalescer(boost::asio::io_service& io_s, send_cb cb,
+										   boost::posix_time::time_duration window) :
+			io_s(io_s), timer(io_s), window(window), cb(cb),
+			flush_scheduled(false), coalesced_(0)
+		{}
+
+		bool status_coalescer::is_terminal(network::request_constraint_answer::state_ s)
+		{
+			return s == network::request_constraint_answer::SUCCESS ||
+				   s == network::request_constraint_answer::FAILURE ||
+				   s == network::request_constraint_answer::INTERRUPTED;
+		}
+
+		void status_coalescer::push(const network::request_constraint_answer& ans)
+		{
+			key k(ans.src, ans.id);
+			index_map::iterator it = index.find(k);
+
+			if (is_terminal(ans.state)) {
+				/* later updates must not overwrite an update sent before it */
+				if (it != index.end())
+					index.erase(it);
+				pending.push_back(ans);
+			} else if (it != index.end()) {
+				it->second->state = ans.state;
+				it->second->err_ctx = ans.err_ctx;
+				coalesced_++;
+			} else {
+				index[k] = pending.insert(pending.end(), ans);
+			}
+
+			if (flush_scheduled)
+				return;
+
+			flush_scheduled = true;
+			if (window > boost::posix_time::time_duration()) {
+				timer.expires_from_now(window);
+				timer.async_wait(boost::bind(&status_coalescer::handle_timeout, this,
+											 boost::asio::placeholders::error));
+			} else {
+				io_s.post(boost::bind(&status_coalescer::flush, this));
+			}
+		}
+
+		void status_coalescer::handle_timeout(const boost::system::error_code& e)
+		{
+			if (e == boost::asio::error::operation_aborted)
+				return;
+			flush();
+		}
+
+		void status_coalescer::flush()
+		{
+			flush_scheduled = false;
+
+			/* cb may push new updates, they will go in the next batch */
+			queue to_send;
+			to_send.swap(pending);
+			index.clear();
+
+			queue::const_iterator it;
+			for (it = to_send.begin(); it != to_send.end(); ++it)
+				cb(*it);
+		}
+
+		void status_coalescer::invalidate(const std::string& agent)
+		{
+			queue::iterator it = pending.begin();
+			while (it != pending.end()) {
+				if (it->src == agent) {
+					index.erase(key(it->src, it->id));
+					it = pending.erase(it);
+				} else {
+					++it;
+				}
+			}
+		}
+	}
+}
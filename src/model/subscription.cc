@@ -0,0 +1,320 @@
+#include <model/ability.hh>
+#include <model/actor_impl.hh>
+#include <model/subscription.hh>
+
+#include <cmath>
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+namespace {
+	using namespace hyper;
+
+	template <typename T>
+	void handle_write(const boost::system::error_code&, T* msg)
+	{
+		delete msg;
+	}
+
+	boost::posix_time::time_duration to_duration(double ms)
+	{
+		if (ms < 1.0)
+			ms = 1.0;
+		return boost::posix_time::microseconds(static_cast<long>(ms * 1000));
+	}
+}
+
+namespace hyper {
+	namespace model {
+		struct variable_publisher::subscription {
+			network::subscribe_variable msg;
+			boost::asio::deadline_timer timer;
+			bool active;
+
+			/* last value pushed to the subscriber */
+			boost::optional<std::string> last;
+			boost::optional<double> last_numeric;
+
+			subscription(boost::asio::io_service& io_s, const network::subscribe_variable& msg) :
+				msg(msg), timer(io_s), active(true)
+			{}
+
+			bool changed(const std::string& value, boost::optional<double> numeric) const
+			{
+				if (!last)
+					return true;
+				if (*last == value)
+					return false;
+				if (msg.deadband > 0.0 && numeric && last_numeric)
+					return std::fabs(*numeric - *last_numeric) > msg.deadband;
+				return true;
+			}
+		};
+
+		variable_publisher::variable_publisher(ability& a) : a(a) {}
+
+		void variable_publisher::subscribe(const network::subscribe_variable& s)
+		{
+			key k(s.src, s.id);
+			map_type::iterator it = subs.find(k);
+			if (it != subs.end())
+				erase(it);
+
+			boost::shared_ptr<subscription> sub =
+				boost::make_shared<subscription>(boost::ref(a.io_s), s);
+			subs[k] = sub;
+			sample(sub);
+		}
+
+		void variable_publisher::unsubscribe(const network::unsubscribe_variable& s)
+		{
+			map_type::iterator it = subs.find(key(s.src, s.id));
+			if (it != subs.end())
+				erase(it);
+		}
+
+		void variable_publisher::remove_subscriber(const std::string& agent)
+		{
+			map_type::iterator it = subs.begin();
+			while (it != subs.end()) {
+				map_type::iterator current = it++;
+				if (current->first.first == agent)
+					erase(current);
+			}
+		}
+
+		void variable_publisher::erase(map_type::iterator it)
+		{
+			it->second->active = false;
+			it->second->timer.cancel();
+			subs.erase(it);
+		}
+
+		void variable_publisher::sample(boost::shared_ptr<subscription> sub)
+		{
+			a.updater.async_update(sub->msg.var_name, sub->msg.id, sub->msg.src,
+					boost::bind(&variable_publisher::handle_update, this,
+								boost::asio::placeholders::error, sub));
+		}
+
+		void variable_publisher::handle_update(const boost::system::error_code& e,
+											   boost::shared_ptr<subscription> sub)
+		{
+			if (!sub->active)
+				return;
+
+			if (!e) {
+				boost::optional<std::string> value = a.serializer.eval(sub->msg.var_name);
+				boost::optional<double> numeric = a.serializer.eval_numeric(sub->msg.var_name);
+				if (value && sub->changed(*value, numeric)) {
+					sub->last = value;
+					sub->last_numeric = numeric;
+
+					network::variable_update* u(new network::variable_update());
+					u->id = sub->msg.id;
+					u->src = a.name;
+					u->var_name = sub->msg.var_name;
+					u->value = *value;
+					a.actor->client_db[sub->msg.src].async_write(*u,
+							boost::bind(&handle_write<network::variable_update>,
+										boost::asio::placeholders::error, u));
+				}
+			}
+
+			sub->timer.expires_from_now(to_duration(sub->msg.period));
+			sub->timer.async_wait(boost::bind(&variable_publisher::handle_timeout, this,
+											  boost::asio::placeholders::error, sub));
+		}
+
+		void variable_publisher::handle_timeout(const boost::system::error_code& e,
+												boost::shared_ptr<subscription> sub)
+		{
+			if (e || !sub->active)
+				return;
+			sample(sub);
+		}
+
+		void variable_publisher::stop()
+		{
+			while (!subs.empty())
+				erase(subs.begin());
+		}
+
+		variable_publisher::~variable_publisher()
+		{
+			for (map_type::iterator it = subs.begin(); it != subs.end(); ++it)
+				it->second->active = false;
+		}
+
+		bool variable_subscriber::key::operator < (const key& k) const
+		{
+			if (agent != k.agent) return agent < k.agent;
+			if (var_name != k.var_name) return var_name < k.var_name;
+			if (period != k.period) return period < k.period;
+			return deadband < k.deadband;
+		}
+
+		variable_subscriber::variable_subscriber(ability& a) : next_watcher(0), a(a) {}
+
+		void variable_subscriber::subscribe(const key& k, remote_subscription& sub)
+		{
+			sub.id = a.actor->gen_identifier();
+			sub.subscribed = true;
+			sub.confirmed = false;
+			by_id[std::make_pair(k.agent, sub.id)] = k;
+
+			network::subscribe_variable* s(new network::subscribe_variable());
+			s->id = sub.id;
+			s->src = a.name;
+			s->var_name = k.var_name;
+			s->period = k.period;
+			s->deadband = k.deadband;
+			a.actor->client_db[k.agent].async_write(*s,
+					boost::bind(&variable_subscriber::handle_subscribe, this,
+								boost::asio::placeholders::error, s, k));
+		}
+
+		void variable_subscriber::handle_subscribe(const boost::system::error_code& e,
+												   network::subscribe_variable* s, key k)
+		{
+			network::identifier id = s->id;
+			delete s;
+			if (!e)
+				return;
+
+			/* the agent never got it, subscribe again on the next occasion */
+			subscription_map::iterator it = subs.find(k);
+			if (it == subs.end() || !it->second.subscribed || it->second.id != id)
+				return;
+			by_id.erase(std::make_pair(k.agent, id));
+			it->second.subscribed = false;
+			it->second.confirmed = false;
+		}
+
+		void variable_subscriber::unsubscribe(const key& k, remote_subscription& sub)
+		{
+			by_id.erase(std::make_pair(k.agent, sub.id));
+			sub.subscribed = false;
+			sub.confirmed = false;
+
+			network::unsubscribe_variable* u(new network::unsubscribe_variable());
+			u->id = sub.id;
+			u->src = a.name;
+			a.actor->client_db[k.agent].async_write(*u,
+					boost::bind(&handle_write<network::unsubscribe_variable>,
+								boost::asio::placeholders::error, u));
+		}
+
+		network::identifier variable_subscriber::watch(const std::string& agent,
+				const std::string& var_name, double period, double deadband, cb_type cb)
+		{
+			key k;
+			k.agent = agent;
+			k.var_name = var_name;
+			k.period = period;
+			k.deadband = deadband;
+
+			remote_subscription& sub = subs[k];
+			if (!sub.subscribed)
+				subscribe(k, sub);
+
+			network::identifier id = next_watcher++;
+			watcher& w = watchers[id];
+			w.k = k;
+			w.cb = cb;
+			sub.watchers.insert(id);
+			return id;
+		}
+
+		void variable_subscriber::unwatch(network::identifier id)
+		{
+			watcher_map::iterator w = watchers.find(id);
+			if (w == watchers.end())
+				return;
+
+			subscription_map::iterator it = subs.find(w->second.k);
+			watchers.erase(w);
+			if (it == subs.end())
+				return;
+
+			it->second.watchers.erase(id);
+			if (!it->second.watchers.empty())
+				return;
+
+			if (it->second.subscribed)
+				unsubscribe(it->first, it->second);
+			subs.erase(it);
+		}
+
+		bool variable_subscriber::confirmed(network::identifier id) const
+		{
+			watcher_map::const_iterator w = watchers.find(id);
+			if (w == watchers.end())
+				return false;
+
+			subscription_map::const_iterator it = subs.find(w->second.k);
+			return it != subs.end() && it->second.subscribed && it->second.confirmed;
+		}
+
+		void variable_subscriber::notify(const key& k)
+		{
+			subscription_map::const_iterator it = subs.find(k);
+			if (it == subs.end())
+				return;
+
+			/* a watcher may call unwatch, so iterate over a copy */
+			std::vector<cb_type> cbs;
+			std::set<network::identifier>::const_iterator w;
+			for (w = it->second.watchers.begin(); w != it->second.watchers.end(); ++w)
+				cbs.push_back(watchers[*w].cb);
+
+			for (size_t i = 0; i < cbs.size(); ++i)
+				cbs[i]();
+		}
+
+		void variable_subscriber::handle_update(const network::variable_update& u)
+		{
+			id_map::const_iterator it = by_id.find(std::make_pair(u.src, u.id));
+			if (it == by_id.end())
+				return;
+
+			a.remote_cache.put(u.src, u.var_name, u.value);
+
+			key k = it->second;
+			subs[k].confirmed = true;
+			notify(k);
+		}
+
+		void variable_subscriber::remove_agent(const std::string& agent)
+		{
+			std::vector<key> dead;
+			subscription_map::iterator it;
+			for (it = subs.begin(); it != subs.end(); ++it) {
+				if (it->first.agent != agent || !it->second.subscribed)
+					continue;
+				by_id.erase(std::make_pair(agent, it->second.id));
+				it->second.subscribed = false;
+				it->second.confirmed = false;
+				dead.push_back(it->first);
+			}
+
+			for (size_t i = 0; i < dead.size(); ++i)
+				notify(dead[i]);
+		}
+
+		void variable_subscriber::add_agent(const std::string& agent)
+		{
+			subscription_map::iterator it;
+			for (it = subs.begin(); it != subs.end(); ++it) {
+				if (it->first.agent != agent)
+					continue;
+				/* a new instance of the agent doesn't know the old subscription */
+				if (it->second.subscribed)
+					unsubscribe(it->first, it->second);
+				subscribe(it->first, it->second);
+			}
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#include <model/abortable_function.hh>
+#include <model/worker_pool.hh>
+
+#include <boost/bind.hpp>
+
+using namespace hyper::model;
+
+namespace {
+	/* A user function must not kill the agent, report its failure instead */
+	boost::system::error_code run_job(const worker_pool::job_type& job)
+	{
+		try {
+			job();
+		} catch (...) {
+			return make_error_code(exec_layer_error::execution_failed);
+		}
+		return boost::system::error_code();
+	}
+}
+
+worker_pool::worker_pool() : size_(0) {}
+
+void worker_pool::start(size_t nb_threads)
+{
+	if (size_ != 0 || nb_threads == 0)
+		return;
+
+	work.reset(new boost::asio::io_service::work(io_s));
+	for (size_t i = 0; i < nb_threads; ++i)
+		threads.create_thread(boost::bind(&boost::asio::io_service::run, &io_s));
+	size_ = nb_threads;
+}
+
+void worker_pool::stop()
+{
+	if (size_ == 0)
+		return;
+
+	work.reset();
+	threads.join_all();
+	size_ = 0;
+}
+
+void worker_pool::do_job(job_type job, handler_type handler,
+						 boost::asio::io_service& origin,
+						 boost::shared_ptr<boost::asio::io_service::work>)
+{
+	boost::system::error_code e = run_job(job);
+	origin.post(boost::bind(handler, e));
+}
+
+void worker_pool::async_run(job_type job, handler_type handler,
+							boost::asio::io_service& origin)
+{
+	if (size_ == 0) {
+		handler(run_job(job));
+		return;
+	}
+
+	boost::shared_ptr<boost::asio::io_service::work> origin_work(
+			new boost::asio::io_service::work(origin));
+	io_s.post(boost::bind(&worker_pool::do_job, this, job, handler,
+						  boost::ref(origin), origin_work));
+}
+
+worker_pool::~worker_pool()
+{
+	stop();
+}
@@ -0,0 +1,93 @@
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+
+#ifdef HYPER_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#include <network/compression.hh>
+
+namespace {
+	std::size_t threshold_ = 1024;
+
+	/* A compressed payload starts with the size of the raw one */
+	const std::size_t prefix_length = sizeof(boost::uint32_t);
+
+	/* Don't let a corrupted prefix allocate the world */
+	const std::size_t max_payload_size = 256 * 1024 * 1024;
+}
+
+namespace hyper {
+	namespace network {
+		bool compression_available()
+		{
+#ifdef HYPER_HAS_ZLIB
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		void set_compression_threshold(std::size_t threshold)
+		{
+			threshold_ = threshold;
+		}
+
+		std::size_t compression_threshold()
+		{
+			return threshold_;
+		}
+
+#ifdef HYPER_HAS_ZLIB
+		bool compress_payload(const std::vector<char>& in, std::vector<char>& out)
+		{
+			if (in.empty())
+				return false;
+
+			uLongf size = compressBound(in.size());
+			out.resize(prefix_length + size);
+
+			boost::uint32_t raw_size = in.size();
+			memcpy(&out[0], &raw_size, prefix_length);
+
+			int res = compress2(reinterpret_cast<Bytef*>(&out[prefix_length]), &size,
+								reinterpret_cast<const Bytef*>(&in[0]), in.size(),
+								Z_BEST_SPEED);
+			if (res != Z_OK)
+				return false;
+
+			out.resize(prefix_length + size);
+			return out.size() < in.size();
+		}
+
+		bool decompress_payload(const char* data, std::size_t size, std::vector<char>& out)
+		{
+			if (size < prefix_length)
+				return false;
+
+			boost::uint32_t raw_size;
+			memcpy(&raw_size, data, prefix_length);
+			if (raw_size > max_payload_size)
+				return false;
+
+			out.resize(raw_size);
+			uLongf dest_size = raw_size;
+			int res = uncompress(out.empty() ? 0 : reinterpret_cast<Bytef*>(&out[0]), &dest_size,
+								 reinterpret_cast<const Bytef*>(data + prefix_length),
+								 size - prefix_length);
+			return (res == Z_OK && dest_size == raw_size);
+		}
+#else
+		bool compress_payload(const std::vector<char>&, std::vector<char>&)
+		{
+			return false;
+		}
+
+		bool decompress_payload(const char*, std::size_t, std::vector<char>&)
+		{
+			return false;
+		}
+#endif
+	}
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cmath>
+
+#include <network/failure_detector.hh>
+
+namespace {
+	/*
+	 * phi of an interval y standard deviations over the mean, using the
+	 * logistic approximation of the normal cumulative distribution
+	 */
+	double phi_of_deviation(double y)
+	{
+		double e = std::exp(-y * (1.5976 + 0.070566 * y * y));
+		if (y > 0)
+			return -std::log10(e / (1.0 + e));
+		else
+			return -std::log10(1.0 - 1.0 / (1.0 + e));
+	}
+
+	/* phi is increasing, so look for its reverse by bisection */
+	double deviation_of_phi(double phi)
+	{
+		double low = 0, high = 64;
+		for (int i = 0; i < 64; ++i) {
+			double mid = (low + high) / 2;
+			if (phi_of_deviation(mid) < phi)
+				low = mid;
+			else
+				high = mid;
+		}
+		return high;
+	}
+}
+
+namespace hyper {
+	namespace network {
+		phi_accrual_detector::phi_accrual_detector(double threshold, size_t window,
+				boost::posix_time::time_duration min_std_deviation,
+				boost::posix_time::time_duration first_interval) :
+			threshold(threshold), window(window ? window : 1),
+			min_std_deviation(min_std_deviation.total_microseconds() / 1000.0),
+			first_interval(first_interval.total_microseconds() / 1000.0),
+			threshold_deviation(deviation_of_phi(threshold))
+		{}
+
+		void phi_accrual_detector::add_interval(history& h, double interval)
+		{
+			if (h.intervals.size() == window) {
+				double old = h.intervals.front();
+				h.intervals.pop_front();
+				h.sum -= old;
+				h.sum_square -= old * old;
+			}
+
+			h.intervals.push_back(interval);
+			h.sum += interval;
+			h.sum_square += interval * interval;
+		}
+
+		void phi_accrual_detector::heartbeat(const std::string& name, boost::posix_time::ptime now)
+		{
+			std::pair<history_map::iterator, bool> p = agents.insert(std::make_pair(name, history()));
+			history& h = p.first->second;
+
+			if (p.second) {
+				/* bootstrap the distribution with two intervals around first_interval */
+				add_interval(h, first_interval - first_interval / 4);
+				add_interval(h, first_interval + first_interval / 4);
+			} else if (now > h.last) {
+				if (h.bootstrap) {
+					h.intervals.clear();
+					h.sum = h.sum_square = 0;
+					h.bootstrap = false;
+				}
+				add_interval(h, (now - h.last).total_microseconds() / 1000.0);
+			}
+
+			h.last = now;
+		}
+
+		double phi_accrual_detector::mean(const history& h) const
+		{
+			return h.sum / h.intervals.size();
+		}
+
+		double phi_accrual_detector::std_deviation(const history& h) const
+		{
+			double m = mean(h);
+			double variance = h.sum_square / h.intervals.size() - m * m;
+			return std::max(std::sqrt(std::max(variance, 0.0)), min_std_deviation);
+		}
+
+		double phi_accrual_detector::phi(const std::string& name, boost::posix_time::ptime now) const
+		{
+			history_map::const_iterator it = agents.find(name);
+			if (it == agents.end())
+				return 0.0;
+
+			const history& h = it->second;
+			double elapsed = (now - h.last).total_microseconds() / 1000.0;
+			return phi_of_deviation((elapsed - mean(h)) / std_deviation(h));
+		}
+
+		boost::posix_time::time_duration
+		phi_accrual_detector::suspicion_delay(const std::string& name) const
+		{
+			double delay = first_interval + threshold_deviation * std::max(first_interval / 4,
+																		   min_std_deviation);
+			history_map::const_iterator it = agents.find(name);
+			if (it != agents.end())
+				delay = mean(it->second) + threshold_deviation * std_deviation(it->second);
+
+			return boost::posix_time::microseconds(static_cast<boost::int64_t>(std::ceil(delay * 1000)));
+		}
+
+		void phi_accrual_detector::remove(const std::string& name)
+		{
+			agents.erase(name);
+		}
+	}
+}
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <iostream>
+
+#include <network/hybrid_clock.hh>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace {
+	const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+
+	boost::int64_t wall_clock()
+	{
+		return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds();
+	}
+
+	const boost::int64_t default_max_offset = boost::posix_time::minutes(1).total_microseconds();
+}
+
+namespace hyper {
+	namespace network {
+		hlc_timestamp::hlc_timestamp(boost::posix_time::ptime t, boost::uint32_t logical) :
+			physical((t - epoch).total_microseconds()), logical(logical)
+		{}
+
+		boost::posix_time::ptime hlc_timestamp::time() const
+		{
+			return epoch + boost::posix_time::microseconds(physical);
+		}
+
+		hybrid_clock::hybrid_clock() :
+			max_offset(default_max_offset), reported_skew(0)
+		{}
+
+		hybrid_clock& hybrid_clock::instance()
+		{
+			static hybrid_clock clock;
+			return clock;
+		}
+
+		hlc_timestamp hybrid_clock::now()
+		{
+			boost::int64_t pt = wall_clock();
+
+			boost::mutex::scoped_lock lock(m);
+			if (pt > last.physical) {
+				last.physical = pt;
+				last.logical = 0;
+			} else {
+				last.logical++;
+			}
+			return last;
+		}
+
+		void hybrid_clock::update(const hlc_timestamp& remote)
+		{
+			boost::int64_t pt = wall_clock();
+
+			boost::mutex::scoped_lock lock(m);
+			if (remote.physical - pt > max_offset) {
+				/* only report the skew when it gets worse, not on each message */
+				boost::int64_t skew = remote.physical - pt;
+				if (skew > reported_skew) {
+					reported_skew = skew;
+					std::cerr << "hybrid_clock : ignoring a remote clock ahead of ";
+					std::cerr << skew / 1000000 << "s" << std::endl;
+				}
+				if (pt > last.physical) {
+					last.physical = pt;
+					last.logical = 0;
+				} else {
+					last.logical++;
+				}
+			} else if (pt > last.physical && pt > remote.physical) {
+				last.physical = pt;
+				last.logical = 0;
+			} else if (remote.physical > last.physical) {
+				last = remote;
+				last.logical++;
+			} else if (remote.physical == last.physical) {
+				last.logical = std::max(last.logical, remote.logical) + 1;
+			} else {
+				last.logical++;
+			}
+		}
+
+		void hybrid_clock::set_max_offset(const boost::posix_time::time_duration& offset)
+		{
+			boost::mutex::scoped_lock lock(m);
+			max_offset = offset.total_microseconds();
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include <network/log_merge.hh>
+
+namespace {
+	using namespace hyper::network;
+
+	struct later_msg
+	{
+		bool operator() (const log_msg& m1, const log_msg& m2) const
+		{
+			return m1.stamp < m2.stamp;
+		}
+	};
+
+	/* head of the queue of a source, ordered as a min-heap on the timestamp */
+	typedef std::pair<hlc_timestamp, std::deque<log_msg>*> head;
+
+	const hlc_timestamp end_of_time(std::numeric_limits<boost::int64_t>::max(),
+									std::numeric_limits<boost::uint32_t>::max());
+
+	struct later_head
+	{
+		bool operator() (const head& h1, const head& h2) const
+		{
+			return h2.first < h1.first;
+		}
+	};
+}
+
+namespace hyper {
+	namespace network {
+		log_merger::log_merger(output_cb cb, boost::posix_time::time_duration max_delay) :
+			cb(cb), max_delay(max_delay), size_(0)
+		{}
+
+		void log_merger::push(const log_msg& msg)
+		{
+			source& s = sources[msg.src];
+			s.alive = true;
+
+			/* keep the queue sorted, even if the agent misbehaves */
+			if (s.msgs.empty() || !(msg.stamp < s.msgs.back().stamp))
+				s.msgs.push_back(msg);
+			else
+				s.msgs.insert(std::upper_bound(s.msgs.begin(), s.msgs.end(), msg, later_msg()), msg);
+
+			if (s.watermark < msg.stamp)
+				s.watermark = msg.stamp;
+			size_++;
+		}
+
+		void log_merger::output_until(const hlc_timestamp& limit)
+		{
+			std::vector<head> heap;
+			source_map::iterator it;
+			for (it = sources.begin(); it != sources.end(); ++it)
+				if (!it->second.msgs.empty())
+					heap.push_back(head(it->second.msgs.front().stamp, &it->second.msgs));
+			std::make_heap(heap.begin(), heap.end(), later_head());
+
+			while (!heap.empty()) {
+				std::pop_heap(heap.begin(), heap.end(), later_head());
+				head h = heap.back();
+				heap.pop_back();
+				if (limit < h.first)
+					break;
+
+				cb(h.second->front());
+				h.second->pop_front();
+				size_--;
+
+				if (!h.second->empty()) {
+					heap.push_back(head(h.second->front().stamp, h.second));
+					std::push_heap(heap.begin(), heap.end(), later_head());
+				}
+			}
+
+			/* forget the dead sources once all their messages are out */
+			it = sources.begin();
+			while (it != sources.end()) {
+				source_map::iterator current = it++;
+				if (!current->second.alive && current->second.msgs.empty())
+					sources.erase(current);
+			}
+		}
+
+		void log_merger::flush(boost::posix_time::ptime now)
+		{
+			hlc_timestamp limit(now - max_delay, std::numeric_limits<boost::uint32_t>::max());
+
+			hlc_timestamp min_watermark = end_of_time;
+			source_map::const_iterator it;
+			for (it = sources.begin(); it != sources.end(); ++it)
+				if (it->second.alive && it->second.watermark < min_watermark)
+					min_watermark = it->second.watermark;
+
+			if (limit < min_watermark)
+				limit = min_watermark;
+			output_until(limit);
+		}
+
+		void log_merger::flush_all()
+		{
+			output_until(end_of_time);
+		}
+
+		void log_merger::remove_source(const std::string& src)
+		{
+			source_map::iterator it = sources.find(src);
+			if (it != sources.end())
+				it->second.alive = false;
+		}
+	}
+}
@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <regex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <network/log_store.hh>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/lexical_cast.hpp>
+
+namespace {
+	using namespace hyper::network;
+
+	const size_t record_header_size = sizeof(boost::int64_t) + 3 * sizeof(boost::uint32_t);
+
+	const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+
+	boost::int64_t to_us(const boost::posix_time::ptime& date)
+	{
+		return (date - epoch).total_microseconds();
+	}
+
+	boost::posix_time::ptime from_us(boost::int64_t us)
+	{
+		return epoch + boost::posix_time::microseconds(us);
+	}
+
+	template <typename T>
+	void write_raw(std::ofstream& out, const T& v)
+	{
+		out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+	}
+
+	template <typename T>
+	T read_raw(const char* addr)
+	{
+		T v;
+		std::memcpy(&v, addr, sizeof(T));
+		return v;
+	}
+
+	std::string agent_index_path(const std::string& path, boost::uint32_t id)
+	{
+		return path + ".idx." + boost::lexical_cast<std::string>(id);
+	}
+
+	std::string unsorted_path(const std::string& path)
+	{
+		return path + ".unsorted";
+	}
+
+	boost::uint64_t file_size(const std::string& path)
+	{
+		struct stat st;
+		if (::stat(path.c_str(), &st) < 0)
+			return 0;
+		return st.st_size;
+	}
+
+	bool file_exists(const std::string& path)
+	{
+		struct stat st;
+		return ::stat(path.c_str(), &st) == 0;
+	}
+
+	/* stamp of the last entry of an index, or the lowest stamp if it is empty */
+	boost::int64_t last_index_stamp(const std::string& path)
+	{
+		boost::int64_t stamp = std::numeric_limits<boost::int64_t>::min();
+		boost::uint64_t size = file_size(path);
+		if (size < sizeof(log_index_entry))
+			return stamp;
+
+		std::ifstream in(path.c_str(), std::ios_base::in | std::ios_base::binary);
+		log_index_entry e;
+		in.seekg((size / sizeof(e) - 1) * sizeof(e));
+		if (in.read(reinterpret_cast<char*>(&e), sizeof(e)))
+			stamp = e.stamp;
+		return stamp;
+	}
+
+	void read_agents(const std::string& path, std::vector<std::string>& agents)
+	{
+		std::ifstream in(path.c_str());
+		std::string line;
+		while (std::getline(in, line))
+			agents.push_back(line);
+	}
+
+	struct cmp_entry_stamp
+	{
+		bool operator() (const log_index_entry& e, boost::int64_t stamp) const
+		{
+			return e.stamp < stamp;
+		}
+
+		bool operator() (boost::int64_t stamp, const log_index_entry& e) const
+		{
+			return stamp < e.stamp;
+		}
+
+		bool operator() (const log_index_entry& e1, const log_index_entry& e2) const
+		{
+			return e1.stamp < e2.stamp;
+		}
+	};
+
+	/* RAII wrapper of a POSIX extended regex */
+	class regex
+	{
+		regex_t re;
+		bool valid;
+
+		public:
+			explicit regex(const std::string& expr) : valid(false)
+			{
+				if (expr.empty())
+					return;
+				if (regcomp(&re, expr.c_str(), REG_EXTENDED | REG_NOSUB) != 0)
+					throw log_store_error("invalid regex " + expr);
+				valid = true;
+			}
+
+			~regex()
+			{
+				if (valid)
+					regfree(&re);
+			}
+
+			bool match(const std::string& s) const
+			{
+				return !valid || regexec(&re, s.c_str(), 0, 0, 0) == 0;
+			}
+	};
+}
+
+namespace hyper {
+	namespace network {
+		log_store_writer::log_store_writer(const std::string& path_) :
+			path(path_), offset(file_size(path)),
+			last_stamp(last_index_stamp(path + ".idx")),
+			sorted(!file_exists(unsorted_path(path)))
+		{
+			std::vector<std::string> known;
+			read_agents(path + ".agents", known);
+			for (size_t i = 0; i < known.size(); ++i)
+				ids[known[i]] = i;
+			agent_indexes.resize(known.size());
+
+			std::ios_base::openmode mode = std::ios_base::out | std::ios_base::app | std::ios_base::binary;
+			data.open(path.c_str(), mode);
+			index.open((path + ".idx").c_str(), mode);
+			agents.open((path + ".agents").c_str(), std::ios_base::out | std::ios_base::app);
+			if (!data || !index || !agents)
+				throw log_store_error("can't open log store " + path);
+		}
+
+		boost::uint32_t log_store_writer::agent_id(const std::string& src)
+		{
+			std::map<std::string, boost::uint32_t>::const_iterator it = ids.find(src);
+			if (it != ids.end())
+				return it->second;
+
+			boost::uint32_t id = ids.size();
+			ids[src] = id;
+			agents << src << std::endl;
+			agent_indexes.resize(id + 1);
+			return id;
+		}
+
+		std::ofstream& log_store_writer::agent_index(boost::uint32_t id)
+		{
+			boost::shared_ptr<std::ofstream>& out = agent_indexes[id];
+			if (!out) {
+				std::string file = agent_index_path(path, id);
+				out.reset(new std::ofstream(file.c_str(), std::ios_base::out |
+													  std::ios_base::app |
+													  std::ios_base::binary));
+				if (!*out)
+					throw log_store_error("can't open log store index " + file);
+			}
+			return *out;
+		}
+
+		void log_store_writer::append(const log_msg& msg)
+		{
+			log_index_entry e;
+			e.stamp = msg.stamp.physical;
+			e.offset = offset;
+			e.agent = agent_id(msg.src);
+			e.size = record_header_size + msg.src.size() + msg.msg.size();
+
+			/* mark the store before its indexes stop being sorted */
+			if (sorted && e.stamp < last_stamp) {
+				std::string file = unsorted_path(path);
+				std::ofstream marker(file.c_str());
+				if (!marker)
+					throw log_store_error("can't create " + file);
+				sorted = false;
+			}
+			last_stamp = std::max(last_stamp, e.stamp);
+
+			write_raw(data, to_us(msg.date));
+			write_raw(data, msg.stamp.logical);
+			write_raw(data, boost::uint32_t(msg.src.size()));
+			write_raw(data, boost::uint32_t(msg.msg.size()));
+			data.write(msg.src.data(), msg.src.size());
+			data.write(msg.msg.data(), msg.msg.size());
+
+			/* the index entry only refers to complete records */
+			index.write(reinterpret_cast<const char*>(&e), sizeof(e));
+			agent_index(e.agent).write(reinterpret_cast<const char*>(&e), sizeof(e));
+			offset += e.size;
+		}
+
+		void log_store_writer::flush()
+		{
+			data.flush();
+			index.flush();
+			agents.flush();
+			for (size_t i = 0; i < agent_indexes.size(); ++i)
+				if (agent_indexes[i])
+					agent_indexes[i]->flush();
+		}
+
+		void log_store_reader::map_file(const std::string& path, mapping& m)
+		{
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				throw log_store_error("can't open " + path);
+
+			struct stat st;
+			if (::fstat(fd, &st) < 0) {
+				::close(fd);
+				throw log_store_error("can't stat " + path);
+			}
+
+			m.size = st.st_size;
+			if (m.size != 0) {
+				void* addr = ::mmap(0, m.size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (addr == MAP_FAILED) {
+					::close(fd);
+					throw log_store_error("can't map " + path);
+				}
+				m.addr = static_cast<const char*>(addr);
+			}
+			::close(fd);
+		}
+
+		void log_store_reader::unmap_file(mapping& m)
+		{
+			if (m.addr)
+				::munmap(const_cast<char*>(m.addr), m.size);
+			m.addr = 0;
+			m.size = 0;
+		}
+
+		log_store_reader::log_store_reader(const std::string& path_) :
+			path(path_), sorted(!file_exists(unsorted_path(path)))
+		{
+			map_file(path, data);
+			try {
+				map_file(path + ".idx", index);
+			} catch (const log_store_error&) {
+				unmap_file(data);
+				throw;
+			}
+			read_agents(path + ".agents", agents);
+		}
+
+		log_store_reader::~log_store_reader()
+		{
+			unmap_file(index);
+			unmap_file(data);
+		}
+
+		const log_index_entry* log_store_reader::entries() const
+		{
+			return reinterpret_cast<const log_index_entry*>(index.addr);
+		}
+
+		size_t log_store_reader::size() const
+		{
+			return index.size / sizeof(log_index_entry);
+		}
+
+		log_msg log_store_reader::read(const log_index_entry& e) const
+		{
+			const char* p = data.addr + e.offset;
+			boost::int64_t date = read_raw<boost::int64_t>(p);
+			p += sizeof(boost::int64_t);
+			boost::uint32_t logical = read_raw<boost::uint32_t>(p);
+			p += sizeof(boost::uint32_t);
+			boost::uint32_t src_size = read_raw<boost::uint32_t>(p);
+			p += sizeof(boost::uint32_t);
+			boost::uint32_t msg_size = read_raw<boost::uint32_t>(p);
+			p += sizeof(boost::uint32_t);
+
+			log_msg msg;
+			msg.date = from_us(date);
+			msg.stamp = hlc_timestamp(e.stamp, logical);
+			msg.src.assign(p, src_size);
+			msg.msg.assign(p + src_size, msg_size);
+			return msg;
+		}
+
+		size_t log_store_reader::query(const log_query& q, output_cb cb) const
+		{
+			if (q.agent.empty())
+				return query(entries(), entries() + size(), q, cb);
+
+			std::vector<std::string>::const_iterator it;
+			it = std::find(agents.begin(), agents.end(), q.agent);
+			if (it == agents.end())
+				return 0;
+
+			/* only go through the entries of this agent */
+			mapping agent_index;
+			map_file(agent_index_path(path, it - agents.begin()), agent_index);
+			const log_index_entry* begin = reinterpret_cast<const log_index_entry*>(agent_index.addr);
+			const log_index_entry* end = begin + agent_index.size / sizeof(log_index_entry);
+
+			size_t matches;
+			try {
+				matches = query(begin, end, q, cb);
+			} catch (...) {
+				unmap_file(agent_index);
+				throw;
+			}
+			unmap_file(agent_index);
+			return matches;
+		}
+
+		size_t log_store_reader::query(const log_index_entry* begin, const log_index_entry* end,
+									   const log_query& q, output_cb cb) const
+		{
+			std::vector<log_index_entry> selected;
+			if (sorted) {
+				if (!q.since.is_not_a_date_time())
+					begin = std::lower_bound(begin, end, to_us(q.since), cmp_entry_stamp());
+				if (!q.until.is_not_a_date_time())
+					end = std::upper_bound(begin, end, to_us(q.until), cmp_entry_stamp());
+			} else {
+				/* late messages are out of order, scan the whole index and
+				 * sort what is in the range */
+				boost::int64_t since = q.since.is_not_a_date_time() ?
+					std::numeric_limits<boost::int64_t>::min() : to_us(q.since);
+				boost::int64_t until = q.until.is_not_a_date_time() ?
+					std::numeric_limits<boost::int64_t>::max() : to_us(q.until);
+				for (const log_index_entry* e = begin; e != end; ++e)
+					if (e->stamp >= since && e->stamp <= until)
+						selected.push_back(*e);
+				std::stable_sort(selected.begin(), selected.end(), cmp_entry_stamp());
+				begin = selected.empty() ? 0 : &selected[0];
+				end = begin + selected.size();
+			}
+
+			regex re(q.grep);
+			size_t matches = 0;
+			for (const log_index_entry* e = begin; e != end; ++e) {
+				/* skip the records truncated by a crash of the writer */
+				if (e->offset + e->size > data.size)
+					continue;
+
+				log_msg msg = read(*e);
+				if (!re.match(msg.msg))
+					continue;
+
+				cb(msg);
+				matches++;
+			}
+
+			return matches;
+		}
+	}
+}
@@ -1,3 +1,4 @@
+#include <network/compact_archive.hh>
 #include <network/msg.hh>
 
 #include <boost/algorithm/string/trim.hpp>
@@ -12,6 +13,49 @@
 #include <boost/serialization/split_member.hpp>
 #include <boost/date_time/posix_time/time_serialize.hpp>
 
+namespace {
+	void put_little_endian(char*& out, boost::uint64_t v, std::size_t size)
+	{
+		for (std::size_t i = 0; i < size; ++i) {
+			*out++ = static_cast<char>(v & 0xff);
+			v >>= 8;
+		}
+	}
+
+	boost::uint64_t get_little_endian(const char*& in, std::size_t size)
+	{
+		boost::uint64_t v = 0;
+		for (std::size_t i = 0; i < size; ++i)
+			v |= static_cast<boost::uint64_t>(static_cast<unsigned char>(*in++)) << (8 * i);
+		return v;
+	}
+}
+
+namespace hyper {
+	namespace network {
+		void encode_header(const header& head, char* out)
+		{
+			put_little_endian(out, head.type, sizeof(head.type));
+			put_little_endian(out, head.size, sizeof(head.size));
+			put_little_endian(out, static_cast<boost::uint64_t>(head.stamp.physical),
+							  sizeof(head.stamp.physical));
+			put_little_endian(out, head.stamp.logical, sizeof(head.stamp.logical));
+		}
+
+		header decode_header(const char* in)
+		{
+			header head;
+			head.type = static_cast<uint32_t>(get_little_endian(in, sizeof(head.type)));
+			head.size = static_cast<uint32_t>(get_little_endian(in, sizeof(head.size)));
+			head.stamp.physical = static_cast<boost::int64_t>(
+					get_little_endian(in, sizeof(head.stamp.physical)));
+			head.stamp.logical = static_cast<boost::uint32_t>(
+					get_little_endian(in, sizeof(head.stamp.logical)));
+			return head;
+		}
+	}
+}
+
 namespace boost {
 	namespace serialization {
 		template<class Archive>
@@ -136,7 +180,11 @@ namespace {
 	    template void name::serialize<boost::archive::binary_iarchive>( \
                     boost::archive::binary_iarchive & ar, const unsigned int file_version); \
 	    template void name::serialize<boost::archive::binary_oarchive>( \
-                    boost::archive::binary_oarchive & ar, const unsigned int file_version); 
+                    boost::archive::binary_oarchive & ar, const unsigned int file_version); \
+	    template void name::serialize<hyper::network::compact_iarchive>( \
+                    hyper::network::compact_iarchive & ar, const unsigned int file_version); \
+	    template void name::serialize<hyper::network::compact_oarchive>( \
+                    hyper::network::compact_oarchive & ar, const unsigned int file_version); 
 
 namespace hyper {
 	namespace network {
@@ -153,7 +201,7 @@ namespace hyper {
 		void request_name_answer::serialize(Archive & ar, const unsigned int version)
 		{
 			(void) version;
-			ar & name & success & endpoints;
+			ar & name & success & endpoints & host & local_endpoints;
 		}
 
 		REGISTER_SERIALIZE(request_name_answer)
@@ -162,7 +210,7 @@ namespace hyper {
 		void register_name::serialize(Archive& ar, const unsigned int version)
 		{
 			(void) version;
-			ar & name & endpoints;
+			ar & name & endpoints & host & local_endpoints;
 		}
 
 		REGISTER_SERIALIZE(register_name)
@@ -171,7 +219,7 @@ namespace hyper {
 		void register_name_answer::serialize(Archive & ar, const unsigned int version) 
 		{
 			(void) version;
-			ar & name & success;
+			ar & name & success & directory_version & directory;
 		}
 
 		REGISTER_SERIALIZE(register_name_answer)
@@ -207,7 +255,7 @@ namespace hyper {
 		void inform_new_agent::serialize(Archive& ar, const unsigned int version)
 		{
 			(void) version;
-			ar & new_agents;
+			ar & new_agents & directory_version & addresses;
 		}
 
 		REGISTER_SERIALIZE(inform_new_agent)
@@ -216,7 +264,7 @@ namespace hyper {
 		void inform_death_agent::serialize(Archive& ar, const unsigned int version)
 		{
 			(void) version;
-			ar & dead_agents;
+			ar & dead_agents & directory_version;
 		}
 
 		REGISTER_SERIALIZE(inform_death_agent)
@@ -239,6 +287,51 @@ namespace hyper {
 
 		REGISTER_SERIALIZE(variable_value)
 
+		template<class Archive>
+		void request_variable_values::serialize(Archive& ar, const unsigned int version)
+		{
+			(void) version;
+			ar & id & src & var_names;
+		}
+
+		REGISTER_SERIALIZE(request_variable_values)
+
+		template<class Archive>
+		void variable_values::serialize(Archive& ar, const unsigned int version)
+		{
+			(void) version;
+			ar & id & src & values;
+		}
+
+		REGISTER_SERIALIZE(variable_values)
+
+		template<class Archive>
+		void subscribe_variable::serialize(Archive& ar, const unsigned int version)
+		{
+			(void) version;
+			ar & id & src & var_name & period & deadband;
+		}
+
+		REGISTER_SERIALIZE(subscribe_variable)
+
+		template<class Archive>
+		void unsubscribe_variable::serialize(Archive& ar, const unsigned int version)
+		{
+			(void) version;
+			ar & id & src;
+		}
+
+		REGISTER_SERIALIZE(unsubscribe_variable)
+
+		template<class Archive>
+		void variable_update::serialize(Archive& ar, const unsigned int version)
+		{
+			(void) version;
+			ar & id & src & var_name & value;
+		}
+
+		REGISTER_SERIALIZE(variable_update)
+
 		template <class Archive>
 		void request_constraint::serialize(Archive& ar, const unsigned int version)
 		{
@@ -270,11 +363,12 @@ namespace hyper {
 		void log_msg::serialize(Archive& ar, const unsigned int version)
 		{
 			(void) version;
-			ar & date & src & msg;
+			ar & date & stamp.physical & stamp.logical & src & msg;
 		}
 
 		log_msg::log_msg(const std::string& src_, const std::string& msg_) :
 			date(boost::posix_time::microsec_clock::local_time()),
+			stamp(hybrid_clock::instance().now()),
 			src(src_), msg(msg_)
 		{
 			boost::trim(msg);
@@ -282,6 +376,42 @@ namespace hyper {
 
 		REGISTER_SERIALIZE(log_msg)
 
+		template <class Archive>
+		void log_msgs::line::serialize(Archive& ar, const unsigned int version)
+		{
+			(void) version;
+			ar & date & stamp.physical & stamp.logical & msg;
+		}
+
+		log_msgs::line::line(const std::string& msg_) :
+			date(boost::posix_time::microsec_clock::local_time()),
+			stamp(hybrid_clock::instance().now()),
+			msg(msg_)
+		{
+			boost::trim(msg);
+		}
+
+		template <class Archive>
+		void log_msgs::serialize(Archive& ar, const unsigned int version)
+		{
+			(void) version;
+			ar & src & lines;
+		}
+
+		void log_msgs::split(std::vector<log_msg>& out) const
+		{
+			for (size_t i = 0; i < lines.size(); ++i) {
+				log_msg msg;
+				msg.date = lines[i].date;
+				msg.stamp = lines[i].stamp;
+				msg.src = src;
+				msg.msg = lines[i].msg;
+				out.push_back(msg);
+			}
+		}
+
+		REGISTER_SERIALIZE(log_msgs)
+
 		template <class Archive>
 		void terminate::serialize(Archive& ar, const unsigned int version)
 		{
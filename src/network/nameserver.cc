@@ -1,5 +1,7 @@
 #include <boost/lexical_cast.hpp>
 
+#include <boost/asio/ip/host_name.hpp>
+
 #include <network/nameserver.hh>
 
 namespace hyper {
@@ -78,6 +80,8 @@ namespace hyper {
 				res_msg.name = r.name;
 				res_msg.success = res.first;
 				res_msg.endpoints = res.second.tcp_endpoints;
+				res_msg.host = res.second.host;
+				res_msg.local_endpoints = res.second.local_endpoints;
 
 //				output_ << "answering to name request : " << res_msg << std::endl;
 				return res_msg;
@@ -90,6 +94,8 @@ namespace hyper {
 //				output_ << "receiving name register request : " << r << std::endl;
 				ns::addr_storage addr;
 				addr.tcp_endpoints = r.endpoints;
+				addr.host = r.host;
+				addr.local_endpoints = r.local_endpoints;
 				bool res = map_.add(r.name, addr);
 
 				register_name_answer res_msg;
@@ -125,26 +131,76 @@ namespace hyper {
 
 		name_client::name_client(boost::asio::io_service& io_s,
 						const std::string& addr, const std::string& port) :
-			client(io_s), io_s(io_s), is_resolving(false)
+			client(io_s), io_s(io_s), is_reading(false), directory_version(0)
 		{
 			client.connect(addr, port);
 		}
 
 		bool
 		name_client::register_name(const std::string& ability,
-								  const std::vector<boost::asio::ip::tcp::endpoint>& v)
+								  const std::vector<boost::asio::ip::tcp::endpoint>& v,
+								  const std::vector<std::string>& local_endpoints)
 		{
 			network::register_name re;
 			register_name_answer rea;
 
 			re.name = ability;
 			std::copy(v.begin(), v.end(), std::back_inserter(re.endpoints));
+			if (!local_endpoints.empty()) {
+				re.host = boost::asio::ip::host_name();
+				re.local_endpoints = local_endpoints;
+			}
 
 			client.request(re, rea);
+			install(rea);
 
 			return rea.success;
 		}
 
+		void name_client::install(const register_name_answer& rea)
+		{
+			/* deltas more recent than the snapshot may already be there */
+			if (!rea.success || rea.directory_version <= directory_version)
+				return;
+
+			for (size_t i = 0; i < rea.directory.size(); ++i)
+				cache[rea.directory[i].name] = rea.directory[i];
+			directory_version = rea.directory_version;
+		}
+
+		bool name_client::next_version(boost::uint64_t version)
+		{
+			if (version == 0 || version <= directory_version)
+				return false;
+
+			/*
+			 * Some deltas have been missed, so the cached addresses may
+			 * be stale, ask the name server again for them
+			 */
+			if (version != directory_version + 1)
+				cache.clear();
+
+			directory_version = version;
+			return true;
+		}
+
+		void name_client::apply(const inform_new_agent& msg)
+		{
+			if (!next_version(msg.directory_version))
+				return;
+
+			for (size_t i = 0; i < msg.addresses.size(); ++i)
+				cache[msg.addresses[i].name] = msg.addresses[i];
+		}
+
+		void name_client::apply(const inform_death_agent& msg)
+		{
+			/* forgetting a dead agent is always safe, even for an old delta */
+			next_version(msg.directory_version);
+			for (size_t i = 0; i < msg.dead_agents.size(); ++i)
+				cache.erase(msg.dead_agents[i]);
+		}
+
 		std::pair<bool, std::vector<boost::asio::ip::tcp::endpoint> >
 		name_client::sync_resolve(const std::string& ability)
 		{
@@ -158,5 +214,102 @@ namespace hyper {
 				return std::make_pair(true, rna.endpoints);
 			return std::make_pair(false, std::vector<boost::asio::ip::tcp::endpoint>() );
 		}
+
+		void name_client::async_resolve_(const std::string& name, resolve_cb cb)
+		{
+			cache_map::const_iterator it = cache.find(name);
+			if (it != cache.end()) {
+				io_s.post(boost::bind(cb, boost::system::error_code(), it->second));
+				return;
+			}
+
+			/*
+			 * If a request for this name is already in flight, just wait
+			 * for its answer
+			 */
+			std::vector<resolve_cb>& cbs = waiting[name];
+			cbs.push_back(cb);
+			if (cbs.size() > 1)
+				return;
+
+			request_name* rn(new request_name());
+			rn->name = name;
+			in_flight.push_back(name);
+			client.async_write(*rn, boost::bind(&name_client::handle_write, this,
+												boost::asio::placeholders::error, rn));
+			read_answer();
+		}
+
+		void name_client::handle_write(const boost::system::error_code& e, request_name* rn)
+		{
+			delete rn;
+			if (e)
+				abort_all(e);
+		}
+
+		void name_client::read_answer()
+		{
+			if (is_reading || in_flight.empty())
+				return;
+
+			is_reading = true;
+			client.async_read(answer, boost::bind(&name_client::handle_read, this,
+												  boost::asio::placeholders::error));
+		}
+
+		void name_client::handle_read(const boost::system::error_code& e)
+		{
+			is_reading = false;
+			if (e) {
+				abort_all(e);
+				return;
+			}
+
+			/* the name server answers in order */
+			if (in_flight.empty())
+				return;
+			std::string name = in_flight.front();
+			in_flight.pop_front();
+
+			request_name_answer ans = answer;
+			if (ans.success)
+				cache[name] = ans;
+
+			read_answer();
+			complete(name, e, ans);
+		}
+
+		void name_client::complete(const std::string& name, const boost::system::error_code& e,
+								   const request_name_answer& ans)
+		{
+			waiting_map::iterator it = waiting.find(name);
+			if (it == waiting.end())
+				return;
+
+			std::vector<resolve_cb> cbs;
+			cbs.swap(it->second);
+			waiting.erase(it);
+
+			for (size_t i = 0; i < cbs.size(); ++i)
+				cbs[i](e, ans);
+		}
+
+		void name_client::abort_all(const boost::system::error_code& e)
+		{
+			std::deque<std::string> names;
+			names.swap(in_flight);
+
+			for (size_t i = 0; i < names.size(); ++i) {
+				request_name_answer ans;
+				ans.name = names[i];
+				ans.success = false;
+				complete(names[i], e, ans);
+			}
+		}
+
+		void name_client::invalidate(const std::string& name)
+		{
+			cache.erase(name);
+		}
 	}
 }
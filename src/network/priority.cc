@@ -0,0 +1,48 @@
+#include <network/priority.hh>
+
+namespace hyper {
+	namespace network {
+		const char* message_class_name(message_class c)
+		{
+			switch (c) {
+				case control_class:
+					return "control";
+				case normal_class:
+					return "normal";
+				case bulk_class:
+					return "bulk";
+				default:
+					return "unknown";
+			}
+		}
+
+		message_latency& message_latency::instance()
+		{
+			static message_latency latency;
+			return latency;
+		}
+
+		void message_latency::record(message_class c, boost::posix_time::time_duration latency)
+		{
+			boost::mutex::scoped_lock lock(m);
+			summary& s = stats[c];
+			s.count++;
+			s.total += latency;
+			if (latency > s.max)
+				s.max = latency;
+		}
+
+		message_latency::summary message_latency::get(message_class c)
+		{
+			boost::mutex::scoped_lock lock(m);
+			return stats[c];
+		}
+
+		void message_latency::reset()
+		{
+			boost::mutex::scoped_lock lock(m);
+			for (size_t i = 0; i < nb_message_classes; ++i)
+				stats[i] = summary();
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#include <network/protocol_error.hh>
+
+namespace hyper {
+	namespace network {
+		const char* protocol_category_impl::name() const {
+			return "protocol";
+		}
+
+		std::string protocol_category_impl::message(int ev) const
+		{
+			switch(ev) {
+				case protocol_error::ok:
+					return "ok";
+				case protocol_error::request_timeout:
+					return "request_timeout";
+				default:
+					return "unknow_error";
+			}
+		}
+
+		const boost::system::error_category& protocol_category()
+		{
+			static protocol_category_impl instance;
+			return instance;
+		}
+	}
+}
@@ -0,0 +1,104 @@
+#include <network/timer_wheel.hh>
+
+#include <boost/asio/placeholders.hpp>
+#include <boost/bind.hpp>
+
+namespace hyper {
+	namespace network {
+		timer_wheel::timer_wheel(boost::asio::io_service& io_s, expire_cb cb,
+								 boost::posix_time::time_duration tick,
+								 size_t nb_slots) :
+			timer(io_s), tick(tick), slots(nb_slots ? nb_slots : 1),
+			current(0), running(false), cb(cb)
+		{}
+
+		void timer_wheel::schedule(identifier id, boost::posix_time::time_duration delay)
+		{
+			cancel(id);
+
+			/* number of ticks to wait, rounded up */
+			size_t ticks = 1;
+			if (delay > tick)
+				ticks = (delay.total_microseconds() + tick.total_microseconds() - 1) /
+						 tick.total_microseconds();
+
+			entry e;
+			e.id = id;
+			e.rounds = (ticks - 1) / slots.size();
+
+			size_t pos = (current + ticks) % slots.size();
+			slot& s = slots[pos];
+			index[id] = std::make_pair(pos, s.insert(s.end(), e));
+
+			if (!running)
+				start();
+		}
+
+		void timer_wheel::cancel(identifier id)
+		{
+			index_map::iterator it = index.find(id);
+			if (it == index.end())
+				return;
+
+			slots[it->second.first].erase(it->second.second);
+			index.erase(it);
+		}
+
+		void timer_wheel::stop()
+		{
+			for (size_t i = 0; i < slots.size(); ++i)
+				slots[i].clear();
+			index.clear();
+			timer.cancel();
+			/* the aborted handler must not prevent a restart by schedule() */
+			running = false;
+		}
+
+		void timer_wheel::start()
+		{
+			running = true;
+			timer.expires_from_now(tick);
+			timer.async_wait(boost::bind(&timer_wheel::handle_tick, this,
+										 boost::asio::placeholders::error));
+		}
+
+		void timer_wheel::handle_tick(const boost::system::error_code& e)
+		{
+			/* stop() or start() has already updated running */
+			if (e == boost::asio::error::operation_aborted)
+				return;
+
+			running = false;
+
+			current = (current + 1) % slots.size();
+
+			/*
+			 * cb may schedule or cancel other deadlines, so collect the
+			 * expired ones before calling it
+			 */
+			std::vector<identifier> expired;
+			slot& s = slots[current];
+			slot::iterator it = s.begin();
+			while (it != s.end()) {
+				if (it->rounds == 0) {
+					expired.push_back(it->id);
+					index.erase(it->id);
+					it = s.erase(it);
+				} else {
+					it->rounds--;
+					++it;
+				}
+			}
+
+			if (!index.empty()) {
+				running = true;
+				timer.expires_at(timer.expires_at() + tick);
+				timer.async_wait(boost::bind(&timer_wheel::handle_tick, this,
+											 boost::asio::placeholders::error));
+			}
+
+			for (size_t i = 0; i < expired.size(); ++i)
+				cb(expired[i]);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#include <cstdlib>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/asio/ip/host_name.hpp>
+#include <boost/functional/hash.hpp>
+
+#include <network/transport.hh>
+
+namespace {
+	std::string socket_path(const std::string& dir, const std::string& name)
+	{
+		std::ostringstream oss;
+		oss << dir << "/hyper-" << name << "-" << getpid() << ".sock";
+		return oss.str();
+	}
+
+	bool fits(const std::string& path)
+	{
+		return path.size() < sizeof(static_cast<sockaddr_un*>(0)->sun_path);
+	}
+}
+
+namespace hyper {
+	namespace network {
+		std::string local_socket_path(const std::string& name)
+		{
+			const char* dir = getenv("TMPDIR");
+			std::string path = socket_path(dir ? dir : "/tmp", name);
+			if (fits(path))
+				return path;
+
+			/* too long for a sockaddr_un : shorten the name, then the directory */
+			std::ostringstream hashed;
+			hashed << std::hex << boost::hash<std::string>()(name);
+			if (dir) {
+				path = socket_path(dir, hashed.str());
+				if (fits(path))
+					return path;
+			}
+			path = socket_path("/tmp", hashed.str());
+			return fits(path) ? path : std::string();
+		}
+
+		std::vector<stream_protocol::endpoint>
+		preferred_endpoints(const std::string& host,
+							const std::vector<std::string>& local_endpoints,
+							const std::vector<boost::asio::ip::tcp::endpoint>& tcp_endpoints)
+		{
+			std::vector<stream_protocol::endpoint> res;
+
+#ifdef HYPER_HAS_LOCAL_SOCKETS
+			if (!host.empty() && host == boost::asio::ip::host_name()) {
+				std::vector<std::string>::const_iterator it;
+				for (it = local_endpoints.begin(); it != local_endpoints.end(); ++it)
+					res.push_back(boost::asio::local::stream_protocol::endpoint(*it));
+			}
+#else
+			(void) host; (void) local_endpoints;
+#endif
+
+			std::vector<boost::asio::ip::tcp::endpoint>::const_iterator it;
+			for (it = tcp_endpoints.begin(); it != tcp_endpoints.end(); ++it)
+				res.push_back(*it);
+
+			return res;
+		}
+	}
+}
@@ -0,0 +1,98 @@
+/*
+ * Matchers generated by hyperc for the rules of the ability first, in
+ * example.ability. test_compiler_rule_matcher checks that they are still
+ * the output of dump_rule_matcher, and test_logic_engine compiles them and
+ * compares their matches with the ones of the generic unification.
+ */
+#ifndef HYPER_TEST_EXAMPLE_RULE_MATCHERS_HH_
+#define HYPER_TEST_EXAMPLE_RULE_MATCHERS_HH_
+
+#include <logic/facts.hh>
+#include <logic/rules.hh>
+
+#include <boost/variant/get.hpp>
+
+namespace hyper {
+	namespace first {
+			/* specialised matcher for rule first::less_assoc */
+			size_t match_less_assoc(const logic::rule& r, const logic::facts& f,
+					std::vector<logic::function_call>& res)
+			{
+				size_t matches = 0;
+				const logic::function_call& p_0 = r.condition[0];
+				const logic::function_call& p_1 = r.condition[1];
+				const logic::function_call& q_0 = r.action[0];
+				for (logic::facts::const_iterator it_0 = f.begin(p_0.id);
+						it_0 != f.end(p_0.id); ++it_0) {
+					const logic::expression& v0 = it_0->args[0]; // A
+					const logic::expression& v1 = it_0->args[1]; // B
+					for (logic::facts::const_iterator it_1 = f.begin(p_1.id);
+							it_1 != f.end(p_1.id); ++it_1) {
+						if (it_1->args[0] != v1) continue;
+						const logic::expression& v2 = it_1->args[1]; // C
+						++matches;
+						{
+							logic::function_call c_0(q_0, true);
+							c_0.args[0] = v0;
+							c_0.args[1] = v2;
+							res.push_back(c_0);
+						}
+					}
+				}
+				return matches;
+			}
+
+			/* specialised matcher for rule first::less_false */
+			size_t match_less_false(const logic::rule& r, const logic::facts& f,
+					std::vector<logic::function_call>& res)
+			{
+				(void) res;
+				size_t matches = 0;
+				const logic::function_call& p_0 = r.condition[0];
+				for (logic::facts::const_iterator it_0 = f.begin(p_0.id);
+						it_0 != f.end(p_0.id); ++it_0) {
+					const logic::expression& v0 = it_0->args[0]; // A
+					if (it_0->args[1] != v0) continue;
+					++matches;
+					return matches;
+				}
+				return matches;
+			}
+
+			/* specialised matcher for rule first::distance_symetry */
+			size_t match_distance_symetry(const logic::rule& r, const logic::facts& f,
+					std::vector<logic::function_call>& res)
+			{
+				size_t matches = 0;
+				const logic::function_call& p_0 = r.condition[0];
+				const logic::function_call& q_0 = r.action[0];
+				const logic::function_call& q_0_0 = boost::get<logic::function_call>(q_0.args[0].expr);
+				const logic::function_call& q_0_1 = boost::get<logic::function_call>(q_0.args[1].expr);
+				for (logic::facts::const_iterator it_0 = f.begin(p_0.id);
+						it_0 != f.end(p_0.id); ++it_0) {
+					const logic::expression& v0 = it_0->args[0]; // A
+					const logic::expression& v1 = it_0->args[1]; // B
+					++matches;
+					{
+						logic::function_call c_0(q_0, true);
+						{
+							logic::function_call c_0_0(q_0_0, true);
+							c_0_0.args[0] = v0;
+							c_0_0.args[1] = v1;
+							c_0.args[0] = c_0_0;
+						}
+						{
+							logic::function_call c_0_1(q_0_1, true);
+							c_0_1.args[0] = v1;
+							c_0_1.args[1] = v0;
+							c_0.args[1] = c_0_1;
+						}
+						res.push_back(c_0);
+					}
+				}
+				return matches;
+			}
+	}
+}
+
+#endif /* HYPER_TEST_EXAMPLE_RULE_MATCHERS_HH_ */
@@ -0,0 +1,54 @@
+#include <compiler/parser.hh>
+#include <compiler/universe.hh>
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+using namespace hyper::compiler;
+
+namespace {
+	/* Extract the matcher generated for rule from the output of hyperc */
+	std::string generated_matcher(const std::string& output, const std::string& rule)
+	{
+		std::string begin = "\t\t\t/* specialised matcher for rule first::" + rule + " */\n";
+		std::string::size_type start = output.find(begin);
+		if (start == std::string::npos)
+			return "";
+
+		std::string::size_type end = output.find("\t\t\t}\n\n", start);
+		if (end == std::string::npos)
+			return "";
+
+		return output.substr(start, end + 5 - start);
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( compiler_rule_matcher_test )
+{
+	universe u;
+	parser P(u);
+	BOOST_CHECK( P.parse_ability_file("./example.ability") == true );
+
+	std::ostringstream oss;
+	u.dump_ability_import_module_impl(oss, "first");
+	std::string output = oss.str();
+
+	/* the reference output, compiled and run by test_logic_engine */
+	std::ifstream ifs("./example_rule_matchers.hh");
+	BOOST_CHECK( ifs );
+	std::string expected((std::istreambuf_iterator<char>(ifs)),
+						  std::istreambuf_iterator<char>());
+
+	const char* rules[] = { "distance_symetry", "less_false", "less_assoc" };
+	for (size_t i = 0; i < sizeof(rules) / sizeof(rules[0]); ++i) {
+		std::string matcher = generated_matcher(output, rules[i]);
+		BOOST_CHECK( !matcher.empty() );
+		BOOST_CHECK_MESSAGE( expected.find(matcher) != std::string::npos,
+							 "generated matcher for " << rules[i] << " changed :\n" << matcher );
+
+		/* and it is registered with the rule */
+		BOOST_CHECK( output.find(std::string("&match_") + rules[i]) != std::string::npos );
+	}
+}
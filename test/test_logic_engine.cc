@@ -1,9 +1,16 @@
 #include <logic/engine.hh>
 #include <logic/eval.hh>
+#include <logic/facts.hh>
 #include <boost/test/unit_test.hpp>
 #include <boost/assign/list_of.hpp>
 #include <boost/variant/apply_visitor.hpp>
 
+#include <cctype>
+#include <map>
+#include <sstream>
+
+#include "example_rule_matchers.hh"
+
 using namespace boost::logic;
 using namespace hyper::logic;
 
@@ -32,6 +39,7 @@ struct less
 		return boost::apply_visitor(is_less(), e1.expr, e2.expr);
 	}
 };
+
 }
 
 BOOST_AUTO_TEST_CASE ( logic_engine_test )
@@ -185,3 +193,155 @@ BOOST_AUTO_TEST_CASE ( logic_engine_test )
 	BOOST_CHECK(std::find(hyps.begin(), hyps.end(), r1.e) != hyps.end());
 }
 
+
+BOOST_AUTO_TEST_CASE ( logic_engine_stats_test )
+{
+	engine e;
+
+	BOOST_CHECK(e.add_type("int"));
+	BOOST_CHECK(e.add_predicate("less_int", 2, boost::assign::list_of("int")("int"), new eval<less, 2>()));
+	BOOST_CHECK(e.add_rule<std::string>("less_int_transitiviy", 
+						   boost::assign::list_of<std::string>("less_int(X, Y)")("less_int(Y,Z)"),
+						   boost::assign::list_of<std::string>("less_int(X, Z)")));
+
+	/* disabled by default */
+	BOOST_CHECK(!e.stats_enabled());
+	BOOST_CHECK(e.add_fact("less_int(x, y)"));
+	BOOST_CHECK(e.stats().add_fact_calls == 0);
+	BOOST_CHECK(e.stats().unify_attempts == 0);
+
+	e.enable_stats();
+	BOOST_CHECK(e.add_fact("less_int(y, z)"));
+	BOOST_CHECK(e.stats().add_fact_calls == 1);
+	BOOST_CHECK(e.stats().fixpoint_iterations >= 2);
+	BOOST_CHECK(e.stats().rules_fired >= 1);
+	BOOST_CHECK(e.stats().rules_tried >= e.stats().rules_fired);
+	BOOST_CHECK(e.stats().unify_attempts >= e.stats().unify_successes);
+	BOOST_CHECK(e.stats().unify_successes > 0);
+
+	boost::logic::tribool r = e.infer("less_int(x, z)");
+	BOOST_CHECK(r);
+	BOOST_CHECK(e.stats().infer_calls == 1);
+
+	/* z < 9 < 12 : proven by the first node of the transitivity rule */
+	BOOST_CHECK(e.add_fact("less_int(z, 9)"));
+	size_t nodes = e.stats().proof_nodes;
+	r = e.infer("less_int(z, 12)");
+	BOOST_CHECK(r);
+	BOOST_CHECK_EQUAL(e.stats().proof_nodes - nodes, 1u);
+
+	/* nothing is known about w : each candidate node is explored */
+	nodes = e.stats().proof_nodes;
+	size_t candidates = e.stats().candidates;
+	r = e.infer("less_int(x, w)");
+	BOOST_CHECK(boost::logic::indeterminate(r));
+	BOOST_CHECK(e.stats().proof_nodes - nodes > 1);
+	BOOST_CHECK(e.stats().candidates - candidates >= e.stats().proof_nodes - nodes);
+	BOOST_CHECK(e.stats().infer_calls == 3);
+
+	e.reset_stats();
+	BOOST_CHECK(e.stats().add_fact_calls == 0);
+	BOOST_CHECK(e.stats().infer_calls == 0);
+	BOOST_CHECK(e.stats().infer_time == boost::posix_time::time_duration());
+}
+
+namespace {
+	/*
+	 * Load the rules of the ability first of example.ability, with their
+	 * generated matchers if compiled is set, and some facts in e
+	 */
+	void load_example_rules(engine& e, bool compiled)
+	{
+		using namespace hyper::first;
+
+		BOOST_CHECK(e.add_type("int"));
+		BOOST_CHECK(e.add_type("double"));
+		BOOST_CHECK(e.add_type("point"));
+		BOOST_CHECK(e.add_predicate("less_int", 2, boost::assign::list_of("int")("int"), new eval<less, 2>()));
+		BOOST_CHECK(e.add_func("distance", 2, boost::assign::list_of("point")("point")("double")));
+
+		BOOST_CHECK(e.add_rule<std::string>("less_int_transitiviy", 
+							   boost::assign::list_of<std::string>("less_int(X, Y)")("less_int(Y,Z)"),
+							   boost::assign::list_of<std::string>("less_int(X, Z)"),
+							   compiled ? &match_less_assoc : 0));
+		BOOST_CHECK(e.add_rule<std::string>("less_int_false",
+							   boost::assign::list_of<std::string>("less_int(A, A)"),
+							   std::vector<std::string>(),
+							   compiled ? &match_less_false : 0));
+		BOOST_CHECK(e.add_rule<std::string>("distance_symmetry",
+							   boost::assign::list_of<std::string>("distance(A,B)"),
+							   boost::assign::list_of<std::string>("equal_double(distance(A,B), distance(B,A))"),
+							   compiled ? &match_distance_symetry : 0));
+
+		BOOST_CHECK(e.add_fact("less_int(x, y)"));
+		BOOST_CHECK(e.add_fact("less_int(y, z)"));
+		BOOST_CHECK(e.add_fact("less_int(z, 9)"));
+		BOOST_CHECK(e.add_fact("equal_double(distance(center, object), 3.0)"));
+	}
+
+	/*
+	 * The facts of the default context of e, with their logic variables
+	 * replaced by the name of the real variables, as the numbering of
+	 * logic variables depends on the engine
+	 */
+	std::vector<std::string> deduced_facts(const engine& e)
+	{
+		std::ostringstream oss;
+		oss << e;
+
+		std::map<std::string, std::string> names;
+		std::vector<std::string> res;
+		std::istringstream iss(oss.str());
+		std::string line;
+		while (std::getline(iss, line)) {
+			if (line.find("RULES") != std::string::npos)
+				break;
+
+			std::string::size_type pos = line.find(" <==> ");
+			if (pos != std::string::npos) {
+				std::string::size_type start = line.find("__L");
+				names[line.substr(start, pos - start)] = line.substr(pos + 6);
+			} else if (line.find('(') != std::string::npos &&
+					   line.find("logic variable") == std::string::npos) {
+				res.push_back(line);
+			}
+		}
+
+		for (size_t i = 0; i < res.size(); ++i) {
+			std::string& f = res[i];
+			std::string::size_type pos;
+			while ((pos = f.find("__L")) != std::string::npos) {
+				std::string::size_type end = pos + 3;
+				while (end < f.size() && isdigit(f[end]))
+					++end;
+				f.replace(pos, end - pos, names[f.substr(pos, end - pos)]);
+			}
+		}
+
+		std::sort(res.begin(), res.end());
+		return res;
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( logic_engine_matcher_test )
+{
+	engine e, generic;
+	load_example_rules(e, true);
+	load_example_rules(generic, false);
+
+	e.enable_stats();
+
+	/* inconsistent by deduction, through the compiled rules */
+	BOOST_CHECK(!e.add_fact("less_int(z, x)"));
+	BOOST_CHECK(!generic.add_fact("less_int(z, x)"));
+
+	/* both deduce the same facts */
+	std::vector<std::string> facts = deduced_facts(e);
+	BOOST_CHECK(std::find(facts.begin(), facts.end(), "less_int(x,9)") != facts.end());
+	BOOST_CHECK(facts == deduced_facts(generic));
+
+	BOOST_CHECK(e.infer("less_int(x, 9)"));
+	BOOST_CHECK(generic.infer("less_int(x, 9)"));
+
+	BOOST_CHECK(e.stats().rules_fired > 0);
+}
@@ -1,4 +1,5 @@
 #include <logic/expression.hh>
+#include <logic/generate_cache.hh>
 #include <boost/test/unit_test.hpp>
 
 #include <boost/optional/optional.hpp>
@@ -66,3 +67,52 @@ BOOST_AUTO_TEST_CASE ( logic_expression_test)
 	BOOST_CHECK(! (r3.e < r6.e));
 
 }
+
+BOOST_AUTO_TEST_CASE ( logic_generate_cache_test)
+{
+	using namespace hyper::logic;
+
+	funcDefList list;
+	list.add("equal", 2);
+	list.add("less", 2);
+
+	generate_cache& cache = list.cache();
+	BOOST_CHECK(cache.size() == 0);
+
+	generate_return r1 = generate("equal(x, y)", list);
+	BOOST_CHECK(r1.res);
+	BOOST_CHECK(cache.misses() == 1);
+	BOOST_CHECK(cache.hits() == 0);
+
+	generate_return r2 = generate("equal(x, y)", list);
+	BOOST_CHECK(r2.res);
+	BOOST_CHECK(cache.hits() == 1);
+	BOOST_CHECK(r1.e == r2.e);
+	BOOST_CHECK(r2.e.id == r1.e.id);
+
+	/* failures are not cached */
+	generate_return r3 = generate("pipo(x)", list);
+	BOOST_CHECK(!r3.res);
+	r3 = generate("pipo(x)", list);
+	BOOST_CHECK(!r3.res);
+	BOOST_CHECK(cache.size() == 1);
+
+	list.add("pipo", 1);
+	r3 = generate("pipo(x)", list);
+	BOOST_CHECK(r3.res);
+	BOOST_CHECK(cache.size() == 2);
+
+	/* LRU eviction */
+	cache.set_capacity(2);
+	generate("equal(x, y)", list);
+	generate("less(x, y)", list);
+	BOOST_CHECK(cache.size() == 2);
+	size_t misses = cache.misses();
+	generate("equal(x, y)", list);
+	BOOST_CHECK(cache.misses() == misses);
+	generate("pipo(x)", list);
+	BOOST_CHECK(cache.misses() == misses + 1);
+
+	cache.clear();
+	BOOST_CHECK(cache.size() == 0);
+}
@@ -58,9 +58,11 @@ namespace {
 		remote_values r_;
 		typedef hyper::model::remote_values<boost::mpl::vector<point, point, point> > remote_values_error;
 		remote_values_error r_error;
+		size_t nb_updates;
+		hyper::network::identifier watch_id;
 
 		proxy_test(pos_ability& pos, goal_ability & goal):
-			proxy(pos), pos(pos), goal(goal), valid_test(0),
+			proxy(pos), pos(pos), goal(goal), valid_test(0), nb_updates(0),
 			r_(remote_values::remote_vars_conf(boost::assign::list_of<std::pair<std::string, std::string> >
 					("goal", "x")
 					("goal", "P")
@@ -73,6 +75,34 @@ namespace {
 		{
 		};
 
+		void handle_variable_update()
+		{
+			nb_updates++;
+			switch (nb_updates) {
+				case 1:
+					// first push is the current value, then only changes are pushed
+					BOOST_CHECK(pos.subscriptions.confirmed(watch_id));
+					goal.x = 43;
+					break;
+				case 2:
+					// as if goal restarts : its watchers are woken up ...
+					pos.subscriptions.remove_agent("goal");
+					// ... and the subscription is sent again when it comes back
+					pos.subscriptions.add_agent("goal");
+					BOOST_CHECK(!pos.subscriptions.confirmed(watch_id));
+					break;
+				case 3:
+					BOOST_CHECK(!pos.subscriptions.confirmed(watch_id));
+					break;
+				default:
+					// the new subscription pushes the current value
+					BOOST_CHECK(pos.subscriptions.confirmed(watch_id));
+					pos.subscriptions.unwatch(watch_id);
+					BOOST_CHECK(pos.subscriptions.size() == 0);
+					valid_test++;
+			}
+		}
+
 		void handle_eight_test(const boost::system::error_code &e)
 		{
 			BOOST_CHECK(e);
@@ -85,6 +115,10 @@ namespace {
 			BOOST_CHECK((*r_error.at_c<0>()).y == 22.0);
 			BOOST_CHECK((*r_error.at_c<0>()).z == 33.0);
 			valid_test++;
+
+			watch_id = pos.subscriptions.watch("goal", "x", 5.0, 0.0,
+					boost::bind(&proxy_test::handle_variable_update, this));
+			BOOST_CHECK(!pos.subscriptions.confirmed(watch_id));
 		}
 
 		void handle_seventh_test(const boost::system::error_code& e)
@@ -115,6 +149,8 @@ namespace {
 		void handle_fifth_test(const boost::system::error_code& e)
 		{
 			BOOST_CHECK(!e);
+			/* both variables come from goal, so a single request */
+			BOOST_CHECK_EQUAL(r_.batches.size(), 1u);
 			BOOST_CHECK(r_.is_terminated() == true);
 			BOOST_CHECK(r_.at_c<0>());
 			BOOST_CHECK(r_.at_c<1>());
@@ -228,8 +264,9 @@ BOOST_AUTO_TEST_CASE ( model_proxy_test )
 	test.test_async();
 
 	// sleep a bit to be sure that everything happens
-	boost::this_thread::sleep(boost::posix_time::milliseconds(20)); 
-	BOOST_CHECK(test.valid_test == 8);
+	boost::this_thread::sleep(boost::posix_time::milliseconds(100)); 
+	BOOST_CHECK(test.valid_test == 9);
+	BOOST_CHECK(test.nb_updates == 4);
 
 	goal_.stop();
 	thr3.join();
@@ -0,0 +1,49 @@
+#include <model/remote_cache.hh>
+
+#include <boost/thread/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE ( model_remote_cache_test )
+{
+	using namespace hyper::model;
+	using namespace boost::posix_time;
+
+	remote_value_cache cache;
+
+	/* without lease, nothing is cached */
+	cache.put("pos", "x", "1");
+	BOOST_CHECK(!cache.get("pos", "x"));
+	BOOST_CHECK_EQUAL(cache.misses(), 0u);
+
+	cache.set_lease("pos", "x", milliseconds(50));
+	BOOST_CHECK(!cache.get("pos", "x"));
+	BOOST_CHECK_EQUAL(cache.misses(), 1u);
+
+	cache.put("pos", "x", "1");
+	BOOST_CHECK(cache.get("pos", "x"));
+	BOOST_CHECK_EQUAL(*cache.get("pos", "x"), "1");
+	BOOST_CHECK_EQUAL(cache.hits(), 2u);
+	BOOST_CHECK_CLOSE(cache.hit_rate(), 2.0 / 3.0, 0.01);
+
+	/* other variables of the same agent are not cached */
+	cache.put("pos", "y", "2");
+	BOOST_CHECK(!cache.get("pos", "y"));
+
+	/* the value expires with its lease */
+	boost::this_thread::sleep(milliseconds(100));
+	BOOST_CHECK(!cache.get("pos", "x"));
+	BOOST_CHECK_EQUAL(cache.misses(), 2u);
+
+	/* death of the agent invalidates its values, but keeps the lease */
+	cache.put("pos", "x", "3");
+	BOOST_CHECK(cache.get("pos", "x"));
+	cache.invalidate("pos");
+	BOOST_CHECK(!cache.get("pos", "x"));
+	cache.put("pos", "x", "4");
+	BOOST_CHECK_EQUAL(*cache.get("pos", "x"), "4");
+
+	/* a null lease disables the cache */
+	cache.set_lease("pos", "x", time_duration());
+	cache.put("pos", "x", "5");
+	BOOST_CHECK(!cache.get("pos", "x"));
+}
@@ -0,0 +1,82 @@
+#include <model/status_coalescer.hh>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace hyper;
+
+namespace {
+	void store(std::vector<network::request_constraint_answer>& sent,
+			   const network::request_constraint_answer& ans)
+	{
+		sent.push_back(ans);
+	}
+
+	network::request_constraint_answer make_status(const std::string& src, network::identifier id,
+												   network::request_constraint_answer::state_ s)
+	{
+		network::request_constraint_answer ans;
+		ans.src = src;
+		ans.id = id;
+		ans.state = s;
+		return ans;
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( model_status_coalescer_test )
+{
+	typedef network::request_constraint_answer answer;
+
+	boost::asio::io_service io_s;
+	std::vector<answer> sent;
+	model::status_coalescer coalescer(io_s, boost::bind(store, boost::ref(sent), _1));
+
+	/* a flapping constraint, only its last state is sent */
+	coalescer.push(make_status("a", 1, answer::RUNNING));
+	coalescer.push(make_status("b", 1, answer::RUNNING));
+	coalescer.push(make_status("a", 1, answer::TEMP_FAILURE));
+	coalescer.push(make_status("a", 1, answer::RUNNING));
+	BOOST_CHECK(sent.empty());
+	BOOST_CHECK_EQUAL(coalescer.size(), 2u);
+
+	io_s.run();
+	BOOST_REQUIRE_EQUAL(sent.size(), 2u);
+	BOOST_CHECK_EQUAL(sent[0].src, "a");
+	BOOST_CHECK_EQUAL(sent[0].state, answer::RUNNING);
+	BOOST_CHECK_EQUAL(sent[1].src, "b");
+	BOOST_CHECK_EQUAL(coalescer.coalesced(), 2u);
+
+	/* terminal states are always sent, in order */
+	sent.clear();
+	coalescer.push(make_status("a", 2, answer::RUNNING));
+	coalescer.push(make_status("a", 2, answer::SUCCESS));
+	coalescer.push(make_status("a", 3, answer::FAILURE));
+	coalescer.push(make_status("a", 2, answer::RUNNING));
+	io_s.reset();
+	io_s.run();
+	BOOST_REQUIRE_EQUAL(sent.size(), 4u);
+	BOOST_CHECK_EQUAL(sent[0].state, answer::RUNNING);
+	BOOST_CHECK_EQUAL(sent[1].state, answer::SUCCESS);
+	BOOST_CHECK_EQUAL(sent[2].id, 3u);
+	BOOST_CHECK_EQUAL(sent[3].state, answer::RUNNING);
+
+	/* updates for a dead agent are dropped */
+	sent.clear();
+	coalescer.push(make_status("a", 4, answer::RUNNING));
+	coalescer.push(make_status("b", 4, answer::RUNNING));
+	coalescer.invalidate("a");
+	coalescer.flush();
+	BOOST_REQUIRE_EQUAL(sent.size(), 1u);
+	BOOST_CHECK_EQUAL(sent[0].src, "b");
+
+	/* with a window, updates wait for its end */
+	sent.clear();
+	model::status_coalescer windowed(io_s, boost::bind(store, boost::ref(sent), _1),
+									 boost::posix_time::milliseconds(20));
+	windowed.push(make_status("a", 5, answer::RUNNING));
+	windowed.push(make_status("a", 5, answer::PAUSED));
+	io_s.reset();
+	io_s.run();
+	BOOST_REQUIRE_EQUAL(sent.size(), 1u);
+	BOOST_CHECK_EQUAL(sent[0].state, answer::PAUSED);
+}
@@ -0,0 +1,119 @@
+#include <model/abortable_function.hh>
+#include <model/worker_pool.hh>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace {
+	void compute(int& res, int x, boost::thread::id& where)
+	{
+		res = x * x;
+		where = boost::this_thread::get_id();
+	}
+
+	void handle_compute(int& res, int& sum, boost::thread::id& where)
+	{
+		sum += res;
+		where = boost::this_thread::get_id();
+	}
+
+	void failing_compute()
+	{
+		throw std::runtime_error("user function failure");
+	}
+
+	void store_error(boost::system::error_code& res, const boost::system::error_code& e)
+	{
+		res = e;
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( model_worker_pool_test )
+{
+	using namespace hyper::model;
+
+	boost::asio::io_service io_s;
+	boost::thread::id main_id = boost::this_thread::get_id();
+
+	/* without thread, everything is computed inline */
+	{
+		worker_pool pool;
+		int res = 0, sum = 0;
+		boost::thread::id job_id, handler_id;
+		pool.async_run(boost::bind(compute, boost::ref(res), 4, boost::ref(job_id)),
+					   boost::bind(handle_compute, boost::ref(res), boost::ref(sum), boost::ref(handler_id)),
+					   io_s);
+		BOOST_CHECK_EQUAL(sum, 16);
+		BOOST_CHECK(job_id == main_id);
+		BOOST_CHECK(handler_id == main_id);
+	}
+
+	/* with threads, jobs run outside, handlers in the io_service thread */
+	{
+		worker_pool pool;
+		pool.start(2);
+		BOOST_CHECK_EQUAL(pool.size(), 2u);
+
+		const int nb = 10;
+		int res[nb];
+		boost::thread::id job_id[nb], handler_id[nb];
+		int sum = 0;
+		for (int i = 0; i < nb; ++i)
+			pool.async_run(boost::bind(compute, boost::ref(res[i]), i, boost::ref(job_id[i])),
+						   boost::bind(handle_compute, boost::ref(res[i]), boost::ref(sum),
+									   boost::ref(handler_id[i])),
+						   io_s);
+
+		/* run() only returns when all handlers have been posted back */
+		io_s.reset();
+		io_s.run();
+
+		BOOST_CHECK_EQUAL(sum, 285);
+		for (int i = 0; i < nb; ++i) {
+			BOOST_CHECK(job_id[i] != main_id);
+			BOOST_CHECK(handler_id[i] == main_id);
+		}
+
+		pool.stop();
+		BOOST_CHECK_EQUAL(pool.size(), 0u);
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( model_worker_pool_exception_test )
+{
+	using namespace hyper::model;
+
+	boost::asio::io_service io_s;
+	boost::system::error_code expected = make_error_code(exec_layer_error::execution_failed);
+
+	/* inline */
+	{
+		worker_pool pool;
+		boost::system::error_code err;
+		pool.async_run(failing_compute, boost::bind(store_error, boost::ref(err), _1), io_s);
+		BOOST_CHECK(err == expected);
+	}
+
+	/* on a worker thread, the pool survives the exception */
+	{
+		worker_pool pool;
+		pool.start(1);
+
+		boost::system::error_code err, ok_err = expected;
+		int res = 0;
+		boost::thread::id job_id;
+		pool.async_run(failing_compute, boost::bind(store_error, boost::ref(err), _1), io_s);
+		pool.async_run(boost::bind(compute, boost::ref(res), 3, boost::ref(job_id)),
+					   boost::bind(store_error, boost::ref(ok_err), _1), io_s);
+
+		io_s.reset();
+		io_s.run();
+
+		BOOST_CHECK(err == expected);
+		BOOST_CHECK(!ok_err);
+		BOOST_CHECK_EQUAL(res, 9);
+
+		pool.stop();
+	}
+}
@@ -1,4 +1,5 @@
 #include <network/actor_protocol.hh>
+#include <network/compression.hh>
 #include <network/msg.hh>
 #include <network/log.hh>
 #include <boost/test/unit_test.hpp>
@@ -35,6 +36,8 @@ namespace {
 			}
 			handler(boost::system::error_code());
 		}
+
+		void invalidate(const std::string&) {}
 	};
 
 	struct simple_agent {
@@ -48,6 +51,8 @@ namespace {
 		simple_agent() : logger(io_s, name, "logger", name_client, NOTHING) {}
 
 		size_t gen_identifier() { return identifier++; }
+
+		bool log_enabled(int level) const { return logger.enabled(level); }
 	};
 
 	typedef hyper::network::tcp::server<input_client, output_client, actor_protocol_visitor<simple_agent>		>
@@ -145,3 +150,165 @@ BOOST_AUTO_TEST_CASE ( network_actor_protocol_test )
 
 	BOOST_CHECK(client.count_valid_test == 1);
 }
+
+namespace {
+	/* Read the header of the next message on @s, skip its payload, and return its type */
+	uint32_t read_raw_message(boost::asio::ip::tcp::socket& s)
+	{
+		char buf[header_length];
+		boost::asio::read(s, boost::asio::buffer(buf));
+		header head = decode_header(buf);
+		std::vector<char> payload(head.size);
+		if (!payload.empty())
+			boost::asio::read(s, boost::asio::buffer(payload));
+		return head.type;
+	}
+
+	/* Listen on the address of the agent "server" */
+	void listen_as_server(boost::asio::ip::tcp::acceptor& acceptor)
+	{
+		using boost::asio::ip::tcp;
+		tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 5001);
+		acceptor.open(endpoint.protocol());
+		acceptor.set_option(tcp::acceptor::reuse_address(true));
+		acceptor.bind(endpoint);
+		acceptor.listen();
+	}
+
+	struct set_flag {
+		bool& flag;
+		set_flag(bool& flag_) : flag(flag_) {}
+
+		void operator() (const boost::system::error_code& e, size_t = 0) const
+		{
+			BOOST_CHECK(!e);
+			flag = true;
+		}
+	};
+}
+
+BOOST_AUTO_TEST_CASE ( network_actor_protocol_compression_test )
+{
+	using boost::asio::ip::tcp;
+
+	/* a bare server, which advertises compression, and reads the wire */
+	boost::asio::io_service io_peer;
+	tcp::acceptor acceptor(io_peer);
+	listen_as_server(acceptor);
+
+	simple_agent agent;
+	agent.name = "client";
+	actor_client<simple_agent> client(agent, "server");
+
+	variable_value small, big;
+	small.var_name = "small";
+	small.success = false;
+	big.var_name = "cloud";
+	big.success = true;
+	big.value = std::string(100000, 'a');
+
+	/* the client writes before knowing the peer accepts compression */
+	bool written = false;
+	client.async_write(small, set_flag(written));
+	while (!written)
+		agent.io_s.run_one();
+
+	hyper::network::tcp::serialized_socket<input_serv> peer(io_peer);
+	acceptor.accept(peer.socket());
+	bool hello_written = false;
+	peer.async_write_hello(set_flag(hello_written));
+	io_peer.run();
+	/* without zlib, there is nothing to advertise */
+	BOOST_CHECK(hello_written == compression_available());
+
+	BOOST_CHECK((read_raw_message(peer.socket()) & header_compressed) == 0);
+
+	/* read the hello */
+	if (hello_written)
+		agent.io_s.run_one();
+
+	written = false;
+	agent.io_s.reset();
+	client.async_write(big, set_flag(written));
+	while (!written)
+		agent.io_s.run_one();
+
+	uint32_t type = read_raw_message(peer.socket());
+	BOOST_CHECK((type & header_type_mask) != header_hello);
+	if (compression_available())
+		BOOST_CHECK(type & header_compressed);
+
+	client.close();
+}
+
+namespace {
+	struct deadline_agent {
+		size_t identifier;
+		std::string name;
+		boost::asio::io_service io_s;
+		false_resolv name_client;
+		callback_database<input_client> db;
+		hyper::network::logger<false_resolv> logger;
+
+		deadline_agent() : identifier(0), db(io_s, boost::posix_time::milliseconds(10)),
+						   logger(io_s, name, "logger", name_client, NOTHING) {}
+
+		size_t gen_identifier() { return identifier++; }
+
+		bool log_enabled(int level) const { return logger.enabled(level); }
+	};
+
+	void handle_timed_request(const boost::system::error_code& e, identifier,
+							  std::vector<boost::system::error_code>& errors)
+	{
+		errors.push_back(e);
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( network_actor_protocol_timeout_test )
+{
+	using boost::asio::ip::tcp;
+
+	/* a bare server, which never answers */
+	boost::asio::io_service io_peer;
+	tcp::acceptor acceptor(io_peer);
+	listen_as_server(acceptor);
+
+	deadline_agent agent;
+	agent.name = "client";
+	agent.identifier = 42;
+	actor_client<deadline_agent> client(agent, "server");
+
+	request_constraint req;
+	req.constraint = "test";
+	req.repeat = false;
+	req.delay = 0.0;
+	request_constraint_answer ans;
+	std::vector<boost::system::error_code> errors;
+	client.async_request(req, ans,
+			boost::bind(handle_timed_request, _1, _2, boost::ref(errors)),
+			boost::posix_time::milliseconds(30));
+
+	boost::asio::io_service::work work(agent.io_s);
+	boost::thread thr(boost::bind(& boost::asio::io_service::run, &agent.io_s));
+
+	typedef boost::mpl::vector<request_constraint, hyper::network::abort> peer_input;
+	hyper::network::tcp::serialized_socket<peer_input> peer(io_peer);
+	acceptor.accept(peer.socket());
+
+	request_constraint received;
+	peer.sync_read(received);
+	BOOST_CHECK_EQUAL(received.id, 42u);
+
+	/* once the deadline has expired, the request is aborted on the peer */
+	hyper::network::abort ab;
+	peer.sync_read(ab);
+	BOOST_CHECK_EQUAL(ab.id, 42u);
+	BOOST_CHECK_EQUAL(ab.src, "client");
+
+	agent.io_s.stop();
+	thr.join();
+
+	BOOST_REQUIRE_EQUAL(errors.size(), 1u);
+	BOOST_CHECK(errors[0] == make_error_code(protocol_error::request_timeout));
+}
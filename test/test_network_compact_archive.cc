@@ -0,0 +1,165 @@
+#include <network/compact_archive.hh>
+#include <network/msg.hh>
+#include <boost/test/unit_test.hpp>
+#include <boost/optional.hpp>
+#include <boost/serialization/optional.hpp>
+#include <boost/serialization/vector.hpp>
+
+namespace {
+	struct pipo {
+		int dummy;
+		double my_d;
+		std::string name;
+		std::vector<unsigned int> values;
+
+		private:
+			friend class boost::serialization::access;
+			template<class Archive>
+			void serialize(Archive & ar, const unsigned int version)
+			{
+				(void) version;
+				ar & BOOST_SERIALIZATION_NVP(dummy) & BOOST_SERIALIZATION_NVP(my_d)
+				   & BOOST_SERIALIZATION_NVP(name) & BOOST_SERIALIZATION_NVP(values);
+			}
+	};
+
+	bool operator == (const pipo& p1, const pipo& p2)
+	{
+		return p1.dummy == p2.dummy && p1.my_d == p2.my_d && p1.name == p2.name &&
+			   p1.values == p2.values;
+	}
+
+	template <typename T>
+	std::string encode(const T& src)
+	{
+		std::ostringstream oss;
+		hyper::network::compact_oarchive oa(oss);
+		oa << src;
+		return oss.str();
+	}
+
+	template <typename T>
+	T decode(const std::string& input)
+	{
+		T value;
+		std::istringstream iss(input);
+		hyper::network::compact_iarchive ia(iss);
+		ia >> value;
+		return value;
+	}
+
+	template <typename T>
+	void try_compact_archive(const T& src)
+	{
+		BOOST_CHECK(decode<T>(encode(src)) == src);
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( network_compact_archive_test )
+{
+	using namespace hyper::network;
+
+	try_compact_archive(true);
+	try_compact_archive(false);
+	try_compact_archive(0);
+	try_compact_archive(-1);
+	try_compact_archive(42);
+	try_compact_archive(-123456789);
+	try_compact_archive(std::numeric_limits<int>::max());
+	try_compact_archive(std::numeric_limits<int>::min());
+	try_compact_archive(std::numeric_limits<boost::uint64_t>::max());
+	try_compact_archive(33.15);
+	try_compact_archive(-77.17f);
+	try_compact_archive(std::string(""));
+	try_compact_archive(std::string("pipo"));
+
+	/* version byte + 1 byte per small value */
+	BOOST_CHECK_EQUAL(encode(true).size(), 2u);
+	BOOST_CHECK_EQUAL(encode(42).size(), 2u);
+	BOOST_CHECK_EQUAL(encode(-42).size(), 2u);
+	BOOST_CHECK_EQUAL(encode(300u).size(), 3u);
+	BOOST_CHECK_EQUAL(encode(1.0).size(), 9u);
+	BOOST_CHECK_EQUAL(encode(std::string("pipo")).size(), 6u);
+
+	/* doubles are little-endian */
+	std::string one = encode(1.0);
+	BOOST_CHECK_EQUAL(static_cast<unsigned char>(one[8]), 0x3fu);
+	BOOST_CHECK_EQUAL(static_cast<unsigned char>(one[7]), 0xf0u);
+
+	pipo p;
+	p.dummy = -42;
+	p.my_d = 3.1415;
+	p.name = "cnrs";
+	p.values.push_back(1);
+	p.values.push_back(1000000);
+	try_compact_archive(p);
+
+	boost::optional<double> od = boost::none;
+	try_compact_archive(od);
+	od = 1.618;
+	try_compact_archive(od);
+
+	request_name_answer rna1;
+	rna1.name = "myAbility";
+	rna1.success = true;
+	rna1.endpoints.push_back(boost::asio::ip::tcp::endpoint(
+							 boost::asio::ip::address::from_string("127.0.0.1"), 4242));
+	request_name_answer rna2 = decode<request_name_answer>(encode(rna1));
+	BOOST_CHECK(rna1.name == rna2.name);
+	BOOST_CHECK(rna1.success == rna2.success);
+	BOOST_CHECK(rna1.endpoints == rna2.endpoints);
+
+	request_constraint2 ctr1;
+	ctr1.id = 42;
+	ctr1.src = "pipo";
+	ctr1.constraint = hyper::logic::function_call("add_double",
+								hyper::logic::expression(hyper::logic::Constant<double>(2.0)),
+								hyper::logic::function_call("distance", std::string("goal"),
+																		std::string("current")));
+	ctr1.repeat = true;
+	ctr1.unify_list.push_back(std::make_pair(std::string("pipo"), std::string("toto")));
+	request_constraint2 ctr2 = decode<request_constraint2>(encode(ctr1));
+	BOOST_CHECK(ctr1.id == ctr2.id);
+	BOOST_CHECK(ctr1.src == ctr2.src);
+	BOOST_CHECK(ctr1.repeat == ctr2.repeat);
+	std::ostringstream oss1, oss2;
+	oss1 << ctr1.constraint;
+	oss2 << ctr2.constraint;
+	BOOST_CHECK(oss1.str() == oss2.str());
+
+	log_msg l1("pipo", "some message");
+	log_msg l2 = decode<log_msg>(encode(l1));
+	BOOST_CHECK(l1.date == l2.date);
+	BOOST_CHECK(l1.src == l2.src);
+	BOOST_CHECK(l1.msg == l2.msg);
+
+	log_msgs ls1;
+	ls1.src = "pipo";
+	ls1.lines.push_back(log_msgs::line("first line"));
+	ls1.lines.push_back(log_msgs::line("second line"));
+	log_msgs ls2 = decode<log_msgs>(encode(ls1));
+	BOOST_CHECK(ls1.src == ls2.src);
+	BOOST_REQUIRE_EQUAL(ls2.lines.size(), 2u);
+	BOOST_CHECK(ls1.lines[1].date == ls2.lines[1].date);
+	BOOST_CHECK(ls1.lines[1].stamp == ls2.lines[1].stamp);
+	BOOST_CHECK(ls1.lines[1].msg == ls2.lines[1].msg);
+
+	/* truncated input, wrong version, out of range value */
+	std::string s = encode(p);
+	BOOST_CHECK_THROW(decode<pipo>(s.substr(0, s.size() - 1)), boost::archive::archive_exception);
+	s[0] = compact_archive_version + 1;
+	BOOST_CHECK_THROW(decode<pipo>(s), boost::archive::archive_exception);
+	BOOST_CHECK_THROW(decode<unsigned short>(encode(100000u)), boost::archive::archive_exception);
+	BOOST_CHECK_THROW(decode<short>(encode(100000)), boost::archive::archive_exception);
+
+	/* lengths beyond the input, 2^40 here, are refused before any allocation */
+	std::string huge_string("\x01\x80\x80\x80\x80\x80\x20" "abc", 10);
+	BOOST_CHECK_THROW(decode<std::string>(huge_string), boost::archive::archive_exception);
+	std::string huge_vector("\x01\x80\x80\x80\x80\x80\x20\x00\x01", 9);
+	BOOST_CHECK_THROW(decode<std::vector<unsigned int> >(huge_vector), boost::archive::archive_exception);
+	s = encode(std::string("abc"));
+	s[1] = 4;
+	BOOST_CHECK_THROW(decode<std::string>(s), boost::archive::archive_exception);
+	BOOST_CHECK_EQUAL(decode<std::string>(encode(std::string("abc"))), "abc");
+	BOOST_CHECK(decode<std::vector<unsigned int> >(encode(std::vector<unsigned int>())).empty());
+}
@@ -0,0 +1,48 @@
+#include <network/failure_detector.hh>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace hyper::network;
+using namespace boost::posix_time;
+
+BOOST_AUTO_TEST_CASE ( network_failure_detector_test )
+{
+	ptime t0(boost::gregorian::date(2011, 1, 1));
+	phi_accrual_detector detector(8.0, 100, milliseconds(10), milliseconds(500));
+
+	BOOST_CHECK_EQUAL(detector.phi("a", t0), 0.0);
+
+	/* a regular agent, every 100ms */
+	ptime t = t0;
+	for (int i = 0; i < 50; ++i) {
+		detector.heartbeat("a", t);
+		t += milliseconds(100);
+	}
+	ptime last = t - milliseconds(100);
+
+	BOOST_CHECK(detector.is_available("a", last + milliseconds(100)));
+	BOOST_CHECK(detector.phi("a", last + milliseconds(100)) < 1.0);
+	BOOST_CHECK(!detector.is_available("a", last + milliseconds(500)));
+
+	/* phi grows with the silence */
+	BOOST_CHECK(detector.phi("a", last + milliseconds(150)) <
+				detector.phi("a", last + milliseconds(200)));
+
+	/* phi reaches the threshold after suspicion_delay */
+	time_duration delay = detector.suspicion_delay("a");
+	BOOST_CHECK(delay > milliseconds(100));
+	BOOST_CHECK(delay < milliseconds(500));
+	BOOST_CHECK(detector.is_available("a", last + delay - milliseconds(5)));
+	BOOST_CHECK(!detector.is_available("a", last + delay + milliseconds(5)));
+
+	/* a jittery agent is suspected later than a regular one */
+	t = t0;
+	for (int i = 0; i < 50; ++i) {
+		detector.heartbeat("b", t);
+		t += milliseconds(i % 2 ? 50 : 150);
+	}
+	BOOST_CHECK(detector.suspicion_delay("b") > delay);
+
+	detector.remove("a");
+	BOOST_CHECK_EQUAL(detector.phi("a", last + seconds(10)), 0.0);
+}
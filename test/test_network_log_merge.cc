@@ -0,0 +1,252 @@
+#include <network/log_merge.hh>
+#include <network/log_store.hh>
+
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace hyper::network;
+using namespace boost::posix_time;
+
+namespace {
+	void output(std::vector<log_msg>& out, const log_msg& msg)
+	{
+		out.push_back(msg);
+	}
+
+	log_msg make_msg(const std::string& src, const std::string& txt, ptime date)
+	{
+		log_msg msg(src, txt);
+		msg.date = date;
+		msg.stamp = hlc_timestamp(date);
+		return msg;
+	}
+
+	size_t file_size(const std::string& path)
+	{
+		struct stat st;
+		if (::stat(path.c_str(), &st) < 0)
+			return 0;
+		return st.st_size;
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( network_hybrid_clock_test )
+{
+	hybrid_clock& clock = hybrid_clock::instance();
+
+	hlc_timestamp t1 = clock.now();
+	hlc_timestamp t2 = clock.now();
+	BOOST_CHECK(t1 < t2);
+
+	/* a message from an agent whose clock is ten seconds ahead */
+	hlc_timestamp remote(microsec_clock::universal_time() + seconds(10), 3);
+	clock.update(remote);
+	hlc_timestamp t3 = clock.now();
+	BOOST_CHECK(remote < t3);
+	BOOST_CHECK_EQUAL(t3.physical, remote.physical);
+
+	/* a late message doesn't move the clock back */
+	clock.update(t1);
+	BOOST_CHECK(t3 < clock.now());
+
+	/* a clock far in the future is beyond the max offset, and ignored */
+	hlc_timestamp t4 = clock.now();
+	hlc_timestamp future(microsec_clock::universal_time() + hours(24 * 365), 0);
+	clock.update(future);
+	hlc_timestamp t5 = clock.now();
+	BOOST_CHECK(t4 < t5);
+	BOOST_CHECK(t5.physical < future.physical - hours(24).total_microseconds());
+
+	/* the max offset can be tightened */
+	clock.set_max_offset(seconds(1));
+	hlc_timestamp ahead(microsec_clock::universal_time() + seconds(30), 0);
+	clock.update(ahead);
+	BOOST_CHECK(clock.now() < ahead);
+	clock.set_max_offset(minutes(1));
+}
+
+BOOST_AUTO_TEST_CASE ( network_log_merge_test )
+{
+	ptime t0(boost::gregorian::date(2011, 1, 1));
+	std::vector<log_msg> out;
+	log_merger merger(boost::bind(output, boost::ref(out), _1), seconds(1));
+
+	merger.push(make_msg("a", "a1", t0 + milliseconds(10)));
+	merger.push(make_msg("b", "b1", t0 + milliseconds(5)));
+	merger.push(make_msg("a", "a2", t0 + milliseconds(30)));
+
+	/* b may still send something older than a1 */
+	merger.flush(t0 + milliseconds(50));
+	BOOST_REQUIRE_EQUAL(out.size(), 1u);
+	BOOST_CHECK_EQUAL(out[0].msg, "b1");
+	BOOST_CHECK_EQUAL(merger.size(), 2u);
+
+	merger.push(make_msg("b", "b2", t0 + milliseconds(20)));
+	merger.push(make_msg("b", "b3", t0 + milliseconds(40)));
+	merger.flush(t0 + milliseconds(50));
+	BOOST_REQUIRE_EQUAL(out.size(), 4u);
+	BOOST_CHECK_EQUAL(out[1].msg, "a1");
+	BOOST_CHECK_EQUAL(out[2].msg, "b2");
+	BOOST_CHECK_EQUAL(out[3].msg, "a2");
+
+	/* a silent agent only holds the others for max_delay */
+	merger.flush(t0 + milliseconds(500));
+	BOOST_CHECK_EQUAL(out.size(), 4u);
+	merger.flush(t0 + milliseconds(1040));
+	BOOST_REQUIRE_EQUAL(out.size(), 5u);
+	BOOST_CHECK_EQUAL(out[4].msg, "b3");
+
+	/* a dead agent doesn't hold the others at all */
+	merger.push(make_msg("a", "a3", t0 + milliseconds(1100)));
+	merger.push(make_msg("b", "b4", t0 + milliseconds(1200)));
+	merger.remove_source("a");
+	merger.flush(t0 + milliseconds(1200));
+	BOOST_REQUIRE_EQUAL(out.size(), 7u);
+	BOOST_CHECK_EQUAL(out[5].msg, "a3");
+	BOOST_CHECK_EQUAL(out[6].msg, "b4");
+	BOOST_CHECK_EQUAL(merger.size(), 0u);
+
+	/*
+	 * c's wall clock is late, but its message answers b5, so its
+	 * timestamp follows b5 and not its date
+	 */
+	log_msg b5 = make_msg("b", "b5", t0 + milliseconds(1300));
+	log_msg c1 = make_msg("c", "c1", t0 + milliseconds(1250));
+	c1.stamp = hlc_timestamp(b5.stamp.physical, b5.stamp.logical + 1);
+	merger.push(c1);
+	merger.push(b5);
+	merger.push(make_msg("b", "b6", t0 + milliseconds(1400)));
+	merger.push(make_msg("c", "c2", t0 + milliseconds(1400)));
+	merger.flush(t0 + milliseconds(1400));
+	BOOST_REQUIRE_EQUAL(out.size(), 11u);
+	BOOST_CHECK_EQUAL(out[7].msg, "b5");
+	BOOST_CHECK_EQUAL(out[8].msg, "c1");
+}
+
+BOOST_AUTO_TEST_CASE ( network_log_store_test )
+{
+	ptime t0(boost::gregorian::date(2011, 1, 1));
+	std::string path = "test_log_store_" + boost::lexical_cast<std::string>(::getpid());
+
+	{
+		log_store_writer writer(path);
+		writer.append(make_msg("a", "start", t0));
+		writer.append(make_msg("b", "start", t0 + seconds(1)));
+		writer.append(make_msg("a", "error 42", t0 + seconds(2)));
+	}
+
+	/* reopening appends to the existing store */
+	{
+		log_store_writer writer(path);
+		writer.append(make_msg("b", "error 43", t0 + seconds(3)));
+		writer.append(make_msg("c", "stop", t0 + seconds(4)));
+	}
+
+	{
+		log_store_reader reader(path);
+		BOOST_CHECK_EQUAL(reader.size(), 5u);
+
+		std::vector<log_msg> out;
+		log_query q;
+		BOOST_CHECK_EQUAL(reader.query(q, boost::bind(output, boost::ref(out), _1)), 5u);
+		BOOST_REQUIRE_EQUAL(out.size(), 5u);
+		BOOST_CHECK_EQUAL(out[3].src, "b");
+		BOOST_CHECK_EQUAL(out[3].msg, "error 43");
+		BOOST_CHECK(out[3].date == t0 + seconds(3));
+
+		out.clear();
+		q.since = t0 + seconds(1);
+		q.until = t0 + seconds(3);
+		BOOST_CHECK_EQUAL(reader.query(q, boost::bind(output, boost::ref(out), _1)), 3u);
+
+		out.clear();
+		q.agent = "b";
+		BOOST_CHECK_EQUAL(reader.query(q, boost::bind(output, boost::ref(out), _1)), 2u);
+
+		/* the index of an agent only holds its own records */
+		out.clear();
+		q.agent = "a";
+		BOOST_REQUIRE_EQUAL(reader.query(q, boost::bind(output, boost::ref(out), _1)), 1u);
+		BOOST_CHECK_EQUAL(out[0].msg, "error 42");
+		BOOST_CHECK(out[0].date == t0 + seconds(2));
+		BOOST_CHECK_EQUAL(file_size(path + ".idx.0"), 2 * sizeof(log_index_entry));
+		BOOST_CHECK_EQUAL(file_size(path + ".idx.1"), 2 * sizeof(log_index_entry));
+		BOOST_CHECK_EQUAL(file_size(path + ".idx.2"), sizeof(log_index_entry));
+
+		out.clear();
+		q.agent = "b";
+
+		out.clear();
+		q.grep = "error [0-9]+";
+		BOOST_REQUIRE_EQUAL(reader.query(q, boost::bind(output, boost::ref(out), _1)), 1u);
+		BOOST_CHECK_EQUAL(out[0].msg, "error 43");
+
+		q.agent = "unknown";
+		BOOST_CHECK_EQUAL(reader.query(q, boost::bind(output, boost::ref(out), _1)), 0u);
+	}
+
+	std::remove(path.c_str());
+	std::remove((path + ".idx").c_str());
+	std::remove((path + ".agents").c_str());
+	for (int i = 0; i < 3; ++i)
+		std::remove((path + ".idx." + boost::lexical_cast<std::string>(i)).c_str());
+}
+
+BOOST_AUTO_TEST_CASE ( network_log_store_late_test )
+{
+	ptime t0(boost::gregorian::date(2011, 1, 1));
+	std::string path = "test_log_store_late_" + boost::lexical_cast<std::string>(::getpid());
+
+	{
+		log_store_writer writer(path);
+		writer.append(make_msg("a", "1", t0 + seconds(1)));
+		writer.append(make_msg("b", "3", t0 + seconds(3)));
+	}
+	BOOST_CHECK(::access((path + ".unsorted").c_str(), F_OK) != 0);
+
+	/* after a reopening, a late message is older than the last record */
+	{
+		log_store_writer writer(path);
+		writer.append(make_msg("a", "4", t0 + seconds(4)));
+		writer.append(make_msg("a", "2", t0 + seconds(2)));
+		writer.append(make_msg("b", "5", t0 + seconds(5)));
+	}
+	BOOST_CHECK(::access((path + ".unsorted").c_str(), F_OK) == 0);
+
+	{
+		log_store_reader reader(path);
+
+		std::vector<log_msg> out;
+		log_query q;
+		q.since = t0 + seconds(2);
+		q.until = t0 + seconds(4);
+		BOOST_REQUIRE_EQUAL(reader.query(q, boost::bind(output, boost::ref(out), _1)), 3u);
+		BOOST_CHECK_EQUAL(out[0].msg, "2");
+		BOOST_CHECK_EQUAL(out[1].msg, "3");
+		BOOST_CHECK_EQUAL(out[2].msg, "4");
+
+		out.clear();
+		q.agent = "a";
+		BOOST_REQUIRE_EQUAL(reader.query(q, boost::bind(output, boost::ref(out), _1)), 2u);
+		BOOST_CHECK_EQUAL(out[0].msg, "2");
+		BOOST_CHECK_EQUAL(out[1].msg, "4");
+
+		out.clear();
+		q.since = ptime();
+		BOOST_REQUIRE_EQUAL(reader.query(q, boost::bind(output, boost::ref(out), _1)), 3u);
+		BOOST_CHECK_EQUAL(out[0].msg, "1");
+	}
+
+	std::remove(path.c_str());
+	std::remove((path + ".idx").c_str());
+	std::remove((path + ".agents").c_str());
+	std::remove((path + ".unsorted").c_str());
+	for (int i = 0; i < 2; ++i)
+		std::remove((path + ".idx." + boost::lexical_cast<std::string>(i)).c_str());
+}
@@ -10,7 +10,7 @@ namespace {
 		void operator () (const boost::system::error_code&) {}
 	};
 
-	typedef boost::mpl::vector<hyper::network::log_msg> input_msg;
+	typedef boost::mpl::vector<hyper::network::log_msgs> input_msg;
 	typedef boost::mpl::vector<boost::mpl::void_> output_msg;
 
 	typedef boost::make_variant_over<input_msg>::type input_variant;
@@ -19,12 +19,22 @@ namespace {
 	struct logger_visitor : public boost::static_visitor<output_variant>
 	{
 		std::vector<std::string> & log_msgs_;
+		std::vector<hyper::network::log_msgs::line> & lines_;
 
-		logger_visitor(std::vector<std::string>& log_msgs): log_msgs_(log_msgs) {}
+		logger_visitor(std::vector<std::string>& log_msgs,
+					   std::vector<hyper::network::log_msgs::line>& lines):
+			log_msgs_(log_msgs), lines_(lines) {}
 
-		output_variant operator() (const hyper::network::log_msg& msg) const
+		/* keep each batch as one string, its lines separated by '\n' */
+		output_variant operator() (const hyper::network::log_msgs& msgs) const
 		{
-			log_msgs_.push_back(msg.msg);
+			std::string s;
+			for (size_t i = 0; i < msgs.lines.size(); ++i) {
+				if (i > 0) s += "\n";
+				s += msgs.lines[i].msg;
+				lines_.push_back(msgs.lines[i]);
+			}
+			log_msgs_.push_back(s);
 			return boost::mpl::void_();
 		}
 	};
@@ -51,7 +61,8 @@ BOOST_AUTO_TEST_CASE ( network_logger_test )
 
 	boost::asio::io_service io_s;
 	std::vector<std::string> res;
-	logger_visitor vis(res);
+	std::vector<hyper::network::log_msgs::line> lines;
+	logger_visitor vis(res, lines);
 	logger_server serv("127.0.0.1", "4242", vis, io_s);
 	boost::thread thr( boost::bind(& boost::asio::io_service::run, &io_s));
 
@@ -59,14 +70,14 @@ BOOST_AUTO_TEST_CASE ( network_logger_test )
 	false_resolv solver;
 
 	boost::asio::deadline_timer deadline_(io_s2);
-	deadline_.expires_from_now(boost::posix_time::milliseconds(10));
+	deadline_.expires_from_now(boost::posix_time::milliseconds(150));
 	deadline_.async_wait(do_nothing());
 	hyper::network::async_logger<false_resolv> logger_(io_s2, "test", "logger", solver);
 	logger_.log("first message");
 	io_s2.run();
 	io_s2.reset();
 
-	deadline_.expires_from_now(boost::posix_time::milliseconds(10));
+	deadline_.expires_from_now(boost::posix_time::milliseconds(150));
 	deadline_.async_wait(do_nothing());
 	logger_.log("second message");
 	io_s2.run();
@@ -81,25 +92,25 @@ BOOST_AUTO_TEST_CASE ( network_logger_test )
 
 	hyper::network::logger<false_resolv> real_logger_(io_s2, "test", "logger", 
 													   solver, INFORMATION);
-	deadline_.expires_from_now(boost::posix_time::milliseconds(10));
+	deadline_.expires_from_now(boost::posix_time::milliseconds(150));
 	deadline_.async_wait(do_nothing());
 	real_logger_(CRITICAL) << "first message" << std::endl;
 	io_s2.run();
 	io_s2.reset();
 
-	deadline_.expires_from_now(boost::posix_time::milliseconds(10));
+	deadline_.expires_from_now(boost::posix_time::milliseconds(150));
 	deadline_.async_wait(do_nothing());
 	real_logger_(INFORMATION) << "second message" << std::endl;
 	io_s2.run();
 	io_s2.reset();
 
-	deadline_.expires_from_now(boost::posix_time::milliseconds(10));
+	deadline_.expires_from_now(boost::posix_time::milliseconds(150));
 	deadline_.async_wait(do_nothing());
 	real_logger_(DEBUG) << "third message" << std::endl;
 	io_s2.run();
 	io_s2.reset();
 
-	deadline_.expires_from_now(boost::posix_time::milliseconds(10));
+	deadline_.expires_from_now(boost::posix_time::milliseconds(150));
 	deadline_.async_wait(do_nothing());
 	real_logger_(INFORMATION) << "fourth message" << std::endl;
 	io_s2.run();
@@ -108,6 +119,118 @@ BOOST_AUTO_TEST_CASE ( network_logger_test )
 	expected.push_back("fourth message");
 	BOOST_CHECK(res == expected);
 
+	/* a pending line keeps its level, and is not merged with the next one */
+	deadline_.expires_from_now(boost::posix_time::milliseconds(150));
+	deadline_.async_wait(do_nothing());
+	real_logger_(ERROR) << "fifth";
+	real_logger_(INFORMATION) << "sixth message" << std::endl;
+	io_s2.run();
+	io_s2.reset();
+
+	expected.push_back("fifth\nsixth message");
+	BOOST_CHECK(res == expected);
+
+	/* lines logged in the same window are sent as one message */
+	res.clear();
+	lines.clear();
+	hyper::network::async_logger<false_resolv> batch_logger(io_s2, "test", "logger", solver,
+			3, 100, boost::posix_time::milliseconds(20), hyper::network::drop_by_level);
+	deadline_.expires_from_now(boost::posix_time::milliseconds(50));
+	deadline_.async_wait(do_nothing());
+	batch_logger.log("first line");
+	boost::this_thread::sleep(boost::posix_time::milliseconds(30));
+	batch_logger.log("second line\n");
+	io_s2.run();
+	io_s2.reset();
+
+	BOOST_REQUIRE_EQUAL(res.size(), 1u);
+	BOOST_CHECK_EQUAL(res[0], "first line\nsecond line");
+
+	/* but each line keeps the time it was logged at */
+	BOOST_REQUIRE_EQUAL(lines.size(), 2u);
+	BOOST_CHECK(lines[0].stamp < lines[1].stamp);
+	BOOST_CHECK(lines[1].date - lines[0].date >= boost::posix_time::milliseconds(30));
+
+	/* when the queue is full, the least important lines are dropped first */
+	batch_logger.log("d1", DEBUG);
+	batch_logger.log("c1", CRITICAL);
+	batch_logger.log("d2", DEBUG);
+	batch_logger.log("c2", CRITICAL);
+	batch_logger.log("d3", DEBUG);
+	BOOST_CHECK_EQUAL(batch_logger.pending(), 3u);
+	BOOST_CHECK_EQUAL(batch_logger.dropped(), 2u);
+
+	deadline_.expires_from_now(boost::posix_time::milliseconds(50));
+	deadline_.async_wait(do_nothing());
+	io_s2.run();
+	io_s2.reset();
+
+	BOOST_REQUIRE_EQUAL(res.size(), 2u);
+	BOOST_CHECK_EQUAL(res[1], "c1\nc2\nd3\n2 log lines dropped");
+
 	serv.stop();
 	thr.join();
 }
+
+BOOST_AUTO_TEST_CASE ( network_logger_closed_peer_test )
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_service io_peer;
+	tcp::acceptor acceptor(io_peer);
+	tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 4242);
+	acceptor.open(endpoint.protocol());
+	acceptor.set_option(tcp::acceptor::reuse_address(true));
+	acceptor.bind(endpoint);
+	acceptor.listen();
+
+	boost::asio::io_service io_s;
+	false_resolv solver;
+	hyper::network::async_logger<false_resolv> logger_(io_s, "test", "logger", solver,
+			10, 2, boost::posix_time::milliseconds(10));
+	boost::asio::deadline_timer wait(io_s);
+
+	/* connect to the logger agent */
+	logger_.log("first line");
+	wait.expires_from_now(boost::posix_time::milliseconds(50));
+	wait.async_wait(boost::bind(&boost::asio::io_service::stop, &io_s));
+	io_s.run();
+	io_s.reset();
+	BOOST_CHECK_EQUAL(logger_.pending(), 0u);
+
+	tcp::socket first_peer(io_peer);
+	acceptor.accept(first_peer);
+
+	/* which resets the connection before the next batch */
+	first_peer.set_option(boost::asio::socket_base::linger(true, 0));
+	first_peer.close();
+	boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+
+	logger_.log("second line");
+	logger_.log("third line");
+	wait.expires_from_now(boost::posix_time::milliseconds(50));
+	wait.async_wait(boost::bind(&boost::asio::io_service::stop, &io_s));
+	io_s.run();
+	io_s.reset();
+
+	BOOST_CHECK_EQUAL(logger_.pending(), 0u);
+	BOOST_CHECK_EQUAL(logger_.dropped(), 2u);
+
+	/* the next batch reports them */
+	logger_.log("fourth line");
+	logger_.log("fifth line");
+	wait.expires_from_now(boost::posix_time::milliseconds(50));
+	wait.async_wait(boost::bind(&boost::asio::io_service::stop, &io_s));
+	io_s.run();
+
+	hyper::network::tcp::serialized_socket<input_msg> peer(io_peer);
+	acceptor.accept(peer.socket());
+
+	hyper::network::log_msgs msgs;
+	peer.sync_read(msgs);
+	BOOST_REQUIRE_EQUAL(msgs.lines.size(), 3u);
+	BOOST_CHECK_EQUAL(msgs.lines[0].msg, "fourth line");
+	BOOST_CHECK_EQUAL(msgs.lines[1].msg, "fifth line");
+	BOOST_CHECK_EQUAL(msgs.lines[2].msg, "2 log lines dropped");
+	BOOST_CHECK_EQUAL(logger_.dropped(), 2u);
+}
@@ -1,6 +1,9 @@
+#include <cstring>
+
 #include <network/msg.hh>
 #include <boost/test/unit_test.hpp>
 
+#include <network/buffer_streambuf.hh>
 #include <network/select_serialization.hh>
 
 template <typename T>
@@ -95,4 +98,154 @@ BOOST_AUTO_TEST_CASE ( network_msg_test )
 	oss1 << ctr1.constraint;
 	oss2 << ctr2.constraint;
 	BOOST_CHECK(oss1.str() == oss2.str());
+
+	request_variable_values rvv1, rvv2;
+	rvv1.id = 7;
+	rvv1.src = "pipo";
+	rvv1.var_names.push_back("x");
+	rvv1.var_names.push_back("P");
+
+	try_archive_interface(rvv1, rvv2);
+
+	BOOST_CHECK(rvv1.id == rvv2.id);
+	BOOST_CHECK(rvv1.src == rvv2.src);
+	BOOST_CHECK(rvv1.var_names == rvv2.var_names);
+
+	variable_values vv1, vv2;
+	vv1.id = 7;
+	vv1.src = "pipo";
+	vv1.values.resize(2);
+	vv1.values[0].var_name = "x";
+	vv1.values[0].success = true;
+	vv1.values[0].value = "42";
+	vv1.values[1].var_name = "P";
+	vv1.values[1].success = false;
+
+	try_archive_interface(vv1, vv2);
+
+	BOOST_CHECK(vv1.id == vv2.id);
+	BOOST_CHECK_EQUAL(vv2.values.size(), 2u);
+	BOOST_CHECK(vv2.values[0].var_name == "x");
+	BOOST_CHECK(vv2.values[0].success);
+	BOOST_CHECK(vv2.values[0].value == "42");
+	BOOST_CHECK(vv2.values[1].var_name == "P");
+	BOOST_CHECK(!vv2.values[1].success);
+
+	subscribe_variable sub1, sub2;
+	sub1.id = 3;
+	sub1.src = "pipo";
+	sub1.var_name = "x";
+	sub1.period = 50.0;
+	sub1.deadband = 0.5;
+
+	try_archive_interface(sub1, sub2);
+
+	BOOST_CHECK(sub1.id == sub2.id);
+	BOOST_CHECK(sub1.src == sub2.src);
+	BOOST_CHECK(sub1.var_name == sub2.var_name);
+	BOOST_CHECK(sub1.period == sub2.period);
+	BOOST_CHECK(sub1.deadband == sub2.deadband);
+}
+
+BOOST_AUTO_TEST_CASE ( network_msg_streambuf_test )
+{
+	using namespace hyper::network;
+
+	list_agents l1, l2;
+	l1.id = 7;
+	l1.src = "root";
+	/* enough data to force the output buffer to grow */
+	for (size_t i = 0; i < 100; ++i)
+		l1.all_agents.push_back("some_agent_with_a_long_name");
+
+	std::vector<char> buffer;
+	{
+		vector_ostreambuf buf(buffer);
+		std::ostream archive_stream(&buf);
+		HYPER_OUTPUT_ARCHIVE archive(archive_stream);
+		archive << l1;
+		archive_stream.flush();
+		buf.finish();
+	}
+	BOOST_CHECK(buffer.size() > 100 * l1.all_agents[0].size());
+
+	{
+		array_istreambuf buf(&buffer[0], buffer.size());
+		std::istream archive_stream(&buf);
+		HYPER_INPUT_ARCHIVE archive(archive_stream);
+		archive >> l2;
+	}
+
+	BOOST_CHECK(l1.id == l2.id);
+	BOOST_CHECK(l1.src == l2.src);
+	BOOST_CHECK(l1.all_agents == l2.all_agents);
+
+	/* a recycled buffer gives the same result */
+	std::vector<char> old = buffer;
+	buffer.clear();
+	{
+		vector_ostreambuf buf(buffer);
+		std::ostream archive_stream(&buf);
+		HYPER_OUTPUT_ARCHIVE archive(archive_stream);
+		archive << l1;
+		archive_stream.flush();
+		buf.finish();
+	}
+	BOOST_CHECK(buffer == old);
+
+	/* a small message in a big recycled buffer keeps its capacity */
+	std::size_t capacity = buffer.capacity();
+	buffer.clear();
+	list_agents small, small2;
+	small.id = 8;
+	small.src = "root";
+	{
+		vector_ostreambuf buf(buffer);
+		std::ostream archive_stream(&buf);
+		HYPER_OUTPUT_ARCHIVE archive(archive_stream);
+		archive << small;
+		archive_stream.flush();
+		buf.finish();
+	}
+	BOOST_CHECK(buffer.size() < 100);
+	BOOST_CHECK_EQUAL(buffer.capacity(), capacity);
+	{
+		array_istreambuf buf(&buffer[0], buffer.size());
+		std::istream archive_stream(&buf);
+		HYPER_INPUT_ARCHIVE archive(archive_stream);
+		archive >> small2;
+	}
+	BOOST_CHECK(small2.id == small.id);
+	BOOST_CHECK(small2.all_agents.empty());
+}
+
+BOOST_AUTO_TEST_CASE ( network_msg_header_test )
+{
+	using namespace hyper::network;
+
+	header head;
+	head.type = 0x40000003u;
+	head.size = 0x01020304u;
+	head.stamp = hlc_timestamp(0x0102030405060708LL, 0x0a0b0c0du);
+
+	/* the layout is fixed, whatever the architecture */
+	char buf[header_length];
+	encode_header(head, buf);
+	const unsigned char expected[header_length] = {
+		0x03, 0x00, 0x00, 0x40,
+		0x04, 0x03, 0x02, 0x01,
+		0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01,
+		0x0d, 0x0c, 0x0b, 0x0a
+	};
+	BOOST_CHECK(memcmp(buf, expected, header_length) == 0);
+
+	header res = decode_header(buf);
+	BOOST_CHECK_EQUAL(res.type, head.type);
+	BOOST_CHECK_EQUAL(res.size, head.size);
+	BOOST_CHECK(res.stamp == head.stamp);
+
+	/* negative physical parts survive too */
+	head.stamp.physical = -42;
+	encode_header(head, buf);
+	BOOST_CHECK(decode_header(buf).stamp == head.stamp);
 }
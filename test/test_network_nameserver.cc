@@ -9,9 +9,19 @@ struct test_async_name
 {
 	hyper::network::name_client & client_;
 	hyper::network::name_resolve r;
+	hyper::network::name_resolve r2;
+	int nb_answers;
 
+	test_async_name(hyper::network::name_client& client) : 
+		client_(client), nb_answers(0) {}
 
-	test_async_name(hyper::network::name_client& client) : client_(client) {}
+	void handle_answer(const boost::system::error_code &e, 
+					   hyper::network::name_resolve& solv)
+	{
+		BOOST_CHECK(!e);
+		BOOST_CHECK(solv.success());
+		nb_answers++;
+	}
 
 	void handle_first_test(const boost::system::error_code &e)
 	{
@@ -197,6 +207,83 @@ BOOST_AUTO_TEST_CASE ( namesever_test )
 	test_async.async_test();
 	ios2.run();
 
+	/* concurrent resolutions of the same name share one request */
+	test_async.r.name("pipo");
+	test_async.r2.name("pipo");
+	nc2.async_resolve(test_async.r, 
+			boost::bind(&test_async_name::handle_answer, &test_async,
+						boost::asio::placeholders::error, boost::ref(test_async.r)));
+	nc2.async_resolve(test_async.r2, 
+			boost::bind(&test_async_name::handle_answer, &test_async,
+						boost::asio::placeholders::error, boost::ref(test_async.r2)));
+	BOOST_CHECK_EQUAL(nc2.pending(), 1u);
+	ios2.reset();
+	ios2.run();
+	BOOST_CHECK_EQUAL(test_async.nb_answers, 2);
+	BOOST_CHECK(test_async.r2.endpoints() == endpoint_);
+
+	/* the answer is now cached */
+	nc2.async_resolve(test_async.r, 
+			boost::bind(&test_async_name::handle_answer, &test_async,
+						boost::asio::placeholders::error, boost::ref(test_async.r)));
+	BOOST_CHECK_EQUAL(nc2.pending(), 0u);
+	ios2.reset();
+	ios2.run();
+	BOOST_CHECK_EQUAL(test_async.nb_answers, 3);
+
+	/* until it is invalidated */
+	nc2.invalidate("pipo");
+	nc2.async_resolve(test_async.r, 
+			boost::bind(&test_async_name::handle_answer, &test_async,
+						boost::asio::placeholders::error, boost::ref(test_async.r)));
+	BOOST_CHECK_EQUAL(nc2.pending(), 1u);
+	ios2.reset();
+	ios2.run();
+	BOOST_CHECK_EQUAL(test_async.nb_answers, 4);
+
+	/* names pushed in the directory are resolved locally */
+	request_name_answer titi;
+	titi.name = "titi";
+	titi.success = true;
+	titi.endpoints = endpoint;
+
+	inform_new_agent new_agent;
+	new_agent.new_agents.push_back("titi");
+	new_agent.addresses.push_back(titi);
+	new_agent.directory_version = 1;
+	nc2.apply(new_agent);
+	BOOST_CHECK_EQUAL(nc2.version(), 1u);
+
+	test_async.r.name("titi");
+	nc2.async_resolve(test_async.r, 
+			boost::bind(&test_async_name::handle_answer, &test_async,
+						boost::asio::placeholders::error, boost::ref(test_async.r)));
+	BOOST_CHECK_EQUAL(nc2.pending(), 0u);
+	ios2.reset();
+	ios2.run();
+	BOOST_CHECK_EQUAL(test_async.nb_answers, 5);
+	BOOST_CHECK(test_async.r.endpoints() == endpoint);
+
+	/* an already applied delta is ignored */
+	new_agent.addresses[0].endpoints = endpoint_;
+	nc2.apply(new_agent);
+	BOOST_CHECK_EQUAL(nc2.version(), 1u);
+
+	/* after a missed delta, the name server is asked again */
+	inform_death_agent death;
+	death.dead_agents.push_back("nobody");
+	death.directory_version = 3;
+	nc2.apply(death);
+	BOOST_CHECK_EQUAL(nc2.version(), 3u);
+	test_async.r.name("pipo");
+	nc2.async_resolve(test_async.r, 
+			boost::bind(&test_async_name::handle_answer, &test_async,
+						boost::asio::placeholders::error, boost::ref(test_async.r)));
+	BOOST_CHECK_EQUAL(nc2.pending(), 1u);
+	ios2.reset();
+	ios2.run();
+	BOOST_CHECK_EQUAL(test_async.nb_answers, 6);
+
 	s.stop();
 	thr.join();
 }
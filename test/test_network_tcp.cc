@@ -2,6 +2,7 @@
 
 #include <network/server_tcp_impl.hh>
 #include <network/client_tcp_impl.hh>
+#include <network/transport.hh>
 
 #include <boost/thread.hpp>
 
@@ -235,3 +236,609 @@ BOOST_AUTO_TEST_CASE ( network_tcp_async_test )
 	c.close();
 	thr.join();
 }
+
+struct count_writes
+{
+	size_t& ok;
+	count_writes(size_t& ok_) : ok(ok_) {}
+
+	void operator() (const boost::system::error_code& e, size_t written) const
+	{
+		if (!e && written > 0)
+			ok++;
+	}
+};
+
+BOOST_AUTO_TEST_CASE ( network_tcp_write_queue_test )
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_service io_s;
+	tcp::acceptor acceptor(io_s, tcp::endpoint(tcp::v4(), 0));
+
+	serialized_socket<output_msg> writer(io_s), reader(io_s);
+	writer.socket().connect(tcp::endpoint(
+				boost::asio::ip::address::from_string("127.0.0.1"),
+				acceptor.local_endpoint().port()));
+	acceptor.accept(reader.socket());
+
+	/* Queue a lot of messages without waiting for the completion */
+	const size_t nb_msgs = 100;
+	size_t ok = 0;
+	for (size_t i = 0; i < nb_msgs; ++i) {
+		request_name r;
+		std::ostringstream oss;
+		oss << "ability" << i;
+		r.name = oss.str();
+		writer.async_write(r, count_writes(ok));
+	}
+	BOOST_CHECK(writer.pending_writes() == nb_msgs);
+
+	boost::thread thr( boost::bind(& boost::asio::io_service::run, &io_s));
+
+	/* They must be received in order, without corruption */
+	for (size_t i = 0; i < nb_msgs; ++i) {
+		request_name r;
+		reader.sync_read(r);
+		std::ostringstream oss;
+		oss << "ability" << i;
+		BOOST_CHECK_EQUAL(r.name, oss.str());
+	}
+
+	thr.join();
+	BOOST_CHECK_EQUAL(ok, nb_msgs);
+	BOOST_CHECK(writer.pending_writes() == 0);
+}
+
+namespace {
+	/* A socket owned by the handlers of its writes, like a server connection */
+	struct owned_socket
+	{
+		serialized_socket<output_msg> s;
+		bool& destroyed;
+
+		owned_socket(boost::asio::io_service& io_s, bool& destroyed_) :
+			s(io_s), destroyed(destroyed_)
+		{}
+
+		~owned_socket() { destroyed = true; }
+	};
+
+	struct keep_alive
+	{
+		boost::shared_ptr<owned_socket> owner;
+		size_t& ok;
+
+		keep_alive(boost::shared_ptr<owned_socket> owner_, size_t& ok_) :
+			owner(owner_), ok(ok_)
+		{}
+
+		void operator() (const boost::system::error_code& e, size_t) const
+		{
+			if (!e)
+				ok++;
+		}
+	};
+}
+
+BOOST_AUTO_TEST_CASE ( network_tcp_handler_owns_socket_test )
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_service io_s;
+	tcp::acceptor acceptor(io_s, tcp::endpoint(tcp::v4(), 0));
+
+	bool destroyed = false;
+	size_t ok = 0;
+	serialized_socket<output_msg> reader(io_s);
+	{
+		boost::shared_ptr<owned_socket> writer(new owned_socket(io_s, destroyed));
+		writer->s.socket().connect(tcp::endpoint(
+					boost::asio::ip::address::from_string("127.0.0.1"),
+					acceptor.local_endpoint().port()));
+		acceptor.accept(reader.socket());
+
+		request_name r;
+		r.name = "first";
+		writer->s.async_write(r, keep_alive(writer, ok));
+		r.name = "second";
+		writer->s.async_write(r, keep_alive(writer, ok));
+	}
+	BOOST_CHECK(!destroyed);
+
+	/* the last handler destroys the socket once the writes complete */
+	io_s.run();
+	BOOST_CHECK_EQUAL(ok, 2u);
+	BOOST_CHECK(destroyed);
+
+	request_name r;
+	reader.sync_read(r);
+	BOOST_CHECK_EQUAL(r.name, "first");
+	reader.sync_read(r);
+	BOOST_CHECK_EQUAL(r.name, "second");
+}
+
+typedef boost::mpl::vector<request_name, ping> restricted_msg;
+typedef boost::make_variant_over<restricted_msg>::type restricted_variant;
+
+struct store_error
+{
+	boost::system::error_code& err;
+	store_error(boost::system::error_code& err_) : err(err_) {}
+
+	void operator() (const boost::system::error_code& e) const
+	{
+		err = e;
+	}
+};
+
+BOOST_AUTO_TEST_CASE ( network_tcp_dispatch_test )
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_service io_s;
+	tcp::acceptor acceptor(io_s, tcp::endpoint(tcp::v4(), 0));
+
+	serialized_socket<output_msg> writer(io_s);
+	serialized_socket<restricted_msg> reader(io_s);
+	writer.socket().connect(tcp::endpoint(
+				boost::asio::ip::address::from_string("127.0.0.1"),
+				acceptor.local_endpoint().port()));
+	acceptor.accept(reader.socket());
+
+	ping p;
+	p.name = "pipo";
+	p.value = 42;
+	writer.sync_write(p);
+
+	restricted_variant v;
+	boost::system::error_code err = boost::asio::error::operation_aborted;
+	reader.async_read(v, store_error(err));
+	io_s.run();
+	io_s.reset();
+
+	BOOST_CHECK(!err);
+	BOOST_CHECK(boost::get<ping>(&v) != 0);
+	BOOST_CHECK_EQUAL(boost::get<ping>(v).name, "pipo");
+	BOOST_CHECK_EQUAL(boost::get<ping>(v).value, 42u);
+
+	/* register_name is not part of restricted_msg */
+	register_name rn;
+	rn.name = "pipo";
+	writer.sync_write(rn);
+	reader.async_read(v, store_error(err));
+	io_s.run();
+
+	BOOST_CHECK(err == boost::asio::error::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE ( network_tcp_pipeline_test )
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_service io_s;
+	echo_server s("127.0.0.1", "4243", echo_visitor(), io_s);
+	boost::thread thr( boost::bind(& boost::asio::io_service::run, &io_s));
+
+	/* Send all the requests before reading any answer */
+	boost::asio::io_service io_c;
+	serialized_socket<output_msg> c(io_c);
+	c.socket().connect(tcp::endpoint(
+				boost::asio::ip::address::from_string("127.0.0.1"), 4243));
+
+	const size_t nb_msgs = 5;
+	for (size_t i = 0; i < nb_msgs; ++i) {
+		request_name r;
+		std::ostringstream oss;
+		oss << "ability" << i;
+		r.name = oss.str();
+		c.sync_write(r);
+	}
+
+	/* Answers come in order */
+	for (size_t i = 0; i < nb_msgs; ++i) {
+		request_name r;
+		c.sync_read(r);
+		std::ostringstream oss;
+		oss << "ability" << i;
+		BOOST_CHECK_EQUAL(r.name, oss.str());
+	}
+
+	c.close();
+	s.stop();
+	thr.join();
+}
+
+struct store_size
+{
+	size_t& size;
+	store_size(size_t& size_) : size(size_) {}
+
+	void operator() (const boost::system::error_code&, size_t written) const
+	{
+		size = written;
+	}
+};
+
+BOOST_AUTO_TEST_CASE ( network_tcp_compression_test )
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_service io_s;
+	tcp::acceptor acceptor(io_s, tcp::endpoint(tcp::v4(), 0));
+
+	serialized_socket<output_msg> writer(io_s);
+	serialized_socket<output_msg> reader(io_s);
+	writer.socket().connect(tcp::endpoint(
+				boost::asio::ip::address::from_string("127.0.0.1"),
+				acceptor.local_endpoint().port()));
+	acceptor.accept(reader.socket());
+
+	variable_value big, res;
+	big.var_name = "cloud";
+	big.success = true;
+	big.value = std::string(100000, 'a');
+
+	/* the reader has not told yet it accepts compressed payloads */
+	size_t written = 0;
+	writer.async_write(big, store_size(written));
+	io_s.run();
+	io_s.reset();
+	reader.sync_read(res);
+	BOOST_CHECK(written > big.value.size());
+	BOOST_CHECK(res.value == big.value);
+
+	/* now it has */
+	ping p;
+	reader.sync_write(p);
+	writer.sync_read(p);
+
+	writer.async_write(big, store_size(written));
+	io_s.run();
+	io_s.reset();
+	reader.sync_read(res);
+	if (compression_available())
+		BOOST_CHECK(written < big.value.size() / 10);
+	BOOST_CHECK(res.var_name == big.var_name);
+	BOOST_CHECK(res.value == big.value);
+
+	/* small messages are never compressed */
+	request_name rn, rn2;
+	rn.name = std::string(100, 'b');
+	writer.async_write(rn, store_size(written));
+	io_s.run();
+	reader.sync_read(rn2);
+	BOOST_CHECK(written > rn.name.size());
+	BOOST_CHECK_EQUAL(rn2.name, rn.name);
+}
+
+BOOST_AUTO_TEST_CASE ( network_tcp_encoded_message_test )
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_service io_s;
+	tcp::acceptor acceptor(io_s, tcp::endpoint(tcp::v4(), 0));
+
+	/* one message encoded once, written on two connections */
+	const size_t nb_peers = 2;
+	boost::shared_ptr<serialized_socket<output_msg> > writers[nb_peers], readers[nb_peers];
+	for (size_t i = 0; i < nb_peers; ++i) {
+		writers[i].reset(new serialized_socket<output_msg>(io_s));
+		readers[i].reset(new serialized_socket<output_msg>(io_s));
+		writers[i]->socket().connect(tcp::endpoint(
+					boost::asio::ip::address::from_string("127.0.0.1"),
+					acceptor.local_endpoint().port()));
+		acceptor.accept(readers[i]->socket());
+	}
+
+	/* the first reader accepts compressed payloads, not the second one */
+	ping p;
+	readers[0]->sync_write(p);
+	writers[0]->sync_read(p);
+
+	variable_value big;
+	big.var_name = "cloud";
+	big.success = true;
+	big.value = std::string(100000, 'a');
+
+	boost::shared_ptr<const encoded_message> msg = encode_message(big);
+	size_t written[nb_peers] = { 0, 0 };
+	for (size_t i = 0; i < nb_peers; ++i)
+		writers[i]->async_write(*msg, store_size(written[i]));
+	io_s.run();
+
+	for (size_t i = 0; i < nb_peers; ++i) {
+		variable_value res;
+		readers[i]->sync_read(res);
+		BOOST_CHECK(res.var_name == big.var_name);
+		BOOST_CHECK(res.value == big.value);
+	}
+
+	if (compression_available())
+		BOOST_CHECK(written[0] < big.value.size() / 10);
+	BOOST_CHECK(written[1] > big.value.size());
+}
+
+BOOST_AUTO_TEST_CASE ( network_tcp_encoded_size_test )
+{
+	using boost::asio::ip::tcp;
+
+	request_name r;
+	r.name = std::string(1000, 'a');
+
+	/* reference encoding, once the archive is closed */
+	std::ostringstream oss;
+	{
+		HYPER_OUTPUT_ARCHIVE archive(oss);
+		archive << r;
+	}
+	std::string expected = oss.str();
+
+	boost::shared_ptr<const encoded_message> msg = encode_message(r);
+	BOOST_CHECK_EQUAL(msg->data.size(), expected.size());
+	BOOST_CHECK(std::string(msg->data.begin(), msg->data.end()) == expected);
+
+	boost::asio::io_service io_s;
+	tcp::acceptor acceptor(io_s, tcp::endpoint(tcp::v4(), 0));
+
+	serialized_socket<output_msg> writer(io_s), reader(io_s);
+	writer.socket().connect(tcp::endpoint(
+				boost::asio::ip::address::from_string("127.0.0.1"),
+				acceptor.local_endpoint().port()));
+	acceptor.accept(reader.socket());
+
+	size_t written = 0;
+	writer.async_write(r, store_size(written));
+	io_s.run();
+	BOOST_CHECK_EQUAL(written, header_length + expected.size());
+
+	request_name res;
+	reader.sync_read(res);
+	BOOST_CHECK_EQUAL(res.name, r.name);
+}
+
+BOOST_AUTO_TEST_CASE ( network_tcp_priority_test )
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_service io_s, io_r;
+	tcp::acceptor acceptor(io_s, tcp::endpoint(tcp::v4(), 0));
+
+	serialized_socket<output_msg> writer(io_s), reader(io_r);
+	writer.socket().connect(tcp::endpoint(
+				boost::asio::ip::address::from_string("127.0.0.1"),
+				acceptor.local_endpoint().port()));
+	acceptor.accept(reader.socket());
+
+	message_latency::instance().reset();
+
+	/* the first value is written at once, the others wait */
+	const size_t nb_values = 4;
+	size_t ok = 0;
+	for (size_t i = 0; i < nb_values; ++i) {
+		variable_value big;
+		big.var_name = "cloud";
+		big.success = true;
+		big.value = std::string(100000, 'a');
+		writer.async_write(big, count_writes(ok));
+	}
+
+	hyper::network::abort ab;
+	ab.src = "pipo";
+	ab.id = 42;
+	writer.async_write(ab, count_writes(ok));
+
+	boost::thread thr( boost::bind(& boost::asio::io_service::run, &io_s));
+
+	/* the abort overtakes the pending values */
+	std::vector<int> received;
+	for (size_t i = 0; i < nb_values + 1; ++i) {
+		output_variant v;
+		boost::system::error_code err;
+		reader.async_read(v, store_error(err));
+		io_r.run();
+		io_r.reset();
+		BOOST_CHECK(!err);
+		received.push_back(boost::get<hyper::network::abort>(&v) != 0);
+	}
+
+	thr.join();
+	BOOST_CHECK_EQUAL(ok, nb_values + 1);
+	BOOST_CHECK_EQUAL(received[0], 0);
+	BOOST_CHECK_EQUAL(received[1], 1);
+	for (size_t i = 2; i < received.size(); ++i)
+		BOOST_CHECK_EQUAL(received[i], 0);
+
+	BOOST_CHECK_EQUAL(message_latency::instance().get(control_class).count, 1u);
+	BOOST_CHECK_EQUAL(message_latency::instance().get(bulk_class).count, nb_values);
+	BOOST_CHECK_EQUAL(message_latency::instance().get(normal_class).count, 0u);
+}
+
+BOOST_AUTO_TEST_CASE ( network_tcp_control_order_test )
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_service io_s, io_r;
+	tcp::acceptor acceptor(io_s, tcp::endpoint(tcp::v4(), 0));
+
+	serialized_socket<output_msg> writer(io_s), reader(io_r);
+	writer.socket().connect(tcp::endpoint(
+				boost::asio::ip::address::from_string("127.0.0.1"),
+				acceptor.local_endpoint().port()));
+	acceptor.accept(reader.socket());
+
+	/* the first value is written at once, the second one waits */
+	size_t ok = 0;
+	for (size_t i = 0; i < 2; ++i) {
+		variable_value big;
+		big.var_name = "cloud";
+		big.success = true;
+		big.value = std::string(100000, 'a');
+		writer.async_write(big, count_writes(ok));
+	}
+
+	request_constraint ctr;
+	ctr.src = "pipo";
+	ctr.id = 42;
+	ctr.constraint = "less(x, 3)";
+	ctr.repeat = false;
+	ctr.delay = 0.0;
+	writer.async_write(ctr, count_writes(ok));
+
+	hyper::network::abort ab;
+	ab.src = "pipo";
+	ab.id = 42;
+	writer.async_write(ab, count_writes(ok));
+
+	boost::thread thr( boost::bind(& boost::asio::io_service::run, &io_s));
+
+	/* both overtake the pending value, but the abort stays behind its request */
+	std::vector<int> received;
+	for (size_t i = 0; i < 4; ++i) {
+		output_variant v;
+		boost::system::error_code err;
+		reader.async_read(v, store_error(err));
+		io_r.run();
+		io_r.reset();
+		BOOST_CHECK(!err);
+		received.push_back(v.which());
+	}
+
+	thr.join();
+	BOOST_CHECK_EQUAL(ok, 4u);
+	BOOST_REQUIRE_EQUAL(received.size(), 4u);
+	BOOST_CHECK_EQUAL(received[0], output_variant(variable_value()).which());
+	BOOST_CHECK_EQUAL(received[1], output_variant(request_constraint()).which());
+	BOOST_CHECK_EQUAL(received[2], output_variant(hyper::network::abort()).which());
+	BOOST_CHECK_EQUAL(received[3], output_variant(variable_value()).which());
+}
+
+struct count_aborted
+{
+	size_t& aborted;
+	count_aborted(size_t& aborted_) : aborted(aborted_) {}
+
+	void operator() (const boost::system::error_code& e, size_t) const
+	{
+		if (e == boost::asio::error::operation_aborted)
+			aborted++;
+	}
+};
+
+BOOST_AUTO_TEST_CASE ( network_tcp_write_failure_test )
+{
+	using boost::asio::ip::tcp;
+
+	boost::asio::io_service io_s;
+	tcp::acceptor acceptor(io_s, tcp::endpoint(tcp::v4(), 0));
+	tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"),
+						   acceptor.local_endpoint().port());
+
+	serialized_socket<output_msg> writer(io_s), reader(io_s);
+	writer.socket().connect(endpoint);
+	acceptor.accept(reader.socket());
+
+	size_t ok = 0, aborted = 0;
+	request_name r;
+	r.name = "first";
+	writer.async_write(r, count_writes(ok));
+
+	/* a message which can't be prepared is not queued */
+	encoded_message not_shared;
+	BOOST_CHECK_THROW(writer.async_write(not_shared, count_writes(ok)), boost::bad_weak_ptr);
+	BOOST_CHECK_EQUAL(writer.pending_writes(), 1u);
+
+	/* the messages queued before close() are not written after a reconnection */
+	r.name = "stale";
+	writer.async_write(r, count_aborted(aborted));
+	writer.async_write(r, count_aborted(aborted));
+	writer.close();
+
+	serialized_socket<output_msg> reader2(io_s);
+	writer.socket().connect(endpoint);
+	acceptor.accept(reader2.socket());
+	r.name = "fresh";
+	writer.async_write(r, count_writes(ok));
+	io_s.run();
+
+	BOOST_CHECK_EQUAL(aborted, 2u);
+	BOOST_CHECK_EQUAL(writer.pending_writes(), 0u);
+
+	request_name res;
+	reader2.sync_read(res);
+	BOOST_CHECK_EQUAL(res.name, "fresh");
+}
+
+#ifdef HYPER_HAS_LOCAL_SOCKETS
+BOOST_AUTO_TEST_CASE ( network_tcp_local_transport_test )
+{
+	using boost::asio::local::stream_protocol;
+
+	std::string path = local_socket_path("test_network_tcp");
+	std::vector<std::string> local_paths;
+	local_paths.push_back(path);
+	std::vector<boost::asio::ip::tcp::endpoint> tcp_endpoints;
+	tcp_endpoints.push_back(boost::asio::ip::tcp::endpoint(
+				boost::asio::ip::address::from_string("127.0.0.1"), 4244));
+
+	/* Local endpoints are only used if we are on the same host */
+	std::vector<hyper::network::stream_protocol::endpoint> endpoints;
+	endpoints = preferred_endpoints("some_other_host", local_paths, tcp_endpoints);
+	BOOST_CHECK_EQUAL(endpoints.size(), 1u);
+	endpoints = preferred_endpoints(boost::asio::ip::host_name(), local_paths, tcp_endpoints);
+	BOOST_CHECK_EQUAL(endpoints.size(), 2u);
+	BOOST_CHECK(endpoints[0] == hyper::network::stream_protocol::endpoint(
+								stream_protocol::endpoint(path)));
+
+	boost::asio::io_service io_s;
+	{
+		server<input_msg, output_msg, echo_visitor, stream_protocol> s(
+				stream_protocol::endpoint(path), echo_visitor(), io_s);
+		boost::thread thr( boost::bind(& boost::asio::io_service::run, &io_s));
+
+		boost::asio::io_service io_c;
+		client<output_msg, hyper::network::stream_protocol> c(io_c);
+		boost::system::error_code err = boost::asio::error::operation_aborted;
+		c.async_connect(endpoints, store_error(err));
+		io_c.run();
+		BOOST_CHECK(!err);
+
+		request_name rn1, rn2;
+		rn1.name = "one ability";
+		c.request(rn1, rn2);
+		are_equal(rn1, rn2);
+
+		c.close();
+		s.stop();
+		thr.join();
+	}
+
+	/* The socket file is removed with the server */
+	BOOST_CHECK(::access(path.c_str(), F_OK) != 0);
+}
+
+BOOST_AUTO_TEST_CASE ( network_tcp_local_path_test )
+{
+	using boost::asio::local::stream_protocol;
+
+	/* a long name is shortened to fit in a sockaddr_un */
+	std::string long_name(200, 'a');
+	std::string path = local_socket_path(long_name);
+	BOOST_REQUIRE(!path.empty());
+	BOOST_CHECK(path != local_socket_path(std::string(200, 'b')));
+	stream_protocol::endpoint endpoint(path);
+	BOOST_CHECK(endpoint.path() == path);
+
+	/* and so is a long TMPDIR */
+	const char* old_dir = getenv("TMPDIR");
+	std::string saved = old_dir ? old_dir : "";
+	setenv("TMPDIR", ("/tmp/" + std::string(150, 'd')).c_str(), 1);
+	path = local_socket_path("test_network_tcp");
+	BOOST_CHECK_EQUAL(path.find("/tmp/hyper-"), 0u);
+	BOOST_CHECK_NO_THROW(stream_protocol::endpoint endpoint(path));
+	if (old_dir)
+		setenv("TMPDIR", saved.c_str(), 1);
+	else
+		unsetenv("TMPDIR");
+}
+#endif
@@ -0,0 +1,190 @@
+#include <network/actor_protocol.hh>
+#include <network/msg.hh>
+#include <network/timer_wheel.hh>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace hyper::network;
+
+namespace {
+	void expire(std::vector<identifier>& expired, identifier id)
+	{
+		expired.push_back(id);
+	}
+
+	void handle_request(const boost::system::error_code& e,
+						std::vector<boost::system::error_code>& errors)
+	{
+		errors.push_back(e);
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( network_timer_wheel_test )
+{
+	using namespace boost::posix_time;
+
+	boost::asio::io_service io_s;
+	std::vector<identifier> expired;
+
+	/* 8 slots of 10ms, so deadlines of 100ms need several rounds */
+	timer_wheel wheel(io_s, boost::bind(expire, boost::ref(expired), _1),
+					  milliseconds(10), 8);
+
+	ptime start = microsec_clock::universal_time();
+	wheel.schedule(1, milliseconds(100));
+	wheel.schedule(2, milliseconds(20));
+	wheel.schedule(3, milliseconds(30));
+	wheel.schedule(4, milliseconds(40));
+	BOOST_CHECK_EQUAL(wheel.size(), 4u);
+
+	wheel.cancel(3);
+	/* re-arming replaces the previous deadline */
+	wheel.schedule(4, milliseconds(50));
+	BOOST_CHECK_EQUAL(wheel.size(), 3u);
+
+	io_s.run();
+	time_duration elapsed = microsec_clock::universal_time() - start;
+
+	BOOST_CHECK_EQUAL(wheel.size(), 0u);
+	BOOST_REQUIRE_EQUAL(expired.size(), 3u);
+	BOOST_CHECK_EQUAL(expired[0], 2u);
+	BOOST_CHECK_EQUAL(expired[1], 4u);
+	BOOST_CHECK_EQUAL(expired[2], 1u);
+	BOOST_CHECK(elapsed >= milliseconds(100));
+
+	/* deadlines of a callback_database */
+	typedef boost::mpl::vector<request_constraint_answer> input;
+	callback_database<input> db(io_s, milliseconds(10));
+	std::vector<boost::system::error_code> errors;
+
+	db.add("a", 1, boost::bind(handle_request, _1, boost::ref(errors)), milliseconds(30));
+	db.add("a", 2, boost::bind(handle_request, _1, boost::ref(errors)), milliseconds(30));
+	db.add("a", 3, boost::bind(handle_request, _1, boost::ref(errors)));
+
+	/* 2 is answered in time, 3 has no deadline */
+	db.trigger(2, request_constraint_answer());
+	db.remove(2);
+
+	io_s.reset();
+	io_s.run();
+
+	BOOST_REQUIRE_EQUAL(errors.size(), 2u);
+	BOOST_CHECK(!errors[0]);
+	BOOST_CHECK(errors[1] == make_error_code(protocol_error::request_timeout));
+	BOOST_CHECK(db.contains(1));
+	BOOST_CHECK(db.contains(3));
+}
+
+BOOST_AUTO_TEST_CASE ( network_timer_wheel_restart_test )
+{
+	using namespace boost::posix_time;
+
+	boost::asio::io_service io_s;
+	std::vector<identifier> expired;
+	timer_wheel wheel(io_s, boost::bind(expire, boost::ref(expired), _1),
+					  milliseconds(10), 8);
+
+	/* rescheduled before the aborted handler runs */
+	wheel.schedule(1, milliseconds(20));
+	wheel.stop();
+	wheel.schedule(2, milliseconds(20));
+
+	io_s.run();
+
+	BOOST_REQUIRE_EQUAL(expired.size(), 1u);
+	BOOST_CHECK_EQUAL(expired[0], 2u);
+	BOOST_CHECK_EQUAL(wheel.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE ( network_timer_wheel_running_request_test )
+{
+	using namespace boost::posix_time;
+
+	boost::asio::io_service io_s;
+	typedef boost::mpl::vector<request_constraint_answer> input;
+	callback_database<input> db(io_s, milliseconds(10));
+	std::vector<boost::system::error_code> errors;
+
+	db.add("a", 1, boost::bind(handle_request, _1, boost::ref(errors)), milliseconds(30));
+	db.add("a", 2, boost::bind(handle_request, _1, boost::ref(errors)), milliseconds(30));
+
+	/* 1 is running for longer than its deadline, 2 only told it started */
+	request_constraint_answer running, init;
+	running.state = request_constraint_answer::RUNNING;
+	init.state = request_constraint_answer::INIT;
+	db.trigger(1, running);
+	db.trigger(2, init);
+
+	boost::asio::deadline_timer wait(io_s, milliseconds(100));
+	wait.async_wait(boost::bind(&boost::asio::io_service::stop, &io_s));
+	io_s.run();
+
+	BOOST_REQUIRE_EQUAL(errors.size(), 3u);
+	BOOST_CHECK(!errors[0]);
+	BOOST_CHECK(!errors[1]);
+	BOOST_CHECK(errors[2] == make_error_code(protocol_error::request_timeout));
+
+	/* the death of the peer still ends it */
+	db.cancel("a");
+	BOOST_REQUIRE_EQUAL(errors.size(), 5u);
+	BOOST_CHECK(errors[3] == boost::asio::error::connection_reset);
+}
+
+namespace {
+	void handle_timeout(std::vector<identifier>& aborted, identifier id,
+						const std::vector<boost::system::error_code>& errors)
+	{
+		/* called before the callback of the request */
+		BOOST_CHECK(errors.empty());
+		aborted.push_back(id);
+	}
+}
+
+BOOST_AUTO_TEST_CASE ( network_timer_wheel_repeated_request_test )
+{
+	using namespace boost::posix_time;
+
+	boost::asio::io_service io_s;
+	typedef boost::mpl::vector<request_constraint_answer> input;
+	callback_database<input> db(io_s, milliseconds(10));
+	std::vector<boost::system::error_code> errors;
+	std::vector<identifier> aborted;
+
+	/* 1 is an ensure which holds, 2 a make which succeeded but isn't removed */
+	db.add("a", 1, boost::bind(handle_request, _1, boost::ref(errors)), milliseconds(30),
+		   true, boost::bind(handle_timeout, boost::ref(aborted), 1, boost::cref(errors)));
+	db.add("a", 2, boost::bind(handle_request, _1, boost::ref(errors)), milliseconds(30),
+		   false, boost::bind(handle_timeout, boost::ref(aborted), 2, boost::cref(errors)));
+
+	request_constraint_answer success;
+	success.state = request_constraint_answer::SUCCESS;
+	db.trigger(1, success);
+	db.trigger(2, success);
+	errors.clear();
+
+	boost::asio::deadline_timer wait(io_s, milliseconds(100));
+	wait.async_wait(boost::bind(&boost::asio::io_service::stop, &io_s));
+	io_s.run();
+
+	BOOST_REQUIRE_EQUAL(errors.size(), 1u);
+	BOOST_CHECK(errors[0] == make_error_code(protocol_error::request_timeout));
+	BOOST_REQUIRE_EQUAL(aborted.size(), 1u);
+	BOOST_CHECK_EQUAL(aborted[0], 2u);
+
+	/* a failure ends the ensure, it must be removed in time */
+	request_constraint_answer failure;
+	failure.state = request_constraint_answer::FAILURE;
+	db.trigger(1, failure);
+	errors.clear();
+
+	io_s.reset();
+	wait.expires_from_now(milliseconds(100));
+	wait.async_wait(boost::bind(&boost::asio::io_service::stop, &io_s));
+	io_s.run();
+
+	BOOST_REQUIRE_EQUAL(errors.size(), 1u);
+	BOOST_CHECK(errors[0] == make_error_code(protocol_error::request_timeout));
+	BOOST_REQUIRE_EQUAL(aborted.size(), 2u);
+	BOOST_CHECK_EQUAL(aborted[1], 1u);
+}